@@ -0,0 +1,256 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xml_fuzz.c
+// fuzz target for the parser, libFuzzer entry point and standalone driver
+// for AFL and for replaying crash files
+//
+// first two bytes of input select configuration, rest is the document:
+//     byte 0  bits 0-1  input mode: string, buffer, chunks, one byte chunks
+//             bits 2-5  XML_OPTION_LAZY_ATTRS, SKIP_WHITESPACE, TRIM, RECOVER
+//             bits 6-7  record level for recovery
+//     byte 1  bits 0-2  pool size, 16 << n bytes
+//             bits 3-5  depth, attribute and name limits
+//             bits 6-7  chunk size for chunk mode, 1 << (2 * n + 2) bytes
+// handlers read all event data, so sanitizers see every byte the parser passes
+//
+//     clang -g -O1 -fsanitize=fuzzer,address,undefined -I.. xml_fuzz.c ../xmlparser.c -o xml_fuzz
+//     ./xml_fuzz -max_len=4096 corpus/
+//
+//     gcc -g -O1 -DXML_FUZZ_MAIN -fsanitize=address,undefined -I.. xml_fuzz.c ../xmlparser.c -o xml_fuzz
+//     ./xml_fuzz crash-file ...
+//     afl-clang-fast -DXML_FUZZ_MAIN -I.. xml_fuzz.c ../xmlparser.c -o xml_fuzz_afl
+//     afl-fuzz -i corpus -o findings ./xml_fuzz_afl @@
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xmlparser.h"
+
+
+// sum of event data, keeps reads from being optimized away
+static volatile unsigned fuzz_sink;
+
+
+
+static void fuzz_read(const char* s)
+{
+    unsigned h = 0;
+
+    if(!s) return;
+    while(*s) h = h * 31 + (unsigned char)*s++;
+    fuzz_sink += h;
+}
+
+
+
+static void fuzz_decode(char* s, int len)
+{
+    char* copy = malloc(len + 1);
+
+    if(!copy) return;
+    memcpy(copy, s, len);
+    copy[len] = 0;
+    fuzz_sink += xml_text_decode(copy, len);
+    fuzz_read(copy);
+    free(copy);
+}
+
+
+
+static void fuzz_start_element(xml_parser_t* p)
+{
+    char* attr_string = p->attr;
+    xml_attr_t a;
+    char buf[64];
+
+    fuzz_read(p->tag);
+    fuzz_read(p->attr);
+
+    while(attr_string && xml_next_attr(&attr_string, &a))
+    {
+        fuzz_sink += xml_attr_decode(&a, buf, sizeof(buf));
+        fuzz_decode(a.value, a.value_len);
+    }
+}
+
+
+
+static void fuzz_end_element(xml_parser_t* p)
+{
+    fuzz_read(p->tag);
+}
+
+
+
+static void fuzz_characters(xml_parser_t* p)
+{
+    fuzz_decode(p->chars, (int)strlen(p->chars));
+}
+
+
+
+static void fuzz_text(xml_parser_t* p)
+{
+    // comment, PI, CDATA and error string share the same field
+    fuzz_read(p->tag);
+}
+
+
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static const int options[] =
+    {
+        XML_OPTION_LAZY_ATTRS, XML_OPTION_SKIP_WHITESPACE, XML_OPTION_TRIM, XML_OPTION_RECOVER,
+    };
+    xml_parser_t p;
+    char* pool;
+    char* doc;
+    int pool_size, mode, limits, i;
+
+    if(size < 2) return 0;
+
+    mode = data[0] & 3;
+    pool_size = 16 << (data[1] & 7);
+    limits = (data[1] >> 3) & 7;
+
+    // document is copied, so reads past its end are caught, string mode adds zero
+    size -= 2;
+    doc = malloc(size + 1);
+    pool = malloc(pool_size);
+    if(!doc || !pool)
+    {
+        free(doc);
+        free(pool);
+        return 0;
+    }
+    memcpy(doc, data + 2, size);
+    doc[size] = 0;
+
+    xml_init(&p, pool, pool_size);
+    p.errorcode = XML_ERROR_NONE;
+    xml_set_handler(&p, fuzz_start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(&p, fuzz_end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(&p, fuzz_characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(&p, fuzz_text, XML_ERROR_HANDLER);
+#ifndef XML_NO_COMMENTS
+    xml_set_handler(&p, fuzz_text, XML_COMMENT_HANDLER);
+#endif
+#ifndef XML_NO_PI
+    xml_set_handler(&p, fuzz_text, XML_PI_HANDLER);
+#endif
+#ifndef XML_NO_CDATA
+    xml_set_handler(&p, fuzz_text, XML_CDATA_HANDLER);
+#endif
+
+    for(i = 0; i < 4; i++)
+    {
+        if(data[0] & (4 << i)) xml_set_option(&p, options[i], 1);
+    }
+#ifndef XML_NO_RECOVER
+    if(data[0] & 0x20) xml_set_record_level(&p, data[0] >> 6);
+#endif
+
+    if(limits & 1) xml_set_limit(&p, XML_LIMIT_DEPTH, 3);
+    if(limits & 2) xml_set_limit(&p, XML_LIMIT_ATTRS, 2);
+    if(limits & 4) xml_set_limit(&p, XML_LIMIT_NAME, 4);
+
+    if(mode == 0) xml_parse_string(&p, doc);
+    else if(mode == 1) xml_parse_buffer(&p, doc, size);
+    else
+    {
+        // unconsumed bytes are passed again with next chunk, as
+        // xml_parse_chunk requires
+        size_t chunk = mode == 3 ? 1 : (size_t)1 << (2 * (data[1] >> 6) + 2);
+        size_t pos = 0, n = 0;
+        int r;
+
+        while(1)
+        {
+            int final;
+
+            n += chunk;
+            if(pos + n > size) n = size - pos;
+            final = pos + n == size;
+
+            r = xml_parse_chunk(&p, doc + pos, (int)n, final);
+            if(r < 0 || final) break;
+
+            pos += r;
+            if(r) n = 0;
+        }
+    }
+
+    free(pool);
+    free(doc);
+    return 0;
+}
+
+
+
+#ifdef XML_FUZZ_MAIN
+
+#include <stdio.h>
+
+// run target on every file named on command line, or on stdin
+int main(int argc, char** argv)
+{
+    int i;
+
+    for(i = argc > 1 ? 1 : 0; i < argc; i++)
+    {
+        FILE* f = argc > 1 ? fopen(argv[i], "rb") : stdin;
+        uint8_t* data = 0;
+        size_t size = 0, n;
+
+        if(!f)
+        {
+            fprintf(stderr, "%s: can not open\n", argv[i]);
+            return 1;
+        }
+
+        do
+        {
+            uint8_t* tmp = realloc(data, size + 4096);
+
+            if(!tmp) return 1;
+            data = tmp;
+            n = fread(data + size, 1, 4096, f);
+            size += n;
+        }
+        while(n == 4096);
+
+        if(f != stdin) fclose(f);
+
+        LLVMFuzzerTestOneInput(data, size);
+        free(data);
+    }
+
+    return 0;
+}
+
+#endif
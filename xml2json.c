@@ -0,0 +1,112 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xml2json.c
+// command line converter of xml to JSON or NDJSON
+//
+//     xml2json [-r record_level] [-a attr_prefix] [-t text_key] [file]
+//
+// input is read from file or stdin and can be gzip or zstd compressed,
+// JSON is written to stdout
+//
+//     gcc -O2 xml2json.c xmljson.c xmlzip.c xmlparser.c -o xml2json
+//
+// add -DXML_HAVE_ZLIB -lz for gzip and -DXML_HAVE_ZSTD -lzstd for zstd input
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xmlparser.h"
+#include "xmljson.h"
+#include "xmlzip.h"
+
+
+static int write_stdout(xml_json_t* j, const char* data, int len)
+{
+    return fwrite(data, 1, len, stdout) != (size_t)len;
+}
+
+
+
+static int read_stdin(void* ctx, char* buf, int size)
+{
+    int n = (int)fread(buf, 1, size, stdin);
+
+    return !n && ferror(stdin) ? -1 : n;
+}
+
+
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: xml2json [-r record_level] [-a attr_prefix] [-t text_key] [file]\n");
+    exit(2);
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    static char pool[64 * 1024];
+    static char out[256 * 1024];
+    xml_parser_t p;
+    xml_json_t j;
+    const char* attr_prefix = "@";
+    const char* text_key = "#text";
+    const char* path = 0;
+    int record_level = 1;
+    int err, i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-r") && i + 1 < argc) record_level = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-a") && i + 1 < argc) attr_prefix = argv[++i];
+        else if(!strcmp(argv[i], "-t") && i + 1 < argc) text_key = argv[++i];
+        else if(argv[i][0] == '-' && argv[i][1]) usage();
+        else if(!path) path = argv[i];
+        else usage();
+    }
+
+    xml_init(&p, pool, sizeof(pool));
+    xml_set_option(&p, XML_OPTION_SKIP_WHITESPACE, 1);
+
+    xml_json_init(&j, out, sizeof(out), write_stdout);
+    xml_json_set_keys(&j, attr_prefix, text_key);
+    xml_json_set_record_level(&j, record_level);
+    xml_json_attach(&j, &p);
+
+    if(path && strcmp(path, "-")) xml_parse_zip_file(&p, path, XML_ZIP_AUTO, 0);
+    else xml_parse_zip(&p, read_stdin, 0, XML_ZIP_AUTO, 0);
+
+    err = xml_json_finish(&j);
+    fflush(stdout);
+
+    if(err)
+    {
+        fprintf(stderr, "xml2json: error %d: %s\n", err, j.errorstr ? j.errorstr : "");
+        return 1;
+    }
+
+    return 0;
+}
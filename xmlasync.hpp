@@ -0,0 +1,150 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlasync.hpp
+// header-only C++20 coroutine front end for xml_parse_chunk
+//
+// parsing coroutine suspends when input runs out and is resumed when next
+// buffer arrives, so it works with any event loop or executor:
+// source is any object with member read(char* buf, int size) returning an
+// awaitable that produces number of bytes read (0 or less at end of input)
+//
+//     struct socket_source
+//     {
+//         auto read(char* buf, int size);    // resumed by event loop when socket is readable
+//     };
+//
+//     xml::task t = xml::async_parse(parser.c_parser(), source, buf, sizeof(buf));
+//     t.start();
+//
+// input buffer must be large enough for the longest token in document
+
+#ifndef __XMLASYNC_HPP__
+#define __XMLASYNC_HPP__
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <cstring>
+#include "xmlparser.h"
+
+namespace xml
+{
+
+// lazily started coroutine producing parser error code
+class task
+{
+public:
+    struct promise_type
+    {
+        int result = XML_ERROR_NONE;
+        std::coroutine_handle<> continuation;
+
+        task get_return_object() { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept
+        {
+            struct final_awaiter
+            {
+                bool await_ready() noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                {
+                    std::coroutine_handle<> c = h.promise().continuation;
+                    return c ? c : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            return final_awaiter{};
+        }
+
+        void return_value(int value) { result = value; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    task(task&& other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task() { if(h_) h_.destroy(); }
+
+    // run until first suspension, used when task is not awaited by another coroutine
+    void start() { h_.resume(); }
+
+    bool done() const { return h_.done(); }
+    int result() const { return h_.promise().result; }
+
+    // awaiting task starts it and resumes awaiting coroutine when it is done
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept
+    {
+        h_.promise().continuation = c;
+        return h_;
+    }
+
+    int await_resume() const { return h_.promise().result; }
+
+private:
+    explicit task(std::coroutine_handle<promise_type> h) : h_(h) {}
+
+    std::coroutine_handle<promise_type> h_;
+};
+
+
+// parse input from source with p
+// returns XML_ERROR_NONE or error code reported to error handler
+template<class Source>
+task async_parse(xml_parser_t* p, Source& source, char* buf, int size)
+{
+    int keep = 0;
+
+    while(true)
+    {
+        if(keep == size)
+        {
+            // token does not fit in input buffer
+            xml_set_error(p, XML_ERROR_NO_MEMORY, "No enough memory in input buffer");
+            xml_reset(p);
+            co_return XML_ERROR_NO_MEMORY;
+        }
+
+        int n = co_await source.read(buf + keep, size - keep);
+        int final = n <= 0;
+        int len = keep + (final ? 0 : n);
+        int consumed = xml_parse_chunk(p, buf, len, final);
+
+        if(consumed < 0) co_return p->errorcode;
+        if(final) co_return XML_ERROR_NONE;
+
+        keep = len - consumed;
+        std::memmove(buf, buf + consumed, keep);
+    }
+}
+
+} // namespace xml
+
+#endif // __XMLASYNC_HPP__
@@ -0,0 +1,292 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlasync_test.cpp
+// test of coroutine front end (xmlasync.hpp) over local socket pairs
+//
+// many connections are parsed concurrently on one thread by a small poll()
+// event loop; writer side sends document in small pieces round robin, so
+// every parsing coroutine suspends many times inside tokens and line endings;
+// events of every connection are compared with xml_parse_string of the same
+// document
+//
+//     gcc -O2 -c xmlparser.c
+//     g++ -std=c++20 -O2 xmlasync_test.cpp xmlparser.o -o xmlasync_test
+//     ./xmlasync_test [connections [piece]]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <coroutine>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "xmlasync.hpp"
+
+
+// fds waiting to be readable and coroutines waiting on them
+struct event_loop
+{
+    std::vector<pollfd> fds;
+    std::vector<std::coroutine_handle<>> waiting;
+
+    void wait(int fd, std::coroutine_handle<> h)
+    {
+        fds.push_back(pollfd{fd, POLLIN, 0});
+        waiting.push_back(h);
+    }
+
+    // resume coroutines with readable fds, returns number of resumed ones
+    int run_once(int timeout)
+    {
+        std::vector<pollfd> f;
+        std::vector<std::coroutine_handle<>> w;
+        int resumed = 0;
+
+        if(fds.empty() || poll(fds.data(), fds.size(), timeout) <= 0) return 0;
+
+        // coroutines wait again while they are resumed
+        f.swap(fds);
+        w.swap(waiting);
+
+        for(size_t i = 0; i < f.size(); i++)
+        {
+            if(f[i].revents)
+            {
+                w[i].resume();
+                resumed++;
+            }
+            else wait(f[i].fd, w[i]);
+        }
+
+        return resumed;
+    }
+};
+
+
+// non-blocking read end of socket pair
+struct socket_source
+{
+    int fd;
+    event_loop* loop;
+
+    struct awaiter
+    {
+        socket_source* s;
+        char* buf;
+        int size;
+        int n;
+
+        bool await_ready()
+        {
+            n = (int)::read(s->fd, buf, size);
+            return n >= 0 || errno != EAGAIN;
+        }
+
+        void await_suspend(std::coroutine_handle<> h) { s->loop->wait(s->fd, h); }
+
+        int await_resume()
+        {
+            // resumed by loop when fd is readable
+            if(n < 0 && errno == EAGAIN) n = (int)::read(s->fd, buf, size);
+            return n;
+        }
+    };
+
+    awaiter read(char* buf, int size) { return awaiter{this, buf, size, 0}; }
+};
+
+
+// events are recorded as text
+static void record_start(xml_parser_t* p)
+{
+    std::string* s = (std::string*)p->user_ptr;
+
+    *s += "S" + std::to_string(p->level) + p->tag + "[" + p->attr + "]";
+}
+
+static void record_end(xml_parser_t* p)
+{
+    std::string* s = (std::string*)p->user_ptr;
+
+    *s += "E" + std::to_string(p->level) + p->tag;
+}
+
+static void record_chars(xml_parser_t* p)
+{
+    std::string* s = (std::string*)p->user_ptr;
+
+    *s += "T" + std::string(p->chars);
+}
+
+static void record_text(xml_parser_t* p)
+{
+    std::string* s = (std::string*)p->user_ptr;
+
+    *s += "X" + std::string(p->tag);
+}
+
+static void record_error(xml_parser_t* p)
+{
+    std::string* s = (std::string*)p->user_ptr;
+
+    *s += "!" + std::to_string(p->errorcode);
+}
+
+
+static void init_parser(xml_parser_t* p, char* pool, int pool_size, std::string* events)
+{
+    xml_init(p, pool, pool_size);
+    p->user_ptr = events;
+    xml_set_handler(p, (void*)record_start, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, (void*)record_end, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, (void*)record_chars, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, (void*)record_error, XML_ERROR_HANDLER);
+#ifndef XML_NO_COMMENTS
+    xml_set_handler(p, (void*)record_text, XML_COMMENT_HANDLER);
+#endif
+#ifndef XML_NO_PI
+    xml_set_handler(p, (void*)record_text, XML_PI_HANDLER);
+#endif
+#ifndef XML_NO_CDATA
+    xml_set_handler(p, (void*)record_text, XML_CDATA_HANDLER);
+#endif
+}
+
+
+// document with CRLF line endings, so pieces split "\r\n" too
+static std::string make_document(int records)
+{
+    std::string d = "<?xml version=\"1.0\"?>\r\n<log>\r\n";
+
+    for(int i = 0; i < records; i++)
+    {
+        d += "  <entry id=\"" + std::to_string(i) + "\" level=\"info &amp; debug\">\r\n";
+        d += "    <!-- entry " + std::to_string(i) + " -->\r\n";
+        d += "    <text>message " + std::to_string(i * 7) + " &lt;ok&gt;</text>\r\n";
+        d += "    <data><![CDATA[x < y]]></data>\r\n";
+        d += "  </entry>\r\n";
+    }
+
+    return d + "</log>\r\n";
+}
+
+
+struct connection
+{
+    int fds[2];
+    size_t sent = 0;
+    xml_parser_t p;
+    char pool[1024];
+    char buf[256];
+    std::string events;
+    xml::task t;
+
+    connection(socket_source* src) : t(xml::async_parse(&p, *src, buf, sizeof(buf))) {}
+};
+
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1000;
+    size_t piece = argc > 2 ? (size_t)atoi(argv[2]) : 7;
+    std::string doc = make_document(50);
+    std::string expected;
+    std::vector<socket_source> sources(count);
+    std::vector<connection*> conns;
+    event_loop loop;
+    xml_parser_t p;
+    static char pool[1024];
+    int failed = 0, open;
+
+    // reference events
+    std::vector<char> copy(doc.begin(), doc.end());
+    copy.push_back(0);
+    init_parser(&p, pool, sizeof(pool), &expected);
+    xml_parse_string(&p, copy.data());
+
+    for(int i = 0; i < count; i++)
+    {
+        int fds[2];
+
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+        {
+            perror("socketpair");
+            return 1;
+        }
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+        sources[i].fd = fds[0];
+        sources[i].loop = &loop;
+
+        connection* c = new connection(&sources[i]);
+        c->fds[0] = fds[0];
+        c->fds[1] = fds[1];
+        init_parser(&c->p, c->pool, sizeof(c->pool), &c->events);
+        c->t.start();
+        conns.push_back(c);
+    }
+
+    // send pieces round robin and run parsers until all writers are closed
+    // and all parsers are done
+    do
+    {
+        open = 0;
+
+        for(connection* c : conns)
+        {
+            if(c->fds[1] < 0) continue;
+
+            size_t n = doc.size() - c->sent < piece ? doc.size() - c->sent : piece;
+            ssize_t w = write(c->fds[1], doc.data() + c->sent, n);
+
+            if(w > 0) c->sent += (size_t)w;
+            if(c->sent == doc.size())
+            {
+                close(c->fds[1]);
+                c->fds[1] = -1;
+            }
+            else open++;
+        }
+
+        while(loop.run_once(0));
+        for(connection* c : conns) if(!c->t.done()) open++;
+    }
+    while(open);
+
+    for(connection* c : conns)
+    {
+        if(c->t.result() != XML_ERROR_NONE || c->events != expected) failed++;
+        close(c->fds[0]);
+        delete c;
+    }
+
+    printf("%d connections, %d failed, %d events bytes\n", count, failed, (int)expected.size());
+
+    return failed ? 1 : 0;
+}
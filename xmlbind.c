@@ -0,0 +1,371 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlbind.c
+
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <float.h>
+#include "xmlbind.h"
+#include "xmlnum.h"
+
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+
+// store integer to signed field of size bytes, bool and enum fields can be of any
+// integer size too
+// returns XML_ERROR_NONE or XML_ERROR_RANGE
+static int bind_int(char* field, int size, int64_t i)
+{
+    switch(size)
+    {
+    case 1: if(i < INT8_MIN || i > INT8_MAX) break; *(int8_t*)field = (int8_t)i; return XML_ERROR_NONE;
+    case 2: if(i < INT16_MIN || i > INT16_MAX) break; *(int16_t*)field = (int16_t)i; return XML_ERROR_NONE;
+    case 4: if(i < INT32_MIN || i > INT32_MAX) break; *(int32_t*)field = (int32_t)i; return XML_ERROR_NONE;
+    case 8: *(int64_t*)field = i; return XML_ERROR_NONE;
+    }
+
+    return XML_ERROR_RANGE;
+}
+
+
+
+// convert value and store it to field of d in struct base
+// returns 0 on success
+static int bind_value(xml_parser_t* p, const xml_bind_t* d, char* base, const char* s, int len)
+{
+    char* field = base + d->offset;
+    int err = XML_ERROR_VALUE;
+    int64_t i;
+    double f;
+    int v;
+
+    switch(d->type)
+    {
+    case XML_BIND_INT:
+        err = xml_attr_to_int64(s, len, &i);
+        if(err != XML_ERROR_NONE) break;
+        err = bind_int(field, d->size, i);
+        if(err != XML_ERROR_NONE) break;
+        return 0;
+
+    case XML_BIND_FLOAT:
+        err = xml_attr_to_double(s, len, &f);
+        if(err != XML_ERROR_NONE) break;
+        if(d->size == sizeof(float))
+        {
+            err = XML_ERROR_RANGE;
+            if(isfinite(f) && fabs(f) > FLT_MAX) break;
+            *(float*)field = (float)f;
+        }
+        else *(double*)field = f;
+        return 0;
+
+    case XML_BIND_BOOL:
+        err = xml_attr_to_bool(s, len, &v);
+        if(err != XML_ERROR_NONE) break;
+        err = bind_int(field, d->size, v);
+        if(err != XML_ERROR_NONE) break;
+        return 0;
+
+    case XML_BIND_ENUM:
+    {
+        const xml_bind_enum_t* e;
+
+        while(len && is_space(*s)) s++, len--;
+        while(len && is_space(s[len - 1])) len--;
+
+        for(e = d->table; e->name; e++)
+        {
+            if(!strncmp(e->name, s, len) && !e->name[len])
+            {
+                err = bind_int(field, d->size, e->value);
+                if(err != XML_ERROR_NONE) break;
+                return 0;
+            }
+        }
+        break;
+    }
+
+    case XML_BIND_STRING:
+    {
+        // text split by comments or CDATA is appended
+        char* end = memchr(field, 0, d->size);
+        int used = end ? (int)(end - field) : d->size;
+
+        if(len >= d->size - used)
+        {
+            xml_set_error(p, XML_ERROR_VALUE, "String value too long");
+            return 1;
+        }
+        memcpy(field + used, s, len);
+        field[used + len] = 0;
+        return 0;
+    }
+    }
+
+    if(err == XML_ERROR_RANGE) xml_set_error(p, err, "Value out of range");
+    else if(err == XML_ERROR_NO_MEMORY) xml_set_error(p, err, "No enough memory");
+    else xml_set_error(p, XML_ERROR_VALUE, "Invalid value");
+    return 1;
+}
+
+
+
+// arrays in arena are preceded by header with their capacity
+#define ARRAY_HEADER 16
+
+// append zeroed element to array of d in struct base
+// array is kept contiguous, full array grows in place if it is at end of
+// arena, otherwise it is moved to end of arena with double capacity, so
+// arrays filled alternately use linear arena space
+static char* bind_array_add(xml_binder_t* b, const xml_bind_t* d, char* base)
+{
+    char** items = (char**)(base + d->offset);
+    int* count = (int*)(base + d->count_offset);
+    int capacity = *items ? *(int*)(*items - ARRAY_HEADER) : 0;
+    int free_size = b->arena_size - b->arena_used;
+    char* e;
+
+    if(*count == capacity)
+    {
+        int grow = capacity ? capacity : 4;
+
+        if(grow > (INT_MAX - ARRAY_HEADER) / 2 / d->size) return 0;
+
+        if(*items && *items + capacity * d->size == b->arena + b->arena_used)
+        {
+            if(grow * d->size > free_size) return 0;
+            b->arena_used += grow * d->size;
+        }
+        else
+        {
+            // align to 16 bytes
+            int start = (b->arena_used + 15) & ~15;
+            int need = ARRAY_HEADER + (capacity + grow) * d->size;
+
+            if(start > b->arena_size || need > b->arena_size - start) return 0;
+
+            if(*count) memcpy(b->arena + start + ARRAY_HEADER, *items, *count * d->size);
+            *items = b->arena + start + ARRAY_HEADER;
+            b->arena_used = start + need;
+        }
+
+        *(int*)(*items - ARRAY_HEADER) = capacity + grow;
+    }
+
+    e = *items + *count * d->size;
+    memset(e, 0, d->size);
+    (*count)++;
+
+    return e;
+}
+
+
+
+// path of attribute is element path rel followed by /@name
+static int match_attr(const char* path, const char* rel, const char* name, int len)
+{
+    int n = (int)strlen(rel);
+
+    if(n)
+    {
+        if(strncmp(path, rel, n) || path[n] != '/') return 0;
+        path += n + 1;
+    }
+
+    return path[0] == '@' && !strncmp(path + 1, name, len) && !path[len + 1];
+}
+
+
+
+static void bind_start_element(xml_parser_t* p)
+{
+    xml_binder_t* b = p->user_ptr;
+    xml_bind_frame_t* f = b->frames + b->depth - 1;
+    const xml_bind_t* d;
+    const char* rel;
+    char* attr_string;
+    xml_attr_t a;
+    int len = (int)strlen(p->tag);
+    int start;
+
+    if(p->level >= XML_BIND_LEVELS) return;
+
+    // append element name to path
+    start = b->path_len[p->level - 1];
+    if(start + len + 2 > XML_BIND_PATH)
+    {
+        b->path_len[p->level] = start;
+        xml_set_error(p, XML_ERROR_NO_MEMORY, "Element path too long");
+        return;
+    }
+    if(start) b->path[start++] = '/';
+    memcpy(b->path + start, p->tag, len + 1);
+    b->path_len[p->level] = start + len;
+
+    rel = b->path + f->path_len;
+    if(*rel == '/') rel++;
+
+    // repeated element starts new array element
+    for(d = f->table; d->path; d++)
+    {
+        if(d->type == XML_BIND_ARRAY && !strcmp(d->path, rel))
+        {
+            char* e;
+
+            if(b->depth == XML_BIND_DEPTH)
+            {
+                xml_set_error(p, XML_ERROR_NO_MEMORY, "Too many nested arrays");
+                return;
+            }
+
+            e = bind_array_add(b, d, f->base);
+            if(!e)
+            {
+                xml_set_error(p, XML_ERROR_NO_MEMORY, "No enough memory in arena");
+                return;
+            }
+
+            f = b->frames + b->depth++;
+            f->table = d->table;
+            f->base = e;
+            f->level = p->level;
+            f->path_len = b->path_len[p->level];
+            rel = "";
+            break;
+        }
+    }
+
+    // attributes are converted in place from attribute string, raw values of
+    // lazy attributes are decoded in place, their closing quote is already passed
+    attr_string = p->attr;
+    while(attr_string && xml_next_attr(&attr_string, &a))
+    {
+        if(p->options & XML_OPTION_LAZY_ATTRS)
+        {
+            a.value_len = xml_attr_decode(&a, a.value, a.value_len + 1);
+            if(a.value_len < 0)
+            {
+                xml_set_error(p, XML_ERROR_VALUE, "Invalid value");
+                return;
+            }
+        }
+
+        for(d = f->table; d->path; d++)
+        {
+            if(d->type != XML_BIND_ARRAY && match_attr(d->path, rel, a.name, a.name_len))
+            {
+                if(bind_value(p, d, f->base, a.value, a.value_len)) return;
+            }
+        }
+    }
+
+    // element text
+    for(d = f->table; d->path; d++)
+    {
+        if(d->type != XML_BIND_ARRAY && !strcmp(d->path, rel))
+        {
+            b->text = d;
+            b->text_base = f->base;
+            b->text_level = p->level;
+            break;
+        }
+    }
+}
+
+
+
+static void bind_end_element(xml_parser_t* p)
+{
+    xml_binder_t* b = p->user_ptr;
+    int level = p->level + 1;
+
+    if(level >= XML_BIND_LEVELS) return;
+
+    if(b->text && b->text_level == level) b->text = 0;
+    if(b->depth > 1 && b->frames[b->depth - 1].level == level) b->depth--;
+
+    b->path[b->path_len[level - 1]] = 0;
+}
+
+
+
+// parser text is raw, references are decoded in place
+static void bind_characters(xml_parser_t* p)
+{
+    xml_binder_t* b = p->user_ptr;
+    int len;
+
+    if(!b->text || b->text_level != p->level) return;
+
+    len = xml_text_decode(p->chars, (int)strlen(p->chars));
+    if(bind_value(p, b->text, b->text_base, p->chars, len)) b->text = 0;
+}
+
+
+
+static void bind_cdata(xml_parser_t* p)
+{
+    xml_binder_t* b = p->user_ptr;
+
+    if(b->text && b->text_level == p->level && bind_value(p, b->text, b->text_base, p->cdata, (int)strlen(p->cdata))) b->text = 0;
+}
+
+
+
+void xml_bind_init(xml_binder_t* b, const xml_bind_t* table, void* root, char* arena, int arena_size)
+{
+    b->user_ptr = 0;
+    b->arena = arena;
+    b->arena_size = arena ? arena_size : 0;
+    b->arena_used = 0;
+    b->depth = 1;
+    b->frames[0].table = table;
+    b->frames[0].base = root;
+    b->frames[0].level = 0;
+    b->frames[0].path_len = 0;
+    b->text = 0;
+    b->text_base = 0;
+    b->text_level = 0;
+    b->path[0] = 0;
+    b->path_len[0] = 0;
+}
+
+
+
+void xml_bind_attach(xml_binder_t* b, xml_parser_t* p)
+{
+    p->user_ptr = b;
+    xml_set_handler(p, bind_start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, bind_end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, bind_characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, bind_cdata, XML_CDATA_HANDLER);
+}
@@ -0,0 +1,145 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlbind.h
+// binding of elements and attributes to C structs with descriptor tables
+//
+// paths in descriptor table are relative to element bound to the struct
+// (for root table relative to the document):
+//     "Tools/Tool/@Timeout"    attribute Timeout of element Tools/Tool
+//     "@Name"                  attribute Name of bound element itself
+//     "Tools/Tool/Description" text of element
+//     "Tools/Tool"             repeated element bound to array (XML_BIND_ARRAY)
+//
+//     static const xml_bind_t tool_table[] =
+//     {
+//         XML_BIND_FIELD("@Filename", XML_BIND_STRING, tool_t, filename),
+//         XML_BIND_FIELD("@Timeout", XML_BIND_INT, tool_t, timeout),
+//         XML_BIND_FIELD("@AllowRemote", XML_BIND_BOOL, tool_t, allow_remote),
+//         XML_BIND_END
+//     };
+//
+//     static const xml_bind_t profile_table[] =
+//     {
+//         XML_BIND_ARRAY("Profile/Tools/Tool", profile_t, tools, tool_count, tool_t, tool_table),
+//         XML_BIND_END
+//     };
+
+#ifndef __XMLBIND_H__
+#define __XMLBIND_H__
+
+#include <stddef.h>
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max depth of nested arrays
+#define XML_BIND_DEPTH  16
+
+// max length of element path and max element level that is bound
+#define XML_BIND_PATH   256
+#define XML_BIND_LEVELS 64
+
+// descriptor types
+enum
+{
+    XML_BIND_INT = 1,   // signed integer of field size
+    XML_BIND_FLOAT,     // float or double
+    XML_BIND_BOOL,      // integer of field size, "true", "yes", "1" are 1, "false", "no", "0" are 0
+    XML_BIND_ENUM,      // integer of field size, value from xml_bind_enum_t table
+    XML_BIND_STRING,    // zero terminated char array of field size
+    XML_BIND_ARRAY,     // pointer to array of structs allocated in arena and int count
+};
+
+typedef struct xml_bind_s xml_bind_t;
+typedef struct xml_bind_enum_s xml_bind_enum_t;
+typedef struct xml_bind_frame_s xml_bind_frame_t;
+typedef struct xml_binder_s xml_binder_t;
+
+struct xml_bind_s
+{
+    const char* path;
+    int type;
+    size_t offset;
+    int size;               // field size or array element size
+    const void* table;      // xml_bind_enum_t table or xml_bind_t table of array element
+    size_t count_offset;    // offset of int count of array elements
+};
+
+// enum table ends with name 0
+struct xml_bind_enum_s
+{
+    const char* name;
+    int value;
+};
+
+#define XML_BIND_FIELD(path, type, st, field) \
+    { (path), (type), offsetof(st, field), (int)sizeof(((st*)0)->field), 0, 0 }
+
+#define XML_BIND_ENUM_FIELD(path, st, field, enum_table) \
+    { (path), XML_BIND_ENUM, offsetof(st, field), (int)sizeof(((st*)0)->field), (enum_table), 0 }
+
+#define XML_BIND_ARRAY(path, st, field, count_field, element_st, element_table) \
+    { (path), XML_BIND_ARRAY, offsetof(st, field), (int)sizeof(element_st), (element_table), offsetof(st, count_field) }
+
+#define XML_BIND_END { 0, 0, 0, 0, 0, 0 }
+
+struct xml_bind_frame_s
+{
+    const xml_bind_t* table;
+    char* base;
+    int level;
+    int path_len;
+};
+
+struct xml_binder_s
+{
+    void* user_ptr;
+    char* arena;
+    int arena_size;
+    int arena_used;
+    int depth;
+    xml_bind_frame_t frames[XML_BIND_DEPTH];
+    const xml_bind_t* text;     // descriptor of element text being bound
+    char* text_base;
+    int text_level;
+    char path[XML_BIND_PATH];
+    int path_len[XML_BIND_LEVELS];
+};
+
+
+// bind document to root struct described by table
+// arrays of repeated elements are allocated from arena
+void xml_bind_init(xml_binder_t* b, const xml_bind_t* table, void* root, char* arena, int arena_size);
+
+// set handlers of p, p->user_ptr is set to b
+void xml_bind_attach(xml_binder_t* b, xml_parser_t* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLBIND_H__
@@ -0,0 +1,329 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlc14n.c
+
+#include <string.h>
+#include "xmlc14n.h"
+
+
+// char classes, chars that are escaped in text and in attribute values
+enum
+{
+    ESC_TEXT    = 1,
+    ESC_ATTR    = 2,
+};
+
+static const unsigned char esc_class[256] =
+{
+    ['&'] = ESC_TEXT | ESC_ATTR,
+    ['<'] = ESC_TEXT | ESC_ATTR,
+    ['>'] = ESC_TEXT,
+    ['"'] = ESC_ATTR,
+    ['\t'] = ESC_ATTR,
+    ['\n'] = ESC_ATTR,
+    ['\r'] = ESC_TEXT | ESC_ATTR,
+};
+
+
+
+static void c14n_write(xml_c14n_t* c, const char* data, int len)
+{
+    if(!len) return;
+
+    xml_hash_update(&c->state, data, len);
+    if(c->write_handler) c->write_handler(c, data, len);
+}
+
+
+
+static void c14n_puts(xml_c14n_t* c, const char* str)
+{
+    c14n_write(c, str, (int)strlen(str));
+}
+
+
+
+static const char* c14n_escape(int ch)
+{
+    switch(ch)
+    {
+    case '&':   return "&amp;";
+    case '<':   return "&lt;";
+    case '>':   return "&gt;";
+    case '"':   return "&quot;";
+    case '\t':  return "&#x9;";
+    case '\n':  return "&#xA;";
+    default:    return "&#xD;";
+    }
+}
+
+
+
+// write escaped text or attribute value, if decode is set references are
+// replaced by chars first; malformed references are written as text
+static void c14n_value(xml_c14n_t* c, const char* s, int len, int decode, int esc)
+{
+    const char* end = s + len;
+    const char* run = s;
+
+    while(s < end)
+    {
+        int ch = (unsigned char)*s;
+
+        if(!(esc_class[ch] & esc))
+        {
+            s++;
+            continue;
+        }
+
+        c14n_write(c, run, (int)(s - run));
+
+        if(ch == '&' && decode)
+        {
+            const char* semi = memchr(s, ';', end - s < 12 ? end - s : 12);
+
+            if(semi)
+            {
+                xml_attr_t ref;
+                char buf[8];
+                int n;
+
+                ref.value = (char*)s;
+                ref.value_len = (int)(semi - s + 1);
+                n = xml_attr_decode(&ref, buf, sizeof(buf));
+
+                if(n > 0)
+                {
+                    c14n_value(c, buf, n, 0, esc);
+                    s = run = semi + 1;
+                    continue;
+                }
+            }
+        }
+
+        c14n_puts(c, c14n_escape(ch));
+        s = run = s + 1;
+    }
+
+    c14n_write(c, run, (int)(s - run));
+}
+
+
+
+static int c14n_compare(const xml_attr_t* a, const xml_attr_t* b)
+{
+    int len = a->name_len < b->name_len ? a->name_len : b->name_len;
+    int r = memcmp(a->name, b->name, len);
+
+    return r ? r : a->name_len - b->name_len;
+}
+
+
+
+// lazy attribute string is not checked by parser, names with whitespace are
+// junk between attributes
+static int c14n_has_space(const char* s, int len)
+{
+    while(len--)
+    {
+        if(*s == ' ' || *s == '\t' || *s == '\n') return 1;
+        s++;
+    }
+
+    return 0;
+}
+
+
+
+// report error without changing p->tag, record is dropped
+static void c14n_error(xml_c14n_t* c, xml_parser_t* p, int err_code, const char* str)
+{
+    char* tag = p->tag;
+
+    c->in_record = 0;
+    xml_set_error(p, err_code, str);
+    p->tag = tag;
+}
+
+
+
+static void c14n_start_element(xml_parser_t* p)
+{
+    xml_c14n_t* c = p->user_ptr;
+    xml_attr_t attrs[XML_C14N_ATTRS];
+    xml_attr_t a;
+    char* attr_string = p->attr;
+    int decode = (p->options & XML_OPTION_LAZY_ATTRS) != 0;
+    int n = 0, i;
+
+    // record of document that ended with error is dropped
+    if(p->level == 1) c->in_record = 0;
+
+    if(!c->in_record)
+    {
+        if(p->level != c->record_level) return;
+
+        c->in_record = 1;
+        xml_hash_init(&c->state, c->seed);
+    }
+
+    // insertion sort, attributes with same name keep document order
+    while(attr_string && xml_next_attr(&attr_string, &a))
+    {
+        if(!a.name_len || c14n_has_space(a.name, a.name_len))
+        {
+            c14n_error(c, p, XML_ERROR_MALFORMED, "Malformed attribute");
+            return;
+        }
+
+        if(n == XML_C14N_ATTRS)
+        {
+            c14n_error(c, p, XML_ERROR_ATTRS, "Too many attributes");
+            return;
+        }
+
+        for(i = n++; i > 0 && c14n_compare(attrs + i - 1, &a) > 0; i--) attrs[i] = attrs[i - 1];
+        attrs[i] = a;
+    }
+
+    // anything left after last attribute would otherwise be dropped silently
+    if(attr_string && attr_string[strspn(attr_string, " \t\n")])
+    {
+        c14n_error(c, p, XML_ERROR_MALFORMED, "Malformed attribute");
+        return;
+    }
+
+    c14n_write(c, "<", 1);
+    c14n_puts(c, p->tag);
+
+    for(i = 0; i < n; i++)
+    {
+        c14n_write(c, " ", 1);
+        c14n_write(c, attrs[i].name, attrs[i].name_len);
+        c14n_write(c, "=\"", 2);
+        c14n_value(c, attrs[i].value, attrs[i].value_len, decode, ESC_ATTR);
+        c14n_write(c, "\"", 1);
+    }
+
+    c14n_write(c, ">", 1);
+}
+
+
+
+static void c14n_end_element(xml_parser_t* p)
+{
+    xml_c14n_t* c = p->user_ptr;
+
+    if(!c->in_record) return;
+
+    c14n_write(c, "</", 2);
+    c14n_puts(c, p->tag);
+    c14n_write(c, ">", 1);
+
+    if(p->level == c->record_level - 1)
+    {
+        c->in_record = 0;
+        c->hash = xml_hash_final(&c->state);
+        c->count++;
+        if(c->record_handler) c->record_handler(c);
+    }
+}
+
+
+
+static void c14n_characters(xml_parser_t* p)
+{
+    xml_c14n_t* c = p->user_ptr;
+
+    if(c->in_record) c14n_value(c, p->chars, (int)strlen(p->chars), 1, ESC_TEXT);
+}
+
+
+
+static void c14n_cdata(xml_parser_t* p)
+{
+    xml_c14n_t* c = p->user_ptr;
+
+    if(c->in_record) c14n_value(c, p->cdata, (int)strlen(p->cdata), 0, ESC_TEXT);
+}
+
+
+
+// target and data are separated by one space
+static void c14n_pi(xml_parser_t* p)
+{
+    xml_c14n_t* c = p->user_ptr;
+    const char* pi = p->pi;
+    int len = (int)strcspn(pi, " \t\n");
+
+    if(!c->in_record) return;
+
+    c14n_write(c, "<?", 2);
+    c14n_write(c, pi, len);
+
+    pi += len;
+    pi += strspn(pi, " \t\n");
+    if(*pi)
+    {
+        c14n_write(c, " ", 1);
+        c14n_puts(c, pi);
+    }
+
+    c14n_write(c, "?>", 2);
+}
+
+
+
+void xml_c14n_init(xml_c14n_t* c, uint64_t seed)
+{
+    c->user_ptr = 0;
+    c->seed = seed;
+    c->record_level = 1;
+    c->in_record = 0;
+    c->hash = 0;
+    c->count = 0;
+    c->record_handler = 0;
+    c->write_handler = 0;
+}
+
+
+
+void xml_c14n_set_record_level(xml_c14n_t* c, int level)
+{
+    c->record_level = level;
+}
+
+
+
+void xml_c14n_attach(xml_c14n_t* c, xml_parser_t* p)
+{
+    p->user_ptr = c;
+    xml_set_option(p, XML_OPTION_LAZY_ATTRS, 1);
+    xml_set_handler(p, c14n_start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, c14n_end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, c14n_characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, c14n_cdata, XML_CDATA_HANDLER);
+    xml_set_handler(p, c14n_pi, XML_PI_HANDLER);
+}
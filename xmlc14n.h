@@ -0,0 +1,89 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlc14n.h
+// streaming canonicalization of xml driven by parser handlers, canonical
+// bytes are passed to incremental hash as they are produced, so documents or
+// records that differ only in attribute order, quotes, references or empty
+// element syntax get the same hash
+//
+// canonical form is similar to C14N without comments:
+//     <a b='1' a="&#65;"/>        <a a="A" b="1"></a>
+//
+// attributes are sorted by name, values are written in double quotes,
+// references in text and attributes are replaced by chars and only
+// & < > " and whitespace in attributes are escaped; CDATA is written as text;
+// processing instructions are kept, comments are dropped
+// set XML_OPTION_SKIP_WHITESPACE on parser to ignore indentation too
+//
+// there is no namespace processing, prefixes are part of names
+
+#ifndef __XMLC14N_H__
+#define __XMLC14N_H__
+
+#include <stdint.h>
+#include "xmlparser.h"
+#include "xmlhash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max number of attributes of one element
+#define XML_C14N_ATTRS  64
+
+typedef struct xml_c14n_s xml_c14n_t;
+
+struct xml_c14n_s
+{
+    void* user_ptr;
+    uint64_t seed;
+    int record_level;
+    int in_record;
+    uint64_t hash;          // hash of last record, valid in record_handler
+    long long count;        // number of hashed records
+    xml_hash_t state;
+    void (*record_handler)(xml_c14n_t* c);
+    // optional, receives canonical bytes of records
+    void (*write_handler)(xml_c14n_t* c, const char* data, int len);
+};
+
+
+void xml_c14n_init(xml_c14n_t* c, uint64_t seed);
+
+// every element at record level is hashed with its subtree, handler is called
+// at end of element; default record level is 1, one hash per document
+void xml_c14n_set_record_level(xml_c14n_t* c, int level);
+
+// set handlers of p, p->user_ptr is set to c
+// XML_OPTION_LAZY_ATTRS is set, attribute values are decoded by c14n because
+// parser stores char references above 0x7F truncated to one char; malformed
+// attributes are reported with XML_ERROR_MALFORMED and their record is dropped
+void xml_c14n_attach(xml_c14n_t* c, xml_parser_t* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLC14N_H__
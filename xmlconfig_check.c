@@ -0,0 +1,282 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlconfig_check.c
+// prints event stream of xml files for comparison of feature configurations
+//
+//     xmlconfig_check [-c] [-p] [-d] [-s] file ...
+//
+//     -c          do not print comment events
+//     -p          do not print PI events
+//     -d          do not print CDATA events
+//     -s          print sizeof(xml_parser_t) and exit
+//
+// every file is parsed with xml_parse_buffer, with xml_parse_string and in
+// chunks of 1 to 39 bytes; program fails if events of these modes differ,
+// so output of build with XML_NO_* macros can be compared with output of full
+// build run with options that drop events of disabled features, see
+// xmlconfig_matrix.sh
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xmlparser.h"
+
+
+#define EVENTS_SIZE (1 << 22)
+
+static char* events;
+static int events_len;
+static int print_comments = 1;
+static int print_pis = 1;
+static int print_cdata = 1;
+
+
+static void add_event(const char* type, int level, const char* s1, const char* s2)
+{
+    int n = snprintf(events + events_len, EVENTS_SIZE - events_len, "%s %d %s%s%s\n",
+        type, level, s1 ? s1 : "", s2 ? " " : "", s2 ? s2 : "");
+
+    if(n > 0 && events_len + n < EVENTS_SIZE) events_len += n;
+}
+
+
+
+static void start_element(xml_parser_t* p)
+{
+    add_event("START", p->level, p->tag, p->attr);
+}
+
+
+
+static void end_element(xml_parser_t* p)
+{
+    add_event("END", p->level, p->tag, 0);
+}
+
+
+
+static void characters(xml_parser_t* p)
+{
+    add_event("TEXT", p->level, p->chars, 0);
+}
+
+
+
+static void error(xml_parser_t* p)
+{
+    char code[16];
+
+    sprintf(code, "%d", p->errorcode);
+    add_event("ERROR", p->level, code, p->errorstr);
+}
+
+
+
+#ifndef XML_NO_COMMENTS
+static void comment(xml_parser_t* p)
+{
+    if(print_comments) add_event("COMMENT", p->level, p->comment, 0);
+}
+#endif
+
+
+
+#ifndef XML_NO_PI
+static void pi(xml_parser_t* p)
+{
+    if(print_pis) add_event("PI", p->level, p->pi, 0);
+}
+#endif
+
+
+
+#ifndef XML_NO_CDATA
+static void cdata(xml_parser_t* p)
+{
+    if(print_cdata) add_event("CDATA", p->level, p->cdata, 0);
+}
+#endif
+
+
+
+static void init_parser(xml_parser_t* p, char* pool, int pool_size)
+{
+    xml_init(p, pool, pool_size);
+    xml_set_handler(p, (void*)start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, (void*)end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, (void*)characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, (void*)error, XML_ERROR_HANDLER);
+#ifndef XML_NO_COMMENTS
+    xml_set_handler(p, (void*)comment, XML_COMMENT_HANDLER);
+#endif
+#ifndef XML_NO_PI
+    xml_set_handler(p, (void*)pi, XML_PI_HANDLER);
+#endif
+#ifndef XML_NO_CDATA
+    xml_set_handler(p, (void*)cdata, XML_CDATA_HANDLER);
+#endif
+    events_len = 0;
+}
+
+
+
+static char* read_file(const char* path, int* len)
+{
+    FILE* f = fopen(path, "rb");
+    char* buf = 0;
+    long n;
+
+    if(!f) return 0;
+
+    if(!fseek(f, 0, SEEK_END) && (n = ftell(f)) >= 0 && !fseek(f, 0, SEEK_SET))
+    {
+        buf = malloc(n + 1);
+        if(buf && fread(buf, 1, n, f) != (size_t)n)
+        {
+            free(buf);
+            buf = 0;
+        }
+        if(buf)
+        {
+            buf[n] = 0;
+            *len = (int)n;
+        }
+    }
+
+    fclose(f);
+    return buf;
+}
+
+
+
+// parse doc in chunks of chunk_size bytes, unconsumed bytes are passed again
+static void parse_chunks(xml_parser_t* p, const char* doc, int len, char* buf, int chunk_size)
+{
+    int have = 0, pos = 0, take, n;
+
+    for(;;)
+    {
+        take = len - pos < chunk_size ? len - pos : chunk_size;
+        memcpy(buf + have, doc + pos, take);
+        have += take;
+        pos += take;
+
+        n = xml_parse_chunk(p, buf, have, pos == len);
+        if(n < 0 || pos == len) break;
+
+        memmove(buf, buf + n, have - n);
+        have -= n;
+    }
+}
+
+
+
+// returns 0 if all parsing modes gave the same events
+static int check_file(const char* path)
+{
+    static char pool[1 << 16];
+    static char* ref;
+    xml_parser_t p;
+    char* doc;
+    char* copy;
+    char* buf;
+    int len, ref_len, chunk_size, failed = 0;
+
+    doc = read_file(path, &len);
+    if(!doc)
+    {
+        fprintf(stderr, "%s: can not read file\n", path);
+        return 1;
+    }
+
+    copy = malloc(len + 1);
+    buf = malloc(len + 1);
+    if(!ref) ref = malloc(EVENTS_SIZE);
+    if(!copy || !buf || !ref)
+    {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return 1;
+    }
+
+    // xml_parse_buffer and xml_parse_string modify input
+    memcpy(copy, doc, len + 1);
+    init_parser(&p, pool, sizeof(pool));
+    xml_parse_buffer(&p, copy, len);
+    memcpy(ref, events, events_len);
+    ref_len = events_len;
+
+    memcpy(copy, doc, len + 1);
+    init_parser(&p, pool, sizeof(pool));
+    xml_parse_string(&p, copy);
+    if(events_len != ref_len || memcmp(events, ref, ref_len))
+    {
+        fprintf(stderr, "%s: xml_parse_string events differ\n", path);
+        failed = 1;
+    }
+
+    for(chunk_size = 1; chunk_size < 40; chunk_size++)
+    {
+        init_parser(&p, pool, sizeof(pool));
+        parse_chunks(&p, doc, len, buf, chunk_size);
+        if(events_len != ref_len || memcmp(events, ref, ref_len))
+        {
+            fprintf(stderr, "%s: events of %d byte chunks differ\n", path, chunk_size);
+            failed = 1;
+        }
+    }
+
+    printf("FILE %s\n%.*s", path, ref_len, ref);
+
+    free(doc);
+    free(copy);
+    free(buf);
+    return failed;
+}
+
+
+
+int main(int argc, char** argv)
+{
+    int i, failed = 0;
+
+    events = malloc(EVENTS_SIZE);
+    if(!events) return 1;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-c")) print_comments = 0;
+        else if(!strcmp(argv[i], "-p")) print_pis = 0;
+        else if(!strcmp(argv[i], "-d")) print_cdata = 0;
+        else if(!strcmp(argv[i], "-s"))
+        {
+            printf("%d\n", (int)sizeof(xml_parser_t));
+            return 0;
+        }
+        else failed |= check_file(argv[i]);
+    }
+
+    free(events);
+    return failed;
+}
@@ -0,0 +1,82 @@
+#!/bin/sh
+
+# xmlconfig_matrix.sh
+# builds parser and all modules with every XML_NO_* feature macro, prints
+# xmlparser.o text size and sizeof(xml_parser_t) of each configuration and
+# compares its event stream with full build, see xmlconfig_check.c
+#
+#     ./xmlconfig_matrix.sh [file ...]
+#
+# files default to test/*.xml; CC and CFLAGS can be set in environment
+
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-Wall"}
+OUT=${TMPDIR:-/tmp}/xmlconfig.$$
+MODULES="xmlparser.c xmltape.c xmlindex.c xmlwriter.c xmlpipe.c xmlinclude.c xmlbind.c xmlnum.c
+    xmlzip.c xmljson.c xmlshred.c xmldom.c xmlc14n.c xmlvalid.c xmlhash.c xmldiff.c xmlprofile.c"
+ALL="-DXML_NO_COMMENTS -DXML_NO_PI -DXML_NO_CDATA -DXML_NO_CHAR_REFS -DXML_NO_RECOVER"
+FAILED=0
+
+cd "$(dirname "$0")" || exit 1
+[ $# -gt 0 ] || set -- test/*.xml
+mkdir -p "$OUT" || exit 1
+trap 'rm -rf "$OUT"' EXIT
+
+if ! $CC $CFLAGS -O2 xmlconfig_check.c xmlparser.c -o "$OUT/full"; then
+    echo "full build failed"
+    exit 1
+fi
+
+# text size of xmlparser.o
+text_size()
+{
+    $CC $CFLAGS $1 $2 -c xmlparser.c -o "$OUT/xmlparser.o" && size "$OUT/xmlparser.o" | awk 'NR == 2 { print $1 }'
+}
+
+printf "%-18s %8s %8s %8s  %s\n" "configuration" "-O2" "-Os" "struct" "events"
+
+for config in "" -DXML_NO_COMMENTS -DXML_NO_PI -DXML_NO_CDATA -DXML_NO_CHAR_REFS -DXML_NO_RECOVER "$ALL"; do
+    name=${config:-default}
+    [ "$config" = "$ALL" ] && name="all of the above"
+
+    # every module has to build, xmlinclude needs PIs
+    for module in $MODULES; do
+        case "$config" in *XML_NO_PI*) [ "$module" = xmlinclude.c ] && continue ;; esac
+        if ! $CC $CFLAGS -O2 $config -c $module -o "$OUT/module.o"; then
+            echo "$name: $module does not build"
+            FAILED=1
+        fi
+    done
+
+    if ! $CC $CFLAGS -O2 $config xmlconfig_check.c xmlparser.c -o "$OUT/check"; then
+        echo "$name: xmlconfig_check does not build"
+        FAILED=1
+        continue
+    fi
+
+    # events of disabled features are dropped from full build output,
+    # CDATA is malformed input without CDATA support
+    options=""
+    files=""
+    case "$config" in *XML_NO_COMMENTS*) options="$options -c" ;; esac
+    case "$config" in *XML_NO_PI*) options="$options -p" ;; esac
+    case "$config" in *XML_NO_CDATA*) options="$options -d" ;; esac
+    for file in "$@"; do
+        case "$config" in *XML_NO_CDATA*) grep -q "<!\[CDATA\[" "$file" && continue ;; esac
+        case "$config" in *XML_NO_CHAR_REFS*) grep -q "&#" "$file" && continue ;; esac
+        files="$files $file"
+    done
+
+    "$OUT/full" $options $files > "$OUT/full.txt"
+    if "$OUT/check" $options $files > "$OUT/check.txt" && cmp -s "$OUT/full.txt" "$OUT/check.txt"; then
+        events=same
+    else
+        events=DIFFERENT
+        FAILED=1
+    fi
+
+    printf "%-18s %8s %8s %8s  %s\n" "$name" "$(text_size -O2 "$config")" "$(text_size -Os "$config")" \
+        "$("$OUT/check" -s)" "$events"
+done
+
+exit $FAILED
@@ -0,0 +1,1043 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmldiff.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xmldiff.h"
+#include "xmlc14n.h"
+
+
+typedef struct diff_node_s diff_node_t;
+typedef struct diff_record_s diff_record_t;
+typedef struct diff_count_s diff_count_t;
+typedef struct diff_side_s diff_side_t;
+
+// element of record, offsets are in canonical bytes of record
+struct diff_node_s
+{
+    int start;
+    int head_end;           // end of start tag
+    int end;
+    int name_len;
+    int child;              // first child or -1
+    int next;               // next sibling or -1
+    uint64_t head;          // hash of start tag and text of element
+};
+
+// record or start tag of element above record level, start tags keep
+// structure above records in the stream of compared items
+struct diff_record_s
+{
+    char* bytes;
+    int len;
+    diff_node_t* nodes;     // in document order, record element is first
+    int node_count;
+    char* path;
+    int head;               // bytes are start tag of element above record level
+    uint64_t parent;        // hash of names of ancestors
+    uint64_t hash;          // hash of bytes seeded with parent
+};
+
+// number of siblings with same name
+struct diff_count_s
+{
+    uint64_t name;
+    int count;
+};
+
+struct diff_count_list_s
+{
+    diff_count_t* items;
+    int used;
+    int size;
+};
+
+// parser and buffered records of one document
+struct diff_side_s
+{
+    xml_diff_t* d;
+    int index;
+    xml_parser_t p;
+    xml_c14n_t c;
+    void (*c14n_start)(xml_parser_t* p);
+    void (*c14n_end)(xml_parser_t* p);
+    void (*c14n_characters)(xml_parser_t* p);
+#ifndef XML_NO_CDATA
+    void (*c14n_cdata)(xml_parser_t* p);
+#endif
+#ifndef XML_NO_PI
+    void (*c14n_pi)(xml_parser_t* p);
+#endif
+    char* pool;
+    int no_memory;
+    int done;
+    // buffer input
+    char* src;
+    size_t src_size;
+    size_t src_pos;
+    size_t want;
+    // file input
+    FILE* f;
+    char* block;
+    int block_len;
+    int block_size;
+    // canonical bytes and elements of current record
+    char* buf;
+    int len;
+    int size;
+    diff_node_t* nodes;
+    int node_count;
+    int node_size;
+    int in_record;
+    int depth;
+    struct
+    {
+        int node;
+        int last;           // last child or -1
+        xml_hash_t head;
+    }
+    stack[XML_DIFF_DEPTH];
+    // finished records, oldest is records[first]
+    diff_record_t* records;
+    int first;
+    int count;
+    int records_size;
+    // start tag of document element
+    char* root;
+    int root_len;
+    // path of open elements up to record level, hashes of their names without
+    // indices, children counts of open elements
+    char path[XML_DIFF_PATH];
+    int path_len[XML_DIFF_LEVELS + 1];
+    uint64_t names[XML_DIFF_LEVELS + 1];
+    struct diff_count_list_s counts[XML_DIFF_LEVELS];
+    // path of compared element and value of update
+    char* edit_path;
+    int edit_len;
+    int edit_size;
+    char* value;
+    int value_size;
+};
+
+
+
+static int diff_grow(void** ptr, int* size, int need, int item_size)
+{
+    int n = *size ? *size : 64;
+    void* tmp;
+
+    if(need <= *size) return 1;
+    while(n < need) n *= 2;
+
+    tmp = realloc(*ptr, (size_t)n * item_size);
+    if(!tmp) return 0;
+
+    *ptr = tmp;
+    *size = n;
+    return 1;
+}
+
+
+
+static uint64_t diff_name_hash(const char* name, int len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+
+    for(i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)name[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+
+
+// increment and return count of name in list, returns 0 if there is no memory
+static int diff_count(struct diff_count_list_s* l, const char* name, int len)
+{
+    uint64_t h = diff_name_hash(name, len);
+    int i;
+
+    // siblings usually have few distinct names
+    for(i = 0; i < l->used; i++)
+    {
+        if(l->items[i].name == h) return ++l->items[i].count;
+    }
+
+    if(!diff_grow((void**)&l->items, &l->size, l->used + 1, sizeof(diff_count_t))) return 0;
+
+    l->items[l->used].name = h;
+    l->items[l->used].count = 1;
+    l->used++;
+
+    return 1;
+}
+
+
+
+// append "/name[index]" to path, document element has no index
+static int diff_segment(char* path, int len, int size, const char* name, int name_len, int index)
+{
+    int n;
+
+    if(!len) n = snprintf(path, size, "%.*s", name_len, name);
+    else n = snprintf(path + len, size - len, "/%.*s[%d]", name_len, name, index);
+
+    return n < 0 || n >= size - len ? -1 : len + n;
+}
+
+
+
+static void diff_write(xml_c14n_t* c, const char* data, int len)
+{
+    diff_side_t* s = c->user_ptr;
+
+    if(!diff_grow((void**)&s->buf, &s->size, s->len + len, 1))
+    {
+        s->no_memory = 1;
+        return;
+    }
+
+    memcpy(s->buf + s->len, data, len);
+    s->len += len;
+}
+
+
+
+// store canonical bytes and nodes of element at level as new record
+static void diff_add_record(diff_side_t* s, int level, int head)
+{
+    xml_diff_t* d = s->d;
+    diff_record_t* r;
+
+    // drop records that were popped
+    if(s->first && s->first + s->count == s->records_size)
+    {
+        memmove(s->records, s->records + s->first, s->count * sizeof(diff_record_t));
+        s->first = 0;
+    }
+
+    if(!diff_grow((void**)&s->records, &s->records_size, s->first + s->count + 1, sizeof(diff_record_t)))
+    {
+        s->no_memory = 1;
+        return;
+    }
+
+    r = s->records + s->first + s->count;
+    r->len = s->len;
+    r->node_count = s->node_count;
+    r->bytes = malloc(s->len);
+    r->nodes = malloc(s->node_count * sizeof(diff_node_t));
+    r->path = malloc(s->path_len[level] + 1);
+
+    if(!r->bytes || !r->nodes || !r->path)
+    {
+        free(r->bytes);
+        free(r->nodes);
+        free(r->path);
+        s->no_memory = 1;
+        return;
+    }
+
+    memcpy(r->bytes, s->buf, s->len);
+    memcpy(r->nodes, s->nodes, s->node_count * sizeof(diff_node_t));
+    memcpy(r->path, s->path, s->path_len[level]);
+    r->path[s->path_len[level]] = 0;
+    r->head = head;
+    r->parent = s->names[level - 1];
+    r->hash = xml_hash(r->bytes, r->len, d->seed ^ r->parent);
+
+    s->count++;
+    s->len = 0;
+}
+
+
+
+static void diff_start_element(xml_parser_t* p)
+{
+    xml_c14n_t* c = p->user_ptr;
+    diff_side_t* s = c->user_ptr;
+    xml_diff_t* d = s->d;
+    int level = p->level;
+    int start, i;
+
+    if(level <= d->record_level)
+    {
+        int len = (int)strlen(p->tag);
+        int index = level > 1 ? diff_count(s->counts + level - 2, p->tag, len) : 1;
+
+        if(!index)
+        {
+            s->no_memory = 1;
+            return;
+        }
+
+        s->path_len[level] = diff_segment(s->path, level > 1 ? s->path_len[level - 1] : 0, XML_DIFF_PATH, p->tag, len, index);
+        if(s->path_len[level] < 0)
+        {
+            xml_set_error(p, XML_ERROR_RANGE, "Path too long");
+            return;
+        }
+
+        // parent of document element is names[0], zero
+        s->names[level] = (s->names[level - 1] ^ diff_name_hash(p->tag, len)) * 1099511628211ULL;
+
+        if(level < d->record_level) s->counts[level - 1].used = 0;
+        else
+        {
+            s->in_record = 1;
+            s->len = 0;
+            s->node_count = 0;
+            s->depth = 0;
+        }
+    }
+
+    start = s->len;
+    s->c14n_start(p);
+
+    if(!s->in_record)
+    {
+        if(level == 1 && !s->root)
+        {
+            s->root = malloc(s->len);
+            if(s->root) memcpy(s->root, s->buf, s->len);
+            else s->no_memory = 1;
+            s->root_len = s->len;
+        }
+        else if(level > 1 && level < d->record_level)
+        {
+            // start tag of element between document element and records
+            if(!diff_grow((void**)&s->nodes, &s->node_size, 1, sizeof(diff_node_t)))
+            {
+                s->no_memory = 1;
+                return;
+            }
+
+            s->nodes[0].start = start;
+            s->nodes[0].head_end = s->len;
+            s->nodes[0].end = s->len;
+            s->nodes[0].name_len = (int)strlen(p->tag);
+            s->nodes[0].child = -1;
+            s->nodes[0].next = -1;
+            s->node_count = 1;
+            diff_add_record(s, level, 1);
+        }
+
+        s->len = 0;
+        return;
+    }
+
+    if(!diff_grow((void**)&s->nodes, &s->node_size, s->node_count + 1, sizeof(diff_node_t)))
+    {
+        s->no_memory = 1;
+        return;
+    }
+
+    i = s->node_count++;
+    s->nodes[i].start = start;
+    s->nodes[i].head_end = s->len;
+    s->nodes[i].end = s->len;
+    s->nodes[i].name_len = (int)strlen(p->tag);
+    s->nodes[i].child = -1;
+    s->nodes[i].next = -1;
+
+    if(s->depth)
+    {
+        int parent = s->stack[s->depth - 1].node;
+        int last = s->stack[s->depth - 1].last;
+
+        if(last < 0) s->nodes[parent].child = i;
+        else s->nodes[last].next = i;
+        s->stack[s->depth - 1].last = i;
+    }
+
+    // depth is limited by parser
+    s->stack[s->depth].node = i;
+    s->stack[s->depth].last = -1;
+    xml_hash_init(&s->stack[s->depth].head, d->seed);
+    xml_hash_update(&s->stack[s->depth].head, s->buf + start, s->len - start);
+    s->depth++;
+}
+
+
+
+static void diff_end_element(xml_parser_t* p)
+{
+    xml_c14n_t* c = p->user_ptr;
+    diff_side_t* s = c->user_ptr;
+    diff_node_t* n;
+
+    s->c14n_end(p);
+
+    if(!s->in_record || !s->depth)
+    {
+        s->len = 0;
+        return;
+    }
+
+    s->depth--;
+    n = s->nodes + s->stack[s->depth].node;
+    n->end = s->len;
+    n->head = xml_hash_final(&s->stack[s->depth].head);
+
+    if(!s->depth)
+    {
+        s->in_record = 0;
+        diff_add_record(s, s->d->record_level, 0);
+    }
+}
+
+
+
+// text and PIs are part of element head, text above record level is dropped
+static void diff_text(xml_parser_t* p, void (*handler)(xml_parser_t* p))
+{
+    xml_c14n_t* c = p->user_ptr;
+    diff_side_t* s = c->user_ptr;
+    int start = s->len;
+
+    handler(p);
+
+    if(s->in_record && s->depth) xml_hash_update(&s->stack[s->depth - 1].head, s->buf + start, s->len - start);
+    else s->len = 0;
+}
+
+
+
+static void diff_characters(xml_parser_t* p)
+{
+    diff_side_t* s = ((xml_c14n_t*)p->user_ptr)->user_ptr;
+
+    diff_text(p, s->c14n_characters);
+}
+
+
+
+#ifndef XML_NO_CDATA
+static void diff_cdata(xml_parser_t* p)
+{
+    diff_side_t* s = ((xml_c14n_t*)p->user_ptr)->user_ptr;
+
+    diff_text(p, s->c14n_cdata);
+}
+#endif
+
+
+
+#ifndef XML_NO_PI
+static void diff_pi(xml_parser_t* p)
+{
+    diff_side_t* s = ((xml_c14n_t*)p->user_ptr)->user_ptr;
+
+    diff_text(p, s->c14n_pi);
+}
+#endif
+
+
+
+static void diff_error(xml_parser_t* p)
+{
+    diff_side_t* s = ((xml_c14n_t*)p->user_ptr)->user_ptr;
+    xml_diff_t* d = s->d;
+
+    if(d->errorcode) return;
+
+    d->errorcode = p->errorcode;
+    d->errorstr = p->errorstr;
+    d->error_doc = s->index;
+    d->error_pos = p->bytes;
+}
+
+
+
+static int diff_side_init(diff_side_t* s, xml_diff_t* d, int index)
+{
+    s->d = d;
+    s->index = index;
+    s->want = XML_DIFF_BLOCK;
+
+    s->pool = malloc(d->pool_size);
+    if(!s->pool) return XML_ERROR_NO_MEMORY;
+
+    xml_init(&s->p, s->pool, d->pool_size);
+    if(d->options) xml_set_option(&s->p, d->options, 1);
+    xml_set_limit(&s->p, XML_LIMIT_DEPTH, d->record_level + XML_DIFF_DEPTH - 1);
+
+    // c14n writes canonical bytes of whole document, diff handlers wrap c14n handlers
+    xml_c14n_init(&s->c, d->seed);
+    s->c.user_ptr = s;
+    s->c.write_handler = diff_write;
+    xml_c14n_attach(&s->c, &s->p);
+
+    s->c14n_start = s->p.start_element_handler;
+    s->c14n_end = s->p.end_element_handler;
+    s->c14n_characters = s->p.characters_handler;
+    s->p.start_element_handler = diff_start_element;
+    s->p.end_element_handler = diff_end_element;
+    s->p.characters_handler = diff_characters;
+#ifndef XML_NO_CDATA
+    s->c14n_cdata = s->p.cdata_handler;
+    s->p.cdata_handler = diff_cdata;
+#endif
+#ifndef XML_NO_PI
+    s->c14n_pi = s->p.pi_handler;
+    s->p.pi_handler = diff_pi;
+#endif
+    s->p.error_handler = diff_error;
+
+    return XML_ERROR_NONE;
+}
+
+
+
+static void diff_pop(diff_side_t* s)
+{
+    diff_record_t* r = s->records + s->first;
+
+    free(r->bytes);
+    free(r->nodes);
+    free(r->path);
+
+    s->first++;
+    s->count--;
+    if(!s->count) s->first = 0;
+}
+
+
+
+static void diff_side_free(diff_side_t* s)
+{
+    int i;
+
+    while(s->count) diff_pop(s);
+
+    for(i = 0; i < XML_DIFF_LEVELS; i++) free(s->counts[i].items);
+
+    free(s->records);
+    free(s->nodes);
+    free(s->buf);
+    free(s->root);
+    free(s->block);
+    free(s->edit_path);
+    free(s->value);
+    free(s->pool);
+    if(s->f) fclose(s->f);
+}
+
+
+
+// parse next block of input, returns 0 at end of input or after error
+static int diff_feed(diff_side_t* s)
+{
+    xml_diff_t* d = s->d;
+    int r, final;
+
+    if(s->done) return 0;
+
+    if(s->f)
+    {
+        int n;
+
+        // token does not fit in block
+        if(s->block_len == s->block_size && !diff_grow((void**)&s->block, &s->block_size, s->block_size ? 2 * s->block_size : XML_DIFF_BLOCK, 1))
+        {
+            s->no_memory = 1;
+            s->done = 1;
+            return 0;
+        }
+
+        n = (int)fread(s->block + s->block_len, 1, s->block_size - s->block_len, s->f);
+        final = n < s->block_size - s->block_len;
+        s->block_len += n;
+
+        r = xml_parse_chunk(&s->p, s->block, s->block_len, final);
+        if(r > 0)
+        {
+            memmove(s->block, s->block + r, s->block_len - r);
+            s->block_len -= r;
+        }
+    }
+    else
+    {
+        size_t n = s->src_size - s->src_pos;
+
+        if(n > s->want) n = s->want;
+        final = s->src_pos + n == s->src_size;
+
+        r = xml_parse_chunk(&s->p, s->src + s->src_pos, (int)n, final);
+        if(r > 0) s->src_pos += r;
+        s->want = r ? XML_DIFF_BLOCK : 2 * s->want;
+    }
+
+    if(s->no_memory && !d->errorcode)
+    {
+        d->errorcode = XML_ERROR_NO_MEMORY;
+        d->errorstr = "No enough memory";
+        d->error_doc = s->index;
+        d->error_pos = s->p.bytes;
+    }
+
+    if(r < 0 || final || d->errorcode) s->done = 1;
+
+    return !s->done;
+}
+
+
+
+// parse until n records are buffered or input ends
+static void diff_fill(diff_side_t* s, int n)
+{
+    while(s->count < n && diff_feed(s));
+}
+
+
+
+static void diff_emit(xml_diff_t* d, int op, const char* path, const char* old_value, int old_len, const char* new_value, int new_len)
+{
+    d->op = op;
+    d->path = path;
+    d->old_value = old_value;
+    d->old_len = old_len;
+    d->new_value = new_value;
+    d->new_len = new_len;
+    d->edits++;
+
+    if(d->edit_handler) d->edit_handler(d);
+}
+
+
+
+// set edit path of side to record path or append "/name[index]", returns previous length
+static int diff_path(diff_side_t* s, diff_record_t* r, int node, int index)
+{
+    int len = s->edit_len;
+    int need = node < 0 ? (int)strlen(r->path) + 1 : len + r->nodes[node].name_len + 16;
+
+    if(!diff_grow((void**)&s->edit_path, &s->edit_size, need, 1))
+    {
+        s->d->errorcode = XML_ERROR_NO_MEMORY;
+        return len;
+    }
+
+    if(node < 0) s->edit_len = (int)strlen(strcpy(s->edit_path, r->path));
+    else s->edit_len = diff_segment(s->edit_path, len, s->edit_size, r->bytes + r->nodes[node].start + 1, r->nodes[node].name_len, index);
+
+    return len;
+}
+
+
+
+static void diff_delete(xml_diff_t* d, diff_side_t* s, diff_record_t* r, int node, int op)
+{
+    diff_node_t* n = r->nodes + node;
+
+    if(op == XML_DIFF_DELETE) diff_emit(d, op, s->edit_path, r->bytes + n->start, n->end - n->start, 0, 0);
+    else diff_emit(d, op, s->edit_path, 0, 0, r->bytes + n->start, n->end - n->start);
+}
+
+
+
+// start tag and text of element without children, returns length of value
+static int diff_head(diff_side_t* s, diff_record_t* r, int node)
+{
+    diff_node_t* n = r->nodes + node;
+    int end = n->end - n->name_len - 3;     // without end tag
+    int pos = n->start;
+    int len = 0;
+    int child = n->child;
+
+    if(!diff_grow((void**)&s->value, &s->value_size, n->end - n->start, 1))
+    {
+        s->d->errorcode = XML_ERROR_NO_MEMORY;
+        return 0;
+    }
+
+    while(1)
+    {
+        int stop = child < 0 ? end : r->nodes[child].start;
+
+        memcpy(s->value + len, r->bytes + pos, stop - pos);
+        len += stop - pos;
+        if(child < 0) break;
+
+        pos = r->nodes[child].end;
+        child = r->nodes[child].next;
+    }
+
+    return len;
+}
+
+
+
+// find first pair of equal hashes, searched by increasing x + y
+// if heads is given pairs of start tags are preferred among pairs with same
+// x + y, so record that moved to other parent is not matched across start tag
+// returns 1 if pair is found
+static int diff_align(const uint64_t* ha, int na, const uint64_t* hb, int nb, const char* heads, int* x, int* y)
+{
+    int sum, i, found;
+
+    for(sum = 1; sum <= na + nb - 2; sum++)
+    {
+        found = 0;
+
+        for(i = sum < nb ? 0 : sum - nb + 1; i <= sum && i < na; i++)
+        {
+            if(ha[i] == hb[sum - i] && (!found || heads[i]))
+            {
+                *x = i;
+                *y = sum - i;
+                if(!heads || heads[i]) return 1;
+                found = 1;
+            }
+        }
+
+        if(found) return 1;
+    }
+
+    return 0;
+}
+
+
+
+static int diff_same_name(diff_record_t* ra, int a, diff_record_t* rb, int b)
+{
+    diff_node_t* na = ra->nodes + a;
+    diff_node_t* nb = rb->nodes + b;
+
+    return na->name_len == nb->name_len && !memcmp(ra->bytes + na->start + 1, rb->bytes + nb->start + 1, na->name_len);
+}
+
+
+
+typedef struct
+{
+    int* nodes;
+    int* index;             // index among siblings with same name
+    uint64_t* hash;
+    int count;
+}
+diff_children_t;
+
+
+
+static int diff_children(diff_record_t* r, int node, diff_children_t* ch, uint64_t seed)
+{
+    struct diff_count_list_s names = { 0, 0, 0 };
+    int i, n = 0;
+
+    for(i = r->nodes[node].child; i >= 0; i = r->nodes[i].next) n++;
+
+    ch->count = n;
+    ch->nodes = malloc((n + 1) * sizeof(int));
+    ch->index = malloc((n + 1) * sizeof(int));
+    ch->hash = malloc((n + 1) * sizeof(uint64_t));
+
+    if(!ch->nodes || !ch->index || !ch->hash) return 0;
+
+    for(n = 0, i = r->nodes[node].child; i >= 0; i = r->nodes[i].next, n++)
+    {
+        diff_node_t* c = r->nodes + i;
+
+        ch->nodes[n] = i;
+        ch->index[n] = diff_count(&names, r->bytes + c->start + 1, c->name_len);
+        ch->hash[n] = xml_hash(r->bytes + c->start, c->end - c->start, seed);
+        if(!ch->index[n]) break;
+    }
+
+    free(names.items);
+    return n == ch->count;
+}
+
+
+
+static void diff_nodes(xml_diff_t* d, diff_side_t* a, diff_record_t* ra, int na, diff_side_t* b, diff_record_t* rb, int nb);
+
+// pair of elements that differ, elements with different names are replaced
+static void diff_pair(xml_diff_t* d, diff_side_t* a, diff_record_t* ra, int na, diff_side_t* b, diff_record_t* rb, int nb)
+{
+    if(diff_same_name(ra, na, rb, nb)) diff_nodes(d, a, ra, na, b, rb, nb);
+    else
+    {
+        diff_delete(d, a, ra, na, XML_DIFF_DELETE);
+        diff_delete(d, b, rb, nb, XML_DIFF_INSERT);
+    }
+}
+
+
+
+static void diff_nodes(xml_diff_t* d, diff_side_t* a, diff_record_t* ra, int na, diff_side_t* b, diff_record_t* rb, int nb)
+{
+    diff_children_t ca = { 0, 0, 0, 0 };
+    diff_children_t cb = { 0, 0, 0, 0 };
+    int i = 0, j = 0;
+
+    if(ra->nodes[na].head != rb->nodes[nb].head)
+    {
+        int old_len = diff_head(a, ra, na);
+        int new_len = diff_head(b, rb, nb);
+
+        if(d->errorcode) return;
+        diff_emit(d, XML_DIFF_UPDATE, a->edit_path, a->value, old_len, b->value, new_len);
+    }
+
+    if(!diff_children(ra, na, &ca, d->seed) || !diff_children(rb, nb, &cb, d->seed)) d->errorcode = XML_ERROR_NO_MEMORY;
+
+    while(!d->errorcode && (i < ca.count || j < cb.count))
+    {
+        int x = 0, y = 0, k;
+
+        if(i < ca.count && j < cb.count)
+        {
+            if(ca.hash[i] == cb.hash[j])
+            {
+                i++;
+                j++;
+                continue;
+            }
+
+            if(!diff_align(ca.hash + i, ca.count - i < d->window ? ca.count - i : d->window,
+                           cb.hash + j, cb.count - j < d->window ? cb.count - j : d->window, 0, &x, &y))
+            {
+                x = 1;
+                y = 1;
+            }
+        }
+        else if(i < ca.count) x = ca.count - i;
+        else y = cb.count - j;
+
+        // elements before matching pair are compared by position, rest is deleted or inserted
+        for(k = 0; k < x || k < y; k++)
+        {
+            int len_a = k < x ? diff_path(a, ra, ca.nodes[i + k], ca.index[i + k]) : 0;
+            int len_b = k < y ? diff_path(b, rb, cb.nodes[j + k], cb.index[j + k]) : 0;
+
+            if(k < x && k < y) diff_pair(d, a, ra, ca.nodes[i + k], b, rb, cb.nodes[j + k]);
+            else if(k < x) diff_delete(d, a, ra, ca.nodes[i + k], XML_DIFF_DELETE);
+            else diff_delete(d, b, rb, cb.nodes[j + k], XML_DIFF_INSERT);
+
+            if(k < x) a->edit_len = len_a;
+            if(k < y) b->edit_len = len_b;
+            if(a->edit_path) a->edit_path[a->edit_len] = 0;
+            if(b->edit_path) b->edit_path[b->edit_len] = 0;
+        }
+
+        i += x;
+        j += y;
+    }
+
+    free(ca.nodes);
+    free(ca.index);
+    free(ca.hash);
+    free(cb.nodes);
+    free(cb.index);
+    free(cb.hash);
+}
+
+
+
+static void diff_records(xml_diff_t* d, diff_side_t* a, diff_side_t* b)
+{
+    int window = d->window;
+    uint64_t* ha = malloc(2 * window * sizeof(uint64_t) + window);
+    uint64_t* hb = ha + window;
+    char* heads = (char*)(hb + window);
+
+    if(!ha) d->errorcode = XML_ERROR_NO_MEMORY;
+
+    while(!d->errorcode)
+    {
+        int x = 0, y = 0, k;
+
+        diff_fill(a, 1);
+        diff_fill(b, 1);
+
+        if(d->errorcode || (!a->count && !b->count)) break;
+
+        if(a->count && b->count)
+        {
+            if(a->records[a->first].hash == b->records[b->first].hash)
+            {
+                if(!a->records[a->first].head) d->records++;
+                diff_pop(a);
+                diff_pop(b);
+                continue;
+            }
+
+            // records are buffered only where documents differ
+            diff_fill(a, window);
+            diff_fill(b, window);
+
+            for(k = 0; k < a->count && k < window; k++)
+            {
+                ha[k] = a->records[a->first + k].hash;
+                heads[k] = (char)a->records[a->first + k].head;
+            }
+            for(k = 0; k < b->count && k < window; k++) hb[k] = b->records[b->first + k].hash;
+
+            if(!diff_align(ha, a->count < window ? a->count : window, hb, b->count < window ? b->count : window, heads, &x, &y))
+            {
+                x = 1;
+                y = 1;
+            }
+        }
+        else if(a->count) x = 1;
+        else y = 1;
+
+        for(k = 0; k < x || k < y; k++)
+        {
+            diff_record_t* ra = a->records + a->first + k;
+            diff_record_t* rb = b->records + b->first + k;
+
+            if(k < x) diff_path(a, ra, -1, 0);
+            if(k < y) diff_path(b, rb, -1, 0);
+
+            // records are compared only under elements with same names, start
+            // tags above records are compared as values
+            if(k < x && k < y && ra->head == rb->head && ra->parent == rb->parent && diff_same_name(ra, 0, rb, 0))
+            {
+                if(ra->head) diff_emit(d, XML_DIFF_UPDATE, a->edit_path, ra->bytes, ra->len, rb->bytes, rb->len);
+                else
+                {
+                    d->records++;
+                    diff_nodes(d, a, ra, 0, b, rb, 0);
+                }
+            }
+            else
+            {
+                if(k < x) diff_delete(d, a, ra, 0, XML_DIFF_DELETE);
+                if(k < y) diff_delete(d, b, rb, 0, XML_DIFF_INSERT);
+            }
+        }
+
+        while(x--) diff_pop(a);
+        while(y--) diff_pop(b);
+    }
+
+    free(ha);
+}
+
+
+
+static int diff_run(xml_diff_t* d, diff_side_t* a, diff_side_t* b)
+{
+    d->records = 0;
+    d->edits = 0;
+    d->errorcode = XML_ERROR_NONE;
+    d->errorstr = 0;
+    d->error_doc = 0;
+    d->error_pos = 0;
+
+    if(d->record_level < 1 || d->record_level > XML_DIFF_LEVELS || d->window < 1) return XML_ERROR_ARG;
+
+    // start tags of document elements are known before first record
+    diff_fill(a, 1);
+    diff_fill(b, 1);
+
+    if(!d->errorcode && d->record_level > 1 && a->root && b->root &&
+       (a->root_len != b->root_len || memcmp(a->root, b->root, a->root_len)))
+    {
+        if(!diff_grow((void**)&a->edit_path, &a->edit_size, a->path_len[1] + 1, 1)) return XML_ERROR_NO_MEMORY;
+
+        memcpy(a->edit_path, a->path, a->path_len[1]);
+        a->edit_path[a->path_len[1]] = 0;
+        diff_emit(d, XML_DIFF_UPDATE, a->edit_path, a->root, a->root_len, b->root, b->root_len);
+    }
+
+    diff_records(d, a, b);
+
+    return d->errorcode;
+}
+
+
+
+void xml_diff_init(xml_diff_t* d)
+{
+    memset(d, 0, sizeof(*d));
+    d->record_level = 2;
+    d->window = XML_DIFF_WINDOW;
+    d->options = XML_OPTION_SKIP_WHITESPACE;
+    d->pool_size = 64 * 1024;
+}
+
+
+
+int xml_diff_buffers(xml_diff_t* d, char* old_doc, size_t old_size, char* new_doc, size_t new_size)
+{
+    diff_side_t* s = calloc(2, sizeof(diff_side_t));
+    int err;
+
+    if(!s) return d->errorcode = XML_ERROR_NO_MEMORY;
+
+    s[0].src = old_doc;
+    s[0].src_size = old_size;
+    s[1].src = new_doc;
+    s[1].src_size = new_size;
+
+    err = diff_side_init(s, d, 0);
+    if(!err) err = diff_side_init(s + 1, d, 1);
+    if(!err) err = diff_run(d, s, s + 1);
+
+    diff_side_free(s);
+    diff_side_free(s + 1);
+    free(s);
+
+    return d->errorcode = err;
+}
+
+
+
+int xml_diff_files(xml_diff_t* d, const char* old_path, const char* new_path)
+{
+    diff_side_t* s = calloc(2, sizeof(diff_side_t));
+    int err = XML_ERROR_NONE;
+
+    if(!s) return d->errorcode = XML_ERROR_NO_MEMORY;
+
+    s[0].f = fopen(old_path, "rb");
+    s[1].f = fopen(new_path, "rb");
+
+    if(!s[0].f || !s[1].f)
+    {
+        d->errorstr = "Can not open file";
+        d->error_doc = s[0].f ? 1 : 0;
+        err = XML_ERROR_ARG;
+    }
+
+    if(!err) err = diff_side_init(s, d, 0);
+    if(!err) err = diff_side_init(s + 1, d, 1);
+    if(!err) err = diff_run(d, s, s + 1);
+
+    diff_side_free(s);
+    diff_side_free(s + 1);
+    free(s);
+
+    return d->errorcode = err;
+}
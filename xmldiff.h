@@ -0,0 +1,129 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmldiff.h
+// streaming structural diff of two documents
+//
+// both documents are parsed in lockstep, chunk by chunk, and split into
+// records, elements at record level with their subtrees; canonical form of
+// every record is hashed (see xmlc14n.h), so records that are equal in both
+// documents are dropped as soon as they are parsed
+// where hashes diverge up to window records of each document are buffered
+// and aligned by hash; records between aligned ones are paired by position,
+// pairs with same name are compared element by element the same way and
+// other records are reported as deleted and inserted
+//
+// differences are reported to edit_handler as edit script:
+//     XML_DIFF_DELETE     old_value is canonical subtree, path is in old document
+//     XML_DIFF_INSERT     new_value is canonical subtree, path is in new document
+//     XML_DIFF_UPDATE     values are canonical start tags followed by text
+//                         of element, path is in old document
+// paths look like "Profile/Tools/Tool[3]/Description[1]", index counts
+// siblings with the same name from 1
+//
+//     xml_diff_init(&d);
+//     d.edit_handler = print_edit;
+//     err = xml_diff_files(&d, "config-old.xml", "config.xml");
+//
+// start tags of elements above record level are compared in document order
+// together with records, changed ones are reported as updates, and records
+// are matched only under ancestors with same names, so record moved to other
+// parent is deleted and inserted; text above record level is ignored
+//
+// memory use depends on record size and length of differing regions, not on
+// document size
+
+#ifndef __XMLDIFF_H__
+#define __XMLDIFF_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// default number of records or sibling elements that are searched for match
+#define XML_DIFF_WINDOW     32
+
+// input is parsed in blocks of this size
+#define XML_DIFF_BLOCK      (64 * 1024)
+
+// max record level and max element depth inside record
+#define XML_DIFF_LEVELS     32
+#define XML_DIFF_DEPTH      256
+
+// max length of path of record element
+#define XML_DIFF_PATH       1024
+
+// edit operations
+enum
+{
+    XML_DIFF_INSERT = 1,
+    XML_DIFF_DELETE,
+    XML_DIFF_UPDATE,
+};
+
+typedef struct xml_diff_s xml_diff_t;
+
+struct xml_diff_s
+{
+    void* user_ptr;
+    int record_level;       // default 2, children of document element
+    int window;
+    int options;            // parser options, default XML_OPTION_SKIP_WHITESPACE
+    int pool_size;          // pool size of each parser
+    uint64_t seed;
+    long long records;      // number of compared records
+    long long edits;
+    // current edit, valid in edit_handler; values are not zero terminated
+    int op;
+    const char* path;
+    const char* old_value;
+    int old_len;
+    const char* new_value;
+    int new_len;
+    void (*edit_handler)(xml_diff_t* d);
+    // first error
+    int errorcode;
+    const char* errorstr;
+    int error_doc;          // 0 for old and 1 for new document
+    size_t error_pos;       // input offset of error
+};
+
+
+void xml_diff_init(xml_diff_t* d);
+
+// compare documents, returns XML_ERROR_NONE, XML_ERROR_NO_MEMORY, XML_ERROR_ARG
+// if file can not be opened or parser error of one of documents; edits found
+// before error are already reported
+int xml_diff_buffers(xml_diff_t* d, char* old_doc, size_t old_size, char* new_doc, size_t new_size);
+int xml_diff_files(xml_diff_t* d, const char* old_path, const char* new_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLDIFF_H__
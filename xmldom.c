@@ -0,0 +1,671 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmldom.c
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "xmldom.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*
+    Image format, native byte order (image is local to machine):
+    Header
+    Node            node_count nodes, node 0 is root element
+    Attr            attr_count attributes
+    Strings         string_size bytes of zero terminated strings, first one is ""
+
+    Equal strings are stored once. Header checksum protects header,
+    data checksum protects everything after header.
+*/
+
+#define XML_DOM_MAGIC       0x4d4f4458  // "XDOM"
+#define XML_DOM_VERSION     1
+
+struct xml_dom_header_s
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    int32_t node_count;
+    int32_t attr_count;
+    int32_t string_size;
+    uint32_t reserved;
+    uint32_t data_checksum;
+    uint32_t header_checksum;   // checksum of header before this field
+};
+
+typedef struct dom_builder_s dom_builder_t;
+
+struct dom_builder_s
+{
+    xml_dom_node_t* nodes;
+    int node_count;
+    int node_capacity;
+    xml_dom_attr_t* attrs;
+    int attr_count;
+    int attr_capacity;
+    char* strings;
+    int string_size;
+    int string_capacity;
+    int32_t* table;         // string offsets + 1, 0 is empty slot
+    int table_slots;
+    int table_used;
+    int32_t* last;          // last child of open node of each level
+    int last_capacity;
+    char* tmp;              // text of open nodes, interned when node is closed
+    int tmp_used;
+    int tmp_capacity;
+    int32_t* text_start;    // start of text in tmp of open node of each level
+    int text_capacity;
+    int current;            // open node or -1
+    int err;
+};
+
+
+
+static uint32_t dom_hash(const char* s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    while(len--) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+
+
+// make room for need elements of size elem in *ptr
+// returns 1 if there is no more memory, 0 otherwise
+static int dom_reserve(dom_builder_t* b, void** ptr, int* capacity, int need, int elem)
+{
+    int n = *capacity ? *capacity : 64;
+    void* p;
+
+    if(b->err) return 1;
+    if(need <= *capacity) return 0;
+
+    while(n < need)
+    {
+        if(n > 0x3fffffff / elem)
+        {
+            b->err = XML_ERROR_NO_MEMORY;
+            return 1;
+        }
+        n *= 2;
+    }
+
+    p = realloc(*ptr, (size_t)n * elem);
+    if(!p)
+    {
+        b->err = XML_ERROR_NO_MEMORY;
+        return 1;
+    }
+
+    *ptr = p;
+    *capacity = n;
+    return 0;
+}
+
+
+
+static int dom_rehash(dom_builder_t* b)
+{
+    int slots = b->table_slots ? b->table_slots * 2 : 1024;
+    int32_t* table = calloc(slots, sizeof(int32_t));
+    int i;
+
+    if(!table)
+    {
+        b->err = XML_ERROR_NO_MEMORY;
+        return 1;
+    }
+
+    for(i = 0; i < b->table_slots; i++)
+    {
+        int32_t off = b->table[i];
+
+        if(off)
+        {
+            const char* s = b->strings + off - 1;
+            uint32_t j = dom_hash(s, strlen(s)) & (slots - 1);
+
+            while(table[j]) j = (j + 1) & (slots - 1);
+            table[j] = off;
+        }
+    }
+
+    free(b->table);
+    b->table = table;
+    b->table_slots = slots;
+    return 0;
+}
+
+
+
+// returns offset of string in string table, equal strings are stored once
+static int32_t dom_intern(dom_builder_t* b, const char* s, int len)
+{
+    uint32_t i;
+    int32_t off;
+
+    if(!len || b->err) return 0;
+
+    if(b->table_used * 2 >= b->table_slots && dom_rehash(b)) return 0;
+
+    i = dom_hash(s, len) & (b->table_slots - 1);
+    while((off = b->table[i]) != 0)
+    {
+        const char* d = b->strings + off - 1;
+
+        if(!memcmp(d, s, len) && !d[len]) return off - 1;
+        i = (i + 1) & (b->table_slots - 1);
+    }
+
+    if(dom_reserve(b, (void**)&b->strings, &b->string_capacity, b->string_size + len + 1, 1)) return 0;
+
+    off = b->string_size;
+    memcpy(b->strings + off, s, len);
+    b->strings[off + len] = 0;
+    b->string_size += len + 1;
+
+    b->table[i] = off + 1;
+    b->table_used++;
+
+    return off;
+}
+
+
+
+static void dom_error(xml_parser_t* p)
+{
+    dom_builder_t* b = p->user_ptr;
+
+    if(!b->err) b->err = p->errorcode;
+}
+
+
+
+static void dom_start_element(xml_parser_t* p)
+{
+    dom_builder_t* b = p->user_ptr;
+    int level = p->level;
+    char* attr_string = p->attr;
+    xml_dom_node_t* n;
+    xml_attr_t a;
+    int i;
+
+    if(dom_reserve(b, (void**)&b->nodes, &b->node_capacity, b->node_count + 1, sizeof(xml_dom_node_t))) return;
+    if(dom_reserve(b, (void**)&b->last, &b->last_capacity, level + 1, sizeof(int32_t))) return;
+    if(dom_reserve(b, (void**)&b->text_start, &b->text_capacity, level + 1, sizeof(int32_t))) return;
+
+    i = b->node_count++;
+    n = b->nodes + i;
+    n->name = dom_intern(b, p->tag, (int)strlen(p->tag));
+    n->text = 0;
+    n->parent = b->current;
+    n->first_child = -1;
+    n->next_sibling = -1;
+    n->first_attr = b->attr_count;
+    n->attr_count = 0;
+    n->depth = level;
+
+    while(attr_string && xml_next_attr(&attr_string, &a))
+    {
+        if(dom_reserve(b, (void**)&b->attrs, &b->attr_capacity, b->attr_count + 1, sizeof(xml_dom_attr_t))) return;
+
+        b->attrs[b->attr_count].name = dom_intern(b, a.name, a.name_len);
+        b->attrs[b->attr_count].value = dom_intern(b, a.value, a.value_len);
+        b->attr_count++;
+        b->nodes[i].attr_count++;
+    }
+
+    // append to children of open node
+    if(b->last[level - 1] >= 0) b->nodes[b->last[level - 1]].next_sibling = i;
+    else if(b->current >= 0) b->nodes[b->current].first_child = i;
+
+    b->last[level - 1] = i;
+    b->last[level] = -1;
+    b->text_start[level] = b->tmp_used;
+    b->current = i;
+}
+
+
+
+static void dom_end_element(xml_parser_t* p)
+{
+    dom_builder_t* b = p->user_ptr;
+    xml_dom_node_t* n;
+    int start;
+
+    if(b->err || b->current < 0) return;
+
+    // text split by comments, CDATA or child elements is joined
+    n = b->nodes + b->current;
+    start = b->text_start[n->depth];
+    if(b->tmp_used > start) n->text = dom_intern(b, b->tmp + start, b->tmp_used - start);
+    b->tmp_used = start;
+
+    b->current = n->parent;
+}
+
+
+
+// append text to text of open node, references are decoded if decode is set
+static void dom_text(xml_parser_t* p, const char* text, int decode)
+{
+    dom_builder_t* b = p->user_ptr;
+    int len = (int)strlen(text);
+    int i;
+
+    if(b->err || b->current < 0) return;
+
+    for(i = 0; i < len; i++)
+    {
+        if(text[i] != ' ' && text[i] != '\t' && text[i] != '\n' && text[i] != '\r') break;
+    }
+    if(i == len) return;
+
+    if(dom_reserve(b, (void**)&b->tmp, &b->tmp_capacity, b->tmp_used + len + 1, 1)) return;
+    memcpy(b->tmp + b->tmp_used, text, len);
+    if(decode) len = xml_text_decode(b->tmp + b->tmp_used, len);
+    b->tmp_used += len;
+}
+
+
+
+static void dom_characters(xml_parser_t* p)
+{
+    dom_text(p, p->chars, 1);
+}
+
+
+
+#ifndef XML_NO_CDATA
+static void dom_cdata(xml_parser_t* p)
+{
+    dom_text(p, p->cdata, 0);
+}
+#endif
+
+
+
+int xml_dom_build(xml_parser_t* p, char* string, char** image, size_t* size)
+{
+    xml_parser_t saved = *p;
+    struct xml_dom_header_s h;
+    dom_builder_t b;
+    char* buf = 0;
+
+    memset(&b, 0, sizeof(b));
+    b.current = -1;
+
+    // first string is ""
+    if(!dom_reserve(&b, (void**)&b.strings, &b.string_capacity, 1, 1))
+    {
+        b.strings[0] = 0;
+        b.string_size = 1;
+    }
+    if(!dom_reserve(&b, (void**)&b.last, &b.last_capacity, 1, sizeof(int32_t))) b.last[0] = -1;
+
+    p->user_ptr = &b;
+    p->error_handler = dom_error;
+#ifndef XML_NO_COMMENTS
+    p->comment_handler = 0;
+#endif
+#ifndef XML_NO_PI
+    p->pi_handler = 0;
+    p->include_handler = 0;
+#endif
+#ifndef XML_NO_CDATA
+    p->cdata_handler = dom_cdata;
+#endif
+    p->start_element_handler = dom_start_element;
+    p->end_element_handler = dom_end_element;
+    p->characters_handler = dom_characters;
+    p->options &= ~XML_OPTION_LAZY_ATTRS;   // image stores decoded attributes
+
+    if(!b.err) xml_parse_string(p, string);
+
+    p->user_ptr = saved.user_ptr;
+    p->error_handler = saved.error_handler;
+#ifndef XML_NO_COMMENTS
+    p->comment_handler = saved.comment_handler;
+#endif
+#ifndef XML_NO_PI
+    p->pi_handler = saved.pi_handler;
+    p->include_handler = saved.include_handler;
+#endif
+#ifndef XML_NO_CDATA
+    p->cdata_handler = saved.cdata_handler;
+#endif
+    p->start_element_handler = saved.start_element_handler;
+    p->end_element_handler = saved.end_element_handler;
+    p->characters_handler = saved.characters_handler;
+    p->options = saved.options;
+
+    if(!b.err)
+    {
+        size_t nodes = (size_t)b.node_count * sizeof(xml_dom_node_t);
+        size_t attrs = (size_t)b.attr_count * sizeof(xml_dom_attr_t);
+
+        h.magic = XML_DOM_MAGIC;
+        h.version = XML_DOM_VERSION;
+        h.size = sizeof(h) + nodes + attrs + b.string_size;
+        h.node_count = b.node_count;
+        h.attr_count = b.attr_count;
+        h.string_size = b.string_size;
+        h.reserved = 0;
+
+        buf = malloc(h.size);
+        if(buf)
+        {
+            if(nodes) memcpy(buf + sizeof(h), b.nodes, nodes);
+            if(attrs) memcpy(buf + sizeof(h) + nodes, b.attrs, attrs);
+            memcpy(buf + sizeof(h) + nodes + attrs, b.strings, b.string_size);
+
+            h.data_checksum = dom_hash(buf + sizeof(h), h.size - sizeof(h));
+            h.header_checksum = dom_hash((const char*)&h, offsetof(struct xml_dom_header_s, header_checksum));
+            memcpy(buf, &h, sizeof(h));
+
+            *image = buf;
+            *size = h.size;
+        }
+        else b.err = XML_ERROR_NO_MEMORY;
+    }
+
+    free(b.nodes);
+    free(b.attrs);
+    free(b.strings);
+    free(b.table);
+    free(b.last);
+    free(b.tmp);
+    free(b.text_start);
+
+    return b.err;
+}
+
+
+
+int xml_dom_save(const char* image, size_t size, const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    int ok;
+
+    if(!f) return XML_ERROR_ARG;
+
+    ok = fwrite(image, size, 1, f) == 1;
+    ok = !fclose(f) && ok;
+    if(!ok) remove(path);
+
+    return ok ? XML_ERROR_NONE : XML_ERROR_ARG;
+}
+
+
+
+int xml_dom_load(xml_dom_t* d, const char* image, size_t size, int verify)
+{
+    struct xml_dom_header_s h;
+    uint64_t nodes, attrs;
+
+    memset(d, 0, sizeof(*d));
+
+    if(size < sizeof(h) || ((uintptr_t)image & 7)) return XML_ERROR_MALFORMED;
+    memcpy(&h, image, sizeof(h));
+
+    if(h.magic != XML_DOM_MAGIC || h.version != XML_DOM_VERSION) return XML_ERROR_MALFORMED;
+    if(h.header_checksum != dom_hash((const char*)&h, offsetof(struct xml_dom_header_s, header_checksum))) return XML_ERROR_MALFORMED;
+    if(h.node_count < 0 || h.attr_count < 0 || h.string_size < 1) return XML_ERROR_MALFORMED;
+
+    nodes = (uint64_t)h.node_count * sizeof(xml_dom_node_t);
+    attrs = (uint64_t)h.attr_count * sizeof(xml_dom_attr_t);
+    if(h.size != size || h.size != sizeof(h) + nodes + attrs + (uint64_t)h.string_size) return XML_ERROR_MALFORMED;
+
+    if(verify && h.data_checksum != dom_hash(image + sizeof(h), size - sizeof(h))) return XML_ERROR_MALFORMED;
+
+    d->image = image;
+    d->size = size;
+    d->nodes = (const xml_dom_node_t*)(image + sizeof(h));
+    d->attrs = (const xml_dom_attr_t*)(image + sizeof(h) + nodes);
+    d->strings = image + sizeof(h) + nodes + attrs;
+    d->node_count = h.node_count;
+    d->attr_count = h.attr_count;
+    d->string_size = h.string_size;
+
+    // every offset in string table is start of zero terminated string
+    if(d->strings[0] || d->strings[d->string_size - 1])
+    {
+        memset(d, 0, sizeof(*d));
+        return XML_ERROR_MALFORMED;
+    }
+
+    return XML_ERROR_NONE;
+}
+
+
+
+int xml_dom_open(xml_dom_t* d, const char* path, int verify)
+{
+    char* image;
+    size_t size;
+    int err;
+
+#ifndef _WIN32
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    memset(d, 0, sizeof(*d));
+    if(fd < 0) return XML_ERROR_ARG;
+
+    if(fstat(fd, &st) || st.st_size <= 0)
+    {
+        close(fd);
+        return XML_ERROR_ARG;
+    }
+
+    size = (size_t)st.st_size;
+    image = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(image == MAP_FAILED) return XML_ERROR_ARG;
+
+    err = xml_dom_load(d, image, size, verify);
+    if(err)
+    {
+        munmap(image, size);
+        return err;
+    }
+#else
+    FILE* f = fopen(path, "rb");
+    long len;
+
+    memset(d, 0, sizeof(*d));
+    if(!f) return XML_ERROR_ARG;
+
+    image = 0;
+    if(!fseek(f, 0, SEEK_END) && (len = ftell(f)) > 0 && !fseek(f, 0, SEEK_SET))
+    {
+        size = (size_t)len;
+        image = malloc(size);
+        if(image && fread(image, 1, size, f) != size)
+        {
+            free(image);
+            image = 0;
+        }
+    }
+    fclose(f);
+
+    if(!image) return XML_ERROR_ARG;
+
+    err = xml_dom_load(d, image, size, verify);
+    if(err)
+    {
+        free(image);
+        return err;
+    }
+#endif
+
+    d->mapped = 1;
+    return XML_ERROR_NONE;
+}
+
+
+
+void xml_dom_close(xml_dom_t* d)
+{
+    if(d->mapped)
+    {
+#ifndef _WIN32
+        munmap((void*)d->image, d->size);
+#else
+        free((void*)d->image);
+#endif
+    }
+
+    memset(d, 0, sizeof(*d));
+}
+
+
+
+static const xml_dom_node_t* dom_node(const xml_dom_t* d, int node)
+{
+    return node >= 0 && node < d->node_count ? d->nodes + node : 0;
+}
+
+
+
+static const char* dom_string(const xml_dom_t* d, int32_t off)
+{
+    return off >= 0 && off < d->string_size ? d->strings + off : 0;
+}
+
+
+
+int xml_dom_root(const xml_dom_t* d)
+{
+    return d->node_count ? 0 : -1;
+}
+
+
+
+int xml_dom_parent(const xml_dom_t* d, int node)
+{
+    const xml_dom_node_t* n = dom_node(d, node);
+    return n ? n->parent : -1;
+}
+
+
+
+int xml_dom_first_child(const xml_dom_t* d, int node)
+{
+    const xml_dom_node_t* n = dom_node(d, node);
+    return n ? n->first_child : -1;
+}
+
+
+
+int xml_dom_next_sibling(const xml_dom_t* d, int node)
+{
+    const xml_dom_node_t* n = dom_node(d, node);
+    return n ? n->next_sibling : -1;
+}
+
+
+
+int xml_dom_find_child(const xml_dom_t* d, int node, const char* name)
+{
+    const char* s;
+    int i;
+
+    for(i = xml_dom_first_child(d, node); i >= 0; i = xml_dom_next_sibling(d, i))
+    {
+        s = xml_dom_name(d, i);
+        if(s && !strcmp(s, name)) return i;
+    }
+
+    return -1;
+}
+
+
+
+const char* xml_dom_name(const xml_dom_t* d, int node)
+{
+    const xml_dom_node_t* n = dom_node(d, node);
+    return n ? dom_string(d, n->name) : 0;
+}
+
+
+
+const char* xml_dom_text(const xml_dom_t* d, int node)
+{
+    const xml_dom_node_t* n = dom_node(d, node);
+    return n ? dom_string(d, n->text) : 0;
+}
+
+
+
+int xml_dom_attr_count(const xml_dom_t* d, int node)
+{
+    const xml_dom_node_t* n = dom_node(d, node);
+
+    if(!n || n->first_attr < 0 || n->attr_count < 0 || n->attr_count > d->attr_count - n->first_attr) return 0;
+    return n->attr_count;
+}
+
+
+
+int xml_dom_attr_at(const xml_dom_t* d, int node, int i, const char** name, const char** value)
+{
+    const xml_dom_attr_t* a;
+
+    if(i < 0 || i >= xml_dom_attr_count(d, node)) return 0;
+
+    a = d->attrs + d->nodes[node].first_attr + i;
+    *name = dom_string(d, a->name);
+    *value = dom_string(d, a->value);
+
+    return *name && *value;
+}
+
+
+
+const char* xml_dom_attr(const xml_dom_t* d, int node, const char* name)
+{
+    const char* n;
+    const char* v;
+    int i, count = xml_dom_attr_count(d, node);
+
+    for(i = 0; i < count; i++)
+    {
+        if(xml_dom_attr_at(d, node, i, &n, &v) && !strcmp(n, name)) return v;
+    }
+
+    return 0;
+}
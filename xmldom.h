@@ -0,0 +1,130 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmldom.h
+// position independent binary document: element nodes, attributes and
+// string table addressed by offsets, so image can be mapped read-only from
+// file and queried without deserialization; mapped pages are shared by
+// all processes that open the same file
+//
+// element text is concatenation of its text with decoded references and CDATA,
+// whitespace only text, comments and processing instructions are not stored
+
+#ifndef __XMLDOM_H__
+#define __XMLDOM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xml_dom_node_s xml_dom_node_t;
+typedef struct xml_dom_attr_s xml_dom_attr_t;
+typedef struct xml_dom_s xml_dom_t;
+
+// node and attribute indices are -1 if there is no such node,
+// names and values are offsets in string table, 0 is empty string
+struct xml_dom_node_s
+{
+    int32_t name;
+    int32_t text;
+    int32_t parent;
+    int32_t first_child;
+    int32_t next_sibling;
+    int32_t first_attr;     // attributes of node are contiguous
+    int32_t attr_count;
+    int32_t depth;          // same as xml_parser_t::level in start_element_handler
+};
+
+struct xml_dom_attr_s
+{
+    int32_t name;
+    int32_t value;
+};
+
+struct xml_dom_s
+{
+    const char* image;
+    size_t size;
+    const xml_dom_node_t* nodes;
+    const xml_dom_attr_t* attrs;
+    const char* strings;
+    int node_count;
+    int attr_count;
+    int string_size;
+    int mapped;             // image is mapped from file or allocated by xml_dom_open
+};
+
+
+// parse string with p and build image allocated with malloc
+// handlers and user_ptr of p are restored before return
+// returns XML_ERROR_NONE, XML_ERROR_NO_MEMORY or parser error code
+int xml_dom_build(xml_parser_t* p, char* string, char** image, size_t* size);
+
+// write image to file
+// returns XML_ERROR_NONE or XML_ERROR_ARG if file can not be written
+int xml_dom_save(const char* image, size_t size, const char* path);
+
+// use image in memory, image must stay valid while d is used
+// header is always checked, checksum of whole image only if verify is set
+// returns XML_ERROR_NONE or XML_ERROR_MALFORMED
+int xml_dom_load(xml_dom_t* d, const char* image, size_t size, int verify);
+
+// map image file read-only, on systems without mmap file is read to memory
+// returns XML_ERROR_NONE, XML_ERROR_ARG if file can not be read or XML_ERROR_MALFORMED
+int xml_dom_open(xml_dom_t* d, const char* path, int verify);
+
+// unmap or free image opened with xml_dom_open
+void xml_dom_close(xml_dom_t* d);
+
+// navigation, all return node index or -1
+// root is first element of document, other top level elements are its siblings
+int xml_dom_root(const xml_dom_t* d);
+int xml_dom_parent(const xml_dom_t* d, int node);
+int xml_dom_first_child(const xml_dom_t* d, int node);
+int xml_dom_next_sibling(const xml_dom_t* d, int node);
+int xml_dom_find_child(const xml_dom_t* d, int node, const char* name);
+
+// return 0 if node is out of range
+const char* xml_dom_name(const xml_dom_t* d, int node);
+const char* xml_dom_text(const xml_dom_t* d, int node);
+
+// value of attribute name or 0 if node has no such attribute
+const char* xml_dom_attr(const xml_dom_t* d, int node, const char* name);
+
+// returns number of attributes of node
+int xml_dom_attr_count(const xml_dom_t* d, int node);
+
+// name and value of i-th attribute of node
+// returns 1 on success, 0 if there is no such attribute
+int xml_dom_attr_at(const xml_dom_t* d, int node, int i, const char** name, const char** value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLDOM_H__
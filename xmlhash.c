@@ -0,0 +1,213 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlhash.c
+
+#include <string.h>
+#include "xmlhash.h"
+
+
+#define PRIME64_1   0x9E3779B185EBCA87ULL
+#define PRIME64_2   0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3   0x165667B19E3779F9ULL
+#define PRIME64_4   0x85EBCA77C2B2AE63ULL
+#define PRIME64_5   0x27D4EB2F165667C5ULL
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+
+// input is read as little endian
+static uint64_t read64(const unsigned char* p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+
+
+static uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+
+
+static uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = ROTL64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+
+
+static uint64_t hash_merge(uint64_t acc, uint64_t v)
+{
+    acc ^= hash_round(0, v);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+
+
+// process 32 byte stripes, returns number of bytes processed
+static size_t hash_stripes(xml_hash_t* h, const unsigned char* p, size_t len)
+{
+    const unsigned char* start = p;
+    uint64_t v0 = h->v[0], v1 = h->v[1], v2 = h->v[2], v3 = h->v[3];
+
+    for(; len >= 32; p += 32, len -= 32)
+    {
+        v0 = hash_round(v0, read64(p));
+        v1 = hash_round(v1, read64(p + 8));
+        v2 = hash_round(v2, read64(p + 16));
+        v3 = hash_round(v3, read64(p + 24));
+    }
+
+    h->v[0] = v0;
+    h->v[1] = v1;
+    h->v[2] = v2;
+    h->v[3] = v3;
+
+    return (size_t)(p - start);
+}
+
+
+
+void xml_hash_init(xml_hash_t* h, uint64_t seed)
+{
+    h->v[0] = seed + PRIME64_1 + PRIME64_2;
+    h->v[1] = seed + PRIME64_2;
+    h->v[2] = seed;
+    h->v[3] = seed - PRIME64_1;
+    h->total = 0;
+    h->seed = seed;
+    h->mem_size = 0;
+}
+
+
+
+void xml_hash_update(xml_hash_t* h, const void* data, size_t len)
+{
+    const unsigned char* p = data;
+    size_t n;
+
+    h->total += len;
+
+    // fill partial stripe first
+    if(h->mem_size)
+    {
+        n = 32 - h->mem_size;
+        if(len < n)
+        {
+            memcpy(h->mem + h->mem_size, p, len);
+            h->mem_size += (int)len;
+            return;
+        }
+
+        memcpy(h->mem + h->mem_size, p, n);
+        hash_stripes(h, h->mem, 32);
+        h->mem_size = 0;
+        p += n;
+        len -= n;
+    }
+
+    n = hash_stripes(h, p, len);
+    p += n;
+    len -= n;
+
+    memcpy(h->mem, p, len);
+    h->mem_size = (int)len;
+}
+
+
+
+uint64_t xml_hash_final(const xml_hash_t* h)
+{
+    const unsigned char* p = h->mem;
+    int len = h->mem_size;
+    uint64_t acc;
+
+    if(h->total >= 32)
+    {
+        acc = ROTL64(h->v[0], 1) + ROTL64(h->v[1], 7) + ROTL64(h->v[2], 12) + ROTL64(h->v[3], 18);
+        acc = hash_merge(acc, h->v[0]);
+        acc = hash_merge(acc, h->v[1]);
+        acc = hash_merge(acc, h->v[2]);
+        acc = hash_merge(acc, h->v[3]);
+    }
+    else acc = h->seed + PRIME64_5;
+
+    acc += h->total;
+
+    for(; len >= 8; p += 8, len -= 8)
+    {
+        acc ^= hash_round(0, read64(p));
+        acc = ROTL64(acc, 27) * PRIME64_1 + PRIME64_4;
+    }
+
+    if(len >= 4)
+    {
+        acc ^= (uint64_t)read32(p) * PRIME64_1;
+        acc = ROTL64(acc, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+        len -= 4;
+    }
+
+    for(; len > 0; p++, len--)
+    {
+        acc ^= *p * PRIME64_5;
+        acc = ROTL64(acc, 11) * PRIME64_1;
+    }
+
+    acc ^= acc >> 33;
+    acc *= PRIME64_2;
+    acc ^= acc >> 29;
+    acc *= PRIME64_3;
+    acc ^= acc >> 32;
+
+    return acc;
+}
+
+
+
+uint64_t xml_hash(const void* data, size_t len, uint64_t seed)
+{
+    xml_hash_t h;
+
+    xml_hash_init(&h, seed);
+    xml_hash_update(&h, data, len);
+
+    return xml_hash_final(&h);
+}
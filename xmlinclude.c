@@ -0,0 +1,246 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlinclude.c
+
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "xmlinclude.h"
+
+#ifdef XML_NO_PI
+#error "xmlinclude needs processing instructions, build without XML_NO_PI"
+#endif
+
+
+// find cached tape for path or tokenize file to free cache entry
+// fragments are tokenized with options and limits of p
+// returns 0 if file can not be read
+static xml_include_entry_t* include_lookup(xml_include_t* inc, xml_parser_t* p, const char* path)
+{
+    xml_include_entry_t* e = 0;
+    struct stat st;
+    int i, err;
+
+    if(stat(path, &st)) return 0;
+
+    inc->parser.options = p->options;
+    inc->parser.max_depth = p->max_depth;
+    inc->parser.max_attrs = p->max_attrs;
+    inc->parser.max_name = p->max_name;
+
+    for(i = 0; i < XML_INCLUDE_CACHE; i++)
+    {
+        if(inc->cache[i].path && !strcmp(inc->cache[i].path, path))
+        {
+            e = inc->cache + i;
+            if(e->mtime == (int64_t)st.st_mtime && e->size == (int64_t)st.st_size &&
+               xml_tape_compatible(&e->tape, &inc->parser)) return e;
+            break;
+        }
+    }
+
+    if(!e)
+    {
+        // replace cache entries in round robin order, entries being replayed are skipped
+        do
+        {
+            e = inc->cache + inc->victim;
+            inc->victim = (inc->victim + 1) % XML_INCLUDE_CACHE;
+        }
+        while(e->busy);
+
+        free(e->path);
+        e->path = malloc(strlen(path) + 1);
+        if(!e->path) return 0;
+        strcpy(e->path, path);
+    }
+
+    xml_tape_clear(&e->tape);
+
+    if(inc->cache_dir) err = xml_tape_cached(&e->tape, &inc->parser, path, inc->cache_dir);
+    else err = xml_tape_record_file(&e->tape, &inc->parser, path);
+
+    if(err != XML_ERROR_NONE)
+    {
+        free(e->path);
+        e->path = 0;
+        return 0;
+    }
+
+    e->mtime = (int64_t)st.st_mtime;
+    e->size = (int64_t)st.st_size;
+
+    return e;
+}
+
+
+
+// include_handler of attached parser
+static void include_pi(xml_parser_t* p)
+{
+    xml_include_t* inc = p->include_ptr;
+    xml_include_entry_t* e;
+    const char* from = inc->depth ? inc->stack[inc->depth - 1] : inc->base;
+    char href[XML_INCLUDE_PATH];
+    char path[XML_INCLUDE_PATH];
+    char* ptr = p->pi + 7;
+    int i, len;
+
+    // href is rest of PI, optionally quoted
+    while(*ptr == ' ' || *ptr == '\t' || *ptr == '\n') ptr++;
+    len = (int)strlen(ptr);
+    if(len >= 2 && (*ptr == '"' || *ptr == '\'') && ptr[len - 1] == *ptr)
+    {
+        ptr++;
+        len -= 2;
+    }
+
+    if(!len || len >= XML_INCLUDE_PATH)
+    {
+        xml_set_error(p, XML_ERROR_INCLUDE, "Malformed include");
+        return;
+    }
+
+    memcpy(href, ptr, len);
+    href[len] = 0;
+
+    if(inc->resolver(inc, href, from, path, sizeof(path)))
+    {
+        xml_set_error(p, XML_ERROR_INCLUDE, "Can not resolve include");
+        return;
+    }
+
+    if(inc->base && !strcmp(inc->base, path))
+    {
+        xml_set_error(p, XML_ERROR_INCLUDE, "Recursive include");
+        return;
+    }
+
+    for(i = 0; i < inc->depth; i++)
+    {
+        if(!strcmp(inc->stack[i], path))
+        {
+            xml_set_error(p, XML_ERROR_INCLUDE, "Recursive include");
+            return;
+        }
+    }
+
+    if(inc->depth == XML_INCLUDE_DEPTH)
+    {
+        xml_set_error(p, XML_ERROR_INCLUDE, "Too many nested includes");
+        return;
+    }
+
+    e = include_lookup(inc, p, path);
+    if(!e)
+    {
+        xml_set_error(p, XML_ERROR_INCLUDE, "Can not read include file");
+        return;
+    }
+
+    // nested includes are expanded by this handler during replay
+    inc->stack[inc->depth++] = e->path;
+    e->busy++;
+
+    if(xml_tape_replay(p, &e->tape) == XML_ERROR_MALFORMED)
+    {
+        xml_set_error(p, XML_ERROR_INCLUDE, "Corrupted include cache");
+    }
+
+    e->busy--;
+    inc->depth--;
+}
+
+
+
+void xml_include_init(xml_include_t* inc, char* pool, int pool_size)
+{
+    int i;
+
+    inc->user_ptr = 0;
+    inc->base = 0;
+    inc->cache_dir = 0;
+    inc->resolver = xml_include_resolve;
+    inc->depth = 0;
+    inc->victim = 0;
+
+    xml_init(&inc->parser, pool, pool_size);
+
+    for(i = 0; i < XML_INCLUDE_CACHE; i++)
+    {
+        inc->cache[i].path = 0;
+        inc->cache[i].mtime = 0;
+        inc->cache[i].size = 0;
+        inc->cache[i].busy = 0;
+        xml_tape_init(&inc->cache[i].tape, 0, 0);
+    }
+}
+
+
+
+void xml_include_free(xml_include_t* inc)
+{
+    int i;
+
+    for(i = 0; i < XML_INCLUDE_CACHE; i++)
+    {
+        free(inc->cache[i].path);
+        inc->cache[i].path = 0;
+        xml_tape_free(&inc->cache[i].tape);
+    }
+}
+
+
+
+void xml_include_attach(xml_include_t* inc, xml_parser_t* p)
+{
+    p->include_ptr = inc;
+    xml_set_handler(p, include_pi, XML_INCLUDE_HANDLER);
+}
+
+
+
+int xml_include_resolve(xml_include_t* inc, const char* href, const char* from, char* path, int size)
+{
+    int dir_len = 0;
+    int len = (int)strlen(href);
+
+    // absolute path is used as is
+    if(from && href[0] != '/' && href[0] != '\\' && !(href[0] && href[1] == ':'))
+    {
+        const char* slash = strrchr(from, '/');
+        const char* bslash = strrchr(from, '\\');
+
+        if(bslash > slash) slash = bslash;
+        if(slash) dir_len = (int)(slash - from) + 1;
+    }
+
+    if(dir_len + len >= size) return 1;
+
+    if(dir_len) memcpy(path, from, dir_len);
+    memcpy(path + dir_len, href, len + 1);
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlinclude.h
+// expansion of <?include file?> processing instructions
+// included files are tokenized once and cached as event tapes
+
+#ifndef __XMLINCLUDE_H__
+#define __XMLINCLUDE_H__
+
+#include <stdint.h>
+#include "xmlparser.h"
+#include "xmltape.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max nesting of included files
+#define XML_INCLUDE_DEPTH   8
+
+// number of cached fragments, must be larger than XML_INCLUDE_DEPTH
+#define XML_INCLUDE_CACHE   32
+
+// max length of resolved include path
+#define XML_INCLUDE_PATH    1024
+
+typedef struct xml_include_s xml_include_t;
+typedef struct xml_include_entry_s xml_include_entry_t;
+
+struct xml_include_entry_s
+{
+    char* path;
+    int64_t mtime;
+    int64_t size;
+    int busy;
+    xml_tape_t tape;
+};
+
+struct xml_include_s
+{
+    void* user_ptr;
+    const char* base;           // path of main document
+    const char* cache_dir;      // if not 0 fragment tapes are also cached on disk
+    int (*resolver)(xml_include_t* inc, const char* href, const char* from, char* path, int size);
+    xml_parser_t parser;        // parser used to tokenize included files
+    const char* stack[XML_INCLUDE_DEPTH];
+    int depth;
+    int victim;
+    xml_include_entry_t cache[XML_INCLUDE_CACHE];
+};
+
+
+// pool is used for tokenizing included files
+void xml_include_init(xml_include_t* inc, char* pool, int pool_size);
+
+void xml_include_free(xml_include_t* inc);
+
+// expand includes found by p, events from included files are passed
+// to handlers of p with levels continuing from the include PI
+// included files are tokenized with options and limits of p and depth limit
+// of p applies to their elements at their level in p
+void xml_include_attach(xml_include_t* inc, xml_parser_t* p);
+
+// default resolver: href relative to directory of including file from
+// returns 0 on success
+int xml_include_resolve(xml_include_t* inc, const char* href, const char* from, char* path, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLINCLUDE_H__
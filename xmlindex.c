@@ -0,0 +1,265 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlindex.c
+
+#include <string.h>
+#include "xmlindex.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// find first '>', '"' or '\'' in [ptr, end)
+static const char* index_find_tag_char(const char* ptr, const char* end)
+{
+#ifdef __SSE2__
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i dq = _mm_set1_epi8('"');
+    const __m128i sq = _mm_set1_epi8('\'');
+
+    while(end - ptr >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_or_si128(_mm_cmpeq_epi8(v, dq), _mm_cmpeq_epi8(v, sq)));
+        int mask = _mm_movemask_epi8(m);
+
+        if(mask) return ptr + __builtin_ctz(mask);
+        ptr += 16;
+    }
+#endif
+
+    while(ptr < end && *ptr != '>' && *ptr != '"' && *ptr != '\'') ptr++;
+    return ptr;
+}
+
+
+
+// find end of tag, '>' inside quoted attribute values is skipped
+// returns pointer after '>' or 0 if end of buffer is reached
+static const char* index_find_tag_end(const char* ptr, const char* end)
+{
+    while(1)
+    {
+        ptr = index_find_tag_char(ptr, end);
+        if(ptr == end) return 0;
+        if(*ptr == '>') return ptr + 1;
+
+        // skip quoted value
+        ptr = memchr(ptr + 1, *ptr, end - ptr - 1);
+        if(!ptr) return 0;
+        ptr++;
+    }
+}
+
+
+
+// find string s of len chars in [ptr, end)
+// returns pointer after s or 0 if not found
+static const char* index_find_str(const char* ptr, const char* end, const char* s, int len)
+{
+    while(end - ptr >= len)
+    {
+        ptr = memchr(ptr, s[0], end - ptr - len + 1);
+        if(!ptr) return 0;
+        if(!memcmp(ptr, s, len)) return ptr + len;
+        ptr++;
+    }
+
+    return 0;
+}
+
+
+
+void xml_index_init(xml_index_t* idx, xml_index_entry_t* entries, int capacity)
+{
+    idx->buf = 0;
+    idx->size = 0;
+    idx->entries = entries;
+    idx->count = 0;
+    idx->capacity = capacity;
+}
+
+
+
+int xml_index_build(xml_index_t* idx, const char* buf, size_t size)
+{
+    const char* end = buf + size;
+    const char* ptr = buf;
+    const char* tag;
+    xml_index_entry_t* e;
+    int current = -1;   // currently open element
+
+    idx->buf = buf;
+    idx->size = size;
+    idx->count = 0;
+
+    while(1)
+    {
+        ptr = memchr(ptr, '<', end - ptr);
+        if(!ptr) break;
+
+        tag = ptr++;
+        if(ptr == end) return XML_ERROR_DOCUMENT_END;
+
+        if(*ptr == '!')
+        {
+            if(end - ptr >= 3 && ptr[1] == '-' && ptr[2] == '-') ptr = index_find_str(ptr + 3, end, "-->", 3);
+            else if(end - ptr >= 8 && !memcmp(ptr, "![CDATA[", 8)) ptr = index_find_str(ptr + 8, end, "]]>", 3);
+            else ptr = index_find_tag_end(ptr, end);
+        }
+        else if(*ptr == '?')
+        {
+            ptr = index_find_str(ptr + 1, end, "?>", 2);
+        }
+        else if(*ptr == '/')
+        {
+            ptr = memchr(ptr, '>', end - ptr);
+            if(!ptr) return XML_ERROR_DOCUMENT_END;
+            ptr++;
+
+            if(current < 0) return XML_ERROR_MALFORMED;
+
+            e = idx->entries + current;
+            e->end = ptr - buf;
+            e->skip = idx->count;
+            current = e->parent;
+        }
+        else
+        {
+            ptr = index_find_tag_end(ptr, end);
+            if(!ptr) return XML_ERROR_DOCUMENT_END;
+
+            if(idx->count == idx->capacity) return XML_ERROR_NO_MEMORY;
+
+            e = idx->entries + idx->count;
+            e->begin = tag - buf;
+            e->tag_end = ptr - buf;
+            e->parent = current;
+            e->depth = current < 0 ? 1 : idx->entries[current].depth + 1;
+
+            if(ptr[-2] == '/')
+            {
+                // empty element tag
+                e->end = e->tag_end;
+                e->skip = idx->count + 1;
+            }
+            else current = idx->count;
+
+            idx->count++;
+        }
+
+        if(!ptr) return XML_ERROR_DOCUMENT_END;
+    }
+
+    if(current >= 0) return XML_ERROR_DOCUMENT_END;
+
+    return XML_ERROR_NONE;
+}
+
+
+
+const char* xml_index_name(const xml_index_t* idx, int i, int* len)
+{
+    const char* name = idx->buf + idx->entries[i].begin + 1;
+    const char* end = idx->buf + idx->entries[i].tag_end;
+    const char* ptr = name;
+
+    while(ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && *ptr != '\r' && *ptr != '/' && *ptr != '>') ptr++;
+
+    *len = (int)(ptr - name);
+    return name;
+}
+
+
+
+int xml_index_first_child(const xml_index_t* idx, int parent)
+{
+    if(parent < 0) return idx->count ? 0 : -1;
+    if(parent + 1 < idx->entries[parent].skip) return parent + 1;
+    return -1;
+}
+
+
+
+int xml_index_next_sibling(const xml_index_t* idx, int i)
+{
+    int next = idx->entries[i].skip;
+
+    if(next < idx->count && idx->entries[next].parent == idx->entries[i].parent) return next;
+    return -1;
+}
+
+
+
+int xml_index_child(const xml_index_t* idx, int parent, int n)
+{
+    int i = xml_index_first_child(idx, parent);
+
+    while(i >= 0 && n--) i = xml_index_next_sibling(idx, i);
+
+    return i;
+}
+
+
+
+int xml_index_find_child(const xml_index_t* idx, int parent, const char* name, int n)
+{
+    int name_len = (int)strlen(name);
+    int i, len;
+    const char* s;
+
+    for(i = xml_index_first_child(idx, parent); i >= 0; i = xml_index_next_sibling(idx, i))
+    {
+        s = xml_index_name(idx, i, &len);
+        if(len == name_len && !memcmp(s, name, len) && !n--) return i;
+    }
+
+    return -1;
+}
+
+
+
+int xml_index_children(const xml_index_t* idx, int parent, int* out, int max)
+{
+    int i, n = 0;
+
+    for(i = xml_index_first_child(idx, parent); i >= 0; i = xml_index_next_sibling(idx, i))
+    {
+        if(n < max) out[n] = i;
+        n++;
+    }
+
+    return n;
+}
+
+
+
+void xml_index_parse(xml_parser_t* p, const xml_index_t* idx, int i)
+{
+    const xml_index_entry_t* e = idx->entries + i;
+
+    xml_parse_buffer(p, (char*)idx->buf + e->begin, e->end - e->begin);
+}
@@ -0,0 +1,90 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlindex.h
+// structural index of xml document: one entry per element with its span and depth
+// built with one fast scan, without copying anything to parser pool
+
+#ifndef __XMLINDEX_H__
+#define __XMLINDEX_H__
+
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xml_index_entry_s xml_index_entry_t;
+typedef struct xml_index_s xml_index_t;
+
+struct xml_index_entry_s
+{
+    size_t begin;       // offset of '<' of start tag
+    size_t tag_end;     // offset after '>' of start tag
+    size_t end;         // offset after '>' of end tag
+    int depth;          // same as xml_parser_t::level in start_element_handler
+    int parent;         // index of parent entry or -1
+    int skip;           // index of first entry after this element's subtree
+};
+
+struct xml_index_s
+{
+    const char* buf;
+    size_t size;
+    xml_index_entry_t* entries;
+    int count;
+    int capacity;
+};
+
+
+void xml_index_init(xml_index_t* idx, xml_index_entry_t* entries, int capacity);
+
+// index size bytes of buf
+// returns XML_ERROR_NONE, XML_ERROR_NO_MEMORY if there is not enough entries,
+// XML_ERROR_MALFORMED or XML_ERROR_DOCUMENT_END
+int xml_index_build(xml_index_t* idx, const char* buf, size_t size);
+
+// returns pointer to tag name of entry i and its length in len
+const char* xml_index_name(const xml_index_t* idx, int i, int* len);
+
+// navigation, all return entry index or -1
+// parent -1 means document level
+int xml_index_first_child(const xml_index_t* idx, int parent);
+int xml_index_next_sibling(const xml_index_t* idx, int i);
+int xml_index_child(const xml_index_t* idx, int parent, int n);
+int xml_index_find_child(const xml_index_t* idx, int parent, const char* name, int n);
+
+// store indices of all children of parent to out, so n-th child can be accessed directly
+// returns number of children (can be larger than max)
+int xml_index_children(const xml_index_t* idx, int parent, int* out, int max);
+
+// parse element i (with its subtree) with p
+// levels reported to handlers are relative to element i
+void xml_index_parse(xml_parser_t* p, const xml_index_t* idx, int i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLINDEX_H__
@@ -0,0 +1,594 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmljson.c
+
+#include <string.h>
+#include <stdlib.h>
+#include "xmljson.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// xml_json_frame_t::kind
+enum
+{
+    JSON_NONE = 0,
+    JSON_STRING,
+    JSON_OBJECT,
+};
+
+
+
+static void json_error(xml_json_t* j, int err, const char* errstr)
+{
+    if(j->errorcode) return;
+    j->errorcode = err;
+    j->errorstr = errstr;
+}
+
+
+
+// report conversion error to parser once
+static void json_report(xml_json_t* j, xml_parser_t* p)
+{
+    if(j->errorcode && !j->reported)
+    {
+        j->reported = 1;
+        xml_set_error(p, j->errorcode, j->errorstr);
+    }
+}
+
+
+
+// make space in output buffer
+// values that may still get array or object prefix are kept in buffer,
+// so only output before first such value is flushed; values older than
+// 3/4 of buffer are given up
+// returns 1 if there is no more space, 0 otherwise
+static int json_make_space(xml_json_t* j)
+{
+    int limit = j->capacity / 4 > 0 ? j->capacity / 4 : 1;
+    int m, d;
+
+    if(j->errorcode) return 1;
+
+    if(j->growable)
+    {
+        int capacity = j->capacity ? j->capacity * 2 : 4096;
+        char* buf = realloc(j->buf, capacity);
+
+        if(!buf)
+        {
+            json_error(j, XML_ERROR_NO_MEMORY, "No enough memory for JSON output");
+            return 1;
+        }
+
+        j->buf = buf;
+        j->capacity = capacity;
+        return 0;
+    }
+
+    if(!j->flush || !j->size)
+    {
+        json_error(j, XML_ERROR_NO_MEMORY, "No enough memory for JSON output");
+        return 1;
+    }
+
+    while(1)
+    {
+        int* owner = 0;
+
+        m = j->size;
+        for(d = 0; d < j->depth; d++)
+        {
+            xml_json_frame_t* f = j->frames + d;
+
+            if(f->name_len && !f->in_array && f->child_mark >= 0 && f->child_mark < m)
+            {
+                m = f->child_mark;
+                owner = &f->child_mark;
+            }
+            if(f->kind == JSON_STRING && f->text_mark >= 0 && f->text_mark < m)
+            {
+                m = f->text_mark;
+                owner = &f->text_mark;
+            }
+        }
+
+        if(m >= limit || !owner) break;
+        *owner = -1;
+    }
+
+    if(j->flush(j, j->buf, m))
+    {
+        json_error(j, XML_ERROR_NO_MEMORY, "Can not write JSON output");
+        return 1;
+    }
+
+    memmove(j->buf, j->buf + m, j->size - m);
+    j->size -= m;
+
+    for(d = 0; d < j->depth; d++)
+    {
+        xml_json_frame_t* f = j->frames + d;
+
+        f->child_mark = f->child_mark >= m ? f->child_mark - m : -1;
+        f->text_mark = f->text_mark >= m ? f->text_mark - m : -1;
+    }
+
+    return 0;
+}
+
+
+
+static void json_put(xml_json_t* j, const char* s, int len)
+{
+    int n;
+
+    while(len)
+    {
+        if(j->size == j->capacity && json_make_space(j)) return;
+
+        n = j->capacity - j->size;
+        if(n > len) n = len;
+
+        memcpy(j->buf + j->size, s, n);
+        j->size += n;
+        s += n;
+        len -= n;
+    }
+}
+
+
+
+static void json_putc(xml_json_t* j, char c)
+{
+    if(j->size == j->capacity && json_make_space(j)) return;
+    j->buf[j->size++] = c;
+}
+
+
+
+// make gap of len bytes at *mark
+// returns pointer to gap or 0 if value at mark is already flushed
+static char* json_insert(xml_json_t* j, int* mark, int len)
+{
+    char* gap;
+
+    while(j->capacity - j->size < len)
+    {
+        if(json_make_space(j)) return 0;
+    }
+
+    if(*mark < 0)
+    {
+        json_error(j, XML_ERROR_NO_MEMORY, "No enough memory for JSON lookahead");
+        return 0;
+    }
+
+    gap = j->buf + *mark;
+    memmove(gap + len, gap, j->size - *mark);
+    j->size += len;
+
+    return gap;
+}
+
+
+
+// find first char that has to be escaped in JSON string
+static const char* json_find_special(const char* ptr, const char* end)
+{
+#ifdef __SSE2__
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    const __m128i ctl = _mm_set1_epi8((char)0xe0);
+    const __m128i zero = _mm_setzero_si128();
+
+    while(end - ptr >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quot), _mm_cmpeq_epi8(v, bs)),
+                                 _mm_cmpeq_epi8(_mm_and_si128(v, ctl), zero));
+        int mask = _mm_movemask_epi8(m);
+
+        if(mask) return ptr + __builtin_ctz(mask);
+        ptr += 16;
+    }
+#endif
+
+    while(ptr < end && *ptr != '"' && *ptr != '\\' && (unsigned char)*ptr >= 0x20) ptr++;
+    return ptr;
+}
+
+
+
+// write string content with escaped special chars, clean runs are copied with memcpy
+static void json_put_escaped(xml_json_t* j, const char* s, int len)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char* end = s + len;
+    const char* ptr;
+    char u[6];
+
+    while(s < end)
+    {
+        ptr = json_find_special(s, end);
+        json_put(j, s, (int)(ptr - s));
+        if(ptr == end) break;
+
+        switch(*ptr)
+        {
+            case '"':  json_put(j, "\\\"", 2); break;
+            case '\\': json_put(j, "\\\\", 2); break;
+            case '\n': json_put(j, "\\n", 2); break;
+            case '\r': json_put(j, "\\r", 2); break;
+            case '\t': json_put(j, "\\t", 2); break;
+            case '\b': json_put(j, "\\b", 2); break;
+            case '\f': json_put(j, "\\f", 2); break;
+            default:
+                memcpy(u, "\\u00", 4);
+                u[4] = hex[(*ptr >> 4) & 0xf];
+                u[5] = hex[*ptr & 0xf];
+                json_put(j, u, 6);
+        }
+
+        s = ptr + 1;
+    }
+}
+
+
+
+static void json_key(xml_json_t* j, const char* prefix, const char* name, int len)
+{
+    json_putc(j, '"');
+    json_put(j, prefix, (int)strlen(prefix));
+    json_put_escaped(j, name, len);
+    json_put(j, "\":", 2);
+}
+
+
+
+// close string of text of element
+static void json_close_text(xml_json_t* j, xml_json_frame_t* f)
+{
+    if(f->text_open)
+    {
+        json_putc(j, '"');
+        f->text_open = 0;
+    }
+}
+
+
+
+// start value of child element of f
+// returns 1 on error
+static int json_child(xml_json_t* j, xml_json_frame_t* f, const char* name, int len)
+{
+    json_close_text(j, f);
+
+    if(f->kind == JSON_NONE)
+    {
+        json_putc(j, '{');
+        f->kind = JSON_OBJECT;
+    }
+    else if(f->kind == JSON_STRING)
+    {
+        // mixed content, string becomes text member of object
+        int n = (int)strlen(j->text_key);
+        char* gap = json_insert(j, &f->text_mark, n + 4);
+
+        if(!gap) return 1;
+
+        gap[0] = '{';
+        gap[1] = '"';
+        memcpy(gap + 2, j->text_key, n);
+        gap[n + 2] = '"';
+        gap[n + 3] = ':';
+
+        f->kind = JSON_OBJECT;
+        f->count = 1;
+    }
+
+    // repeated sibling
+    if(f->name_len == len && !memcmp(j->names + f->name_base, name, len))
+    {
+        if(!f->in_array)
+        {
+            char* gap = json_insert(j, &f->child_mark, 1);
+
+            if(!gap) return 1;
+            *gap = '[';
+            f->in_array = 1;
+        }
+        json_putc(j, ',');
+        return 0;
+    }
+
+    if(f->in_array)
+    {
+        json_putc(j, ']');
+        f->in_array = 0;
+    }
+
+    if(f->name_base + len >= XML_JSON_NAMES)
+    {
+        json_error(j, XML_ERROR_NO_MEMORY, "No enough memory for JSON element names");
+        return 1;
+    }
+
+    if(f->count) json_putc(j, ',');
+    json_key(j, "", name, len);
+
+    f->count++;
+    f->child_mark = j->size;
+    memcpy(j->names + f->name_base, name, len);
+    f->name_len = len;
+
+    return 0;
+}
+
+
+
+static void json_start_element(xml_parser_t* p)
+{
+    xml_json_t* j = p->user_ptr;
+    int d = p->level - j->record_level;
+    int len = (int)strlen(p->tag);
+    xml_json_frame_t* f;
+    char* attr_string;
+    xml_attr_t a;
+
+    if(j->errorcode || d < 0) return;
+
+    if(d >= XML_JSON_DEPTH)
+    {
+        json_error(j, XML_ERROR_DEPTH, "Elements nested too deep for JSON");
+        json_report(j, p);
+        return;
+    }
+
+    f = j->frames + d;
+
+    if(d == 0)
+    {
+        // record is object with one member
+        json_putc(j, '{');
+        json_key(j, "", p->tag, len);
+        f->name_base = 0;
+    }
+    else
+    {
+        xml_json_frame_t* parent = f - 1;
+
+        if(json_child(j, parent, p->tag, len))
+        {
+            json_report(j, p);
+            return;
+        }
+        f->name_base = parent->name_base + parent->name_len + 1;
+    }
+
+    f->kind = JSON_NONE;
+    f->text_open = 0;
+    f->count = 0;
+    f->in_array = 0;
+    f->child_mark = -1;
+    f->text_mark = -1;
+    f->name_len = 0;
+    j->depth = d + 1;
+
+    attr_string = p->attr;
+    while(j->attr_prefix && attr_string && xml_next_attr(&attr_string, &a))
+    {
+        json_putc(j, f->count ? ',' : '{');
+        json_key(j, j->attr_prefix, a.name, a.name_len);
+        json_putc(j, '"');
+        json_put_escaped(j, a.value, a.value_len);
+        json_putc(j, '"');
+
+        f->kind = JSON_OBJECT;
+        f->count++;
+    }
+
+    json_report(j, p);
+}
+
+
+
+static void json_end_element(xml_parser_t* p)
+{
+    xml_json_t* j = p->user_ptr;
+    int d = p->level + 1 - j->record_level;
+    xml_json_frame_t* f;
+
+    if(j->errorcode || d < 0 || d >= j->depth) return;
+
+    f = j->frames + d;
+
+    json_close_text(j, f);
+    if(f->in_array) json_putc(j, ']');
+
+    if(f->kind == JSON_NONE) json_put(j, "null", 4);
+    else if(f->kind == JSON_OBJECT) json_putc(j, '}');
+
+    j->depth = d;
+    if(d == 0) json_put(j, "}\n", 2);
+
+    json_report(j, p);
+}
+
+
+
+static void json_text(xml_parser_t* p, const char* text)
+{
+    xml_json_t* j = p->user_ptr;
+    int d = p->level - j->record_level;
+    int len = (int)strlen(text);
+    xml_json_frame_t* f;
+    int i;
+
+    if(j->errorcode || d < 0 || d >= j->depth) return;
+
+    for(i = 0; i < len; i++)
+    {
+        if(text[i] != ' ' && text[i] != '\t' && text[i] != '\n' && text[i] != '\r') break;
+    }
+    if(i == len) return;
+
+    f = j->frames + d;
+
+    if(!f->text_open)
+    {
+        if(f->kind == JSON_NONE)
+        {
+            f->kind = JSON_STRING;
+            f->text_mark = j->size;
+        }
+        else
+        {
+            // text after child elements
+            if(f->in_array)
+            {
+                json_putc(j, ']');
+                f->in_array = 0;
+            }
+            f->name_len = 0;
+
+            if(f->count) json_putc(j, ',');
+            json_putc(j, '"');
+            json_put(j, j->text_key, (int)strlen(j->text_key));
+            json_put(j, "\":", 2);
+            f->count++;
+        }
+
+        json_putc(j, '"');
+        f->text_open = 1;
+    }
+
+    json_put_escaped(j, text, len);
+
+    json_report(j, p);
+}
+
+
+
+// parser text is raw, references are decoded in place before escaping
+static void json_characters(xml_parser_t* p)
+{
+    xml_text_decode(p->chars, (int)strlen(p->chars));
+    json_text(p, p->chars);
+}
+
+
+
+static void json_cdata(xml_parser_t* p)
+{
+    json_text(p, p->cdata);
+}
+
+
+
+static void json_parse_error(xml_parser_t* p)
+{
+    xml_json_t* j = p->user_ptr;
+
+    if(!j->errorcode)
+    {
+        j->errorcode = p->errorcode;
+        j->errorstr = p->errorstr;
+        j->reported = 1;
+    }
+}
+
+
+
+void xml_json_init(xml_json_t* j, char* buf, int size, int (*flush)(xml_json_t* j, const char* data, int len))
+{
+    j->user_ptr = 0;
+    j->buf = buf;
+    j->size = 0;
+    j->capacity = buf ? size : 0;
+    j->growable = buf ? 0 : 1;
+    j->errorcode = XML_ERROR_NONE;
+    j->errorstr = 0;
+    j->reported = 0;
+    j->attr_prefix = "@";
+    j->text_key = "#text";
+    j->record_level = 1;
+    j->depth = 0;
+    j->flush = flush;
+}
+
+
+
+void xml_json_free(xml_json_t* j)
+{
+    if(j->growable) free(j->buf);
+    j->buf = 0;
+    j->size = 0;
+    j->capacity = 0;
+}
+
+
+
+void xml_json_set_keys(xml_json_t* j, const char* attr_prefix, const char* text_key)
+{
+    j->attr_prefix = attr_prefix;
+    j->text_key = text_key ? text_key : "#text";
+}
+
+
+
+void xml_json_set_record_level(xml_json_t* j, int level)
+{
+    j->record_level = level > 0 ? level : 1;
+}
+
+
+
+void xml_json_attach(xml_json_t* j, xml_parser_t* p)
+{
+    p->user_ptr = j;
+    xml_set_handler(p, json_parse_error, XML_ERROR_HANDLER);
+    xml_set_handler(p, json_start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, json_end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, json_characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, json_cdata, XML_CDATA_HANDLER);
+}
+
+
+
+int xml_json_finish(xml_json_t* j)
+{
+    if(!j->errorcode && !j->growable && j->size)
+    {
+        if(!j->flush || j->flush(j, j->buf, j->size)) json_error(j, XML_ERROR_NO_MEMORY, "Can not write JSON output");
+        else j->size = 0;
+    }
+
+    return j->errorcode;
+}
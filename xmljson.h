@@ -0,0 +1,122 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmljson.h
+// streaming conversion of xml to JSON or NDJSON driven by parser handlers
+//
+// every element at record level is written as one JSON object on its own line,
+// record level 1 converts whole document to one object:
+//     <a id="1"><b>x</b><b>y</b><c/>text</a>
+//     {"a":{"@id":"1","b":["x","y"],"c":null,"#text":"text"}}
+//
+// element without attributes and children is string or null if it is empty,
+// attributes are members with attribute prefix, text of element with
+// attributes or children is member with text key; whitespace only text is
+// dropped; text split by comments or CDATA is joined to one string
+//
+// repeated adjacent siblings are written as array, which is detected when
+// next sibling starts, so start of array value is kept in output buffer;
+// siblings repeated after other elements are written as duplicate keys
+// if output buffer is flushed, lookahead is bounded by 3/4 of buffer size and
+// first value of array or text followed by child element that do not fit
+// cause XML_ERROR_NO_MEMORY
+
+#ifndef __XMLJSON_H__
+#define __XMLJSON_H__
+
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max nesting of elements below record level
+#define XML_JSON_DEPTH  64
+
+// size of storage for names of last child elements of open elements
+#define XML_JSON_NAMES  1024
+
+typedef struct xml_json_frame_s xml_json_frame_t;
+typedef struct xml_json_s xml_json_t;
+
+struct xml_json_frame_s
+{
+    int kind;               // nothing, string or object is written for element
+    int text_open;          // string of text is not closed with '"' yet
+    int count;              // number of object members
+    int in_array;           // last child element is written as array
+    int child_mark;         // output position of value of last child element or -1
+    int text_mark;          // output position of string value or -1
+    int name_base;          // name of last child element in names
+    int name_len;           // 0 if there is no last child element
+};
+
+struct xml_json_s
+{
+    void* user_ptr;
+    char* buf;
+    int size;
+    int capacity;
+    int growable;
+    int errorcode;
+    const char* errorstr;
+    int reported;           // error is reported to parser
+    const char* attr_prefix;
+    const char* text_key;
+    int record_level;
+    int depth;              // number of open frames
+    int (*flush)(xml_json_t* j, const char* data, int len);
+    xml_json_frame_t frames[XML_JSON_DEPTH];
+    char names[XML_JSON_NAMES];
+};
+
+
+// if buf is 0 output buffer is allocated with malloc and grows as needed
+// otherwise flush is called when buf is full, flush must write len bytes
+// of data and return 0 on success
+void xml_json_init(xml_json_t* j, char* buf, int size, int (*flush)(xml_json_t* j, const char* data, int len));
+
+void xml_json_free(xml_json_t* j);
+
+// attribute prefix 0 drops attributes, default prefix is "@" and text key "#text"
+// keys are written as they are, without escaping
+void xml_json_set_keys(xml_json_t* j, const char* attr_prefix, const char* text_key);
+
+// level of elements written as JSON lines, default is 1 (root element)
+// elements above record level and their text are skipped
+void xml_json_set_record_level(xml_json_t* j, int level);
+
+// set handlers of p, p->user_ptr is set to j
+// attribute values are not decoded with XML_OPTION_LAZY_ATTRS
+void xml_json_attach(xml_json_t* j, xml_parser_t* p);
+
+// pass buffered output to flush callback
+// returns XML_ERROR_NONE or code of first parser or conversion error
+int xml_json_finish(xml_json_t* j);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLJSON_H__
@@ -0,0 +1,398 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlnum.c
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <locale.h>
+#include "xmlnum.h"
+#include "xmlpow5.h"
+
+
+// exact powers of 10 for fast path of xml_attr_to_double
+static const double pow10_table[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+
+static int is_digit(char c)
+{
+    return (unsigned)(c - '0') <= 9;
+}
+
+
+
+static void trim(const char** s, int* len)
+{
+    while(*len && is_space(**s)) (*s)++, (*len)--;
+    while(*len && is_space((*s)[*len - 1])) (*len)--;
+}
+
+
+
+// convert 8 digits at s with SWAR
+// returns 0 if any of 8 chars is not a digit
+static int swar_digits(const char* s, uint64_t* value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t x;
+
+    memcpy(&x, s, 8);
+
+    // every byte must be in 0x30 .. 0x39
+    if(((x & 0xF0F0F0F0F0F0F0F0ULL) | (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) != 0x3333333333333333ULL) return 0;
+
+    x -= 0x3030303030303030ULL;
+    x = x * 10 + (x >> 8);
+    x = ((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) + ((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+
+    *value = x;
+    return 1;
+#else
+    (void)s;
+    (void)value;
+    return 0;
+#endif
+}
+
+
+
+// accumulate digits from s[i] to *m, only first 19 significant digits are kept
+// *n is incremented by number of digits, returns index of first char that is not a digit
+static int parse_digits(const char* s, int len, int i, uint64_t* m, int* n)
+{
+    uint64_t v;
+
+    while(*n <= 19 - 8 && len - i >= 8 && swar_digits(s + i, &v))
+    {
+        *m = *m * 100000000 + v;
+        *n += 8;
+        i += 8;
+    }
+
+    for(; i < len && is_digit(s[i]); i++, (*n)++)
+    {
+        if(*n < 19) *m = *m * 10 + (s[i] - '0');
+    }
+
+    return i;
+}
+
+
+
+int xml_attr_to_int64(const char* s, int len, int64_t* value)
+{
+    uint64_t m = 0;
+    int neg = 0, n = 0, i = 0;
+
+    trim(&s, &len);
+
+    if(len && (*s == '-' || *s == '+'))
+    {
+        neg = *s == '-';
+        s++;
+        len--;
+    }
+
+    if(!len) return XML_ERROR_VALUE;
+
+    while(i < len && s[i] == '0') i++;
+    i = parse_digits(s, len, i, &m, &n);
+    if(i != len) return XML_ERROR_VALUE;
+
+    // 19 digits always fit in uint64_t
+    if(n > 19 || m > (uint64_t)INT64_MAX + neg)
+    {
+        *value = neg ? INT64_MIN : INT64_MAX;
+        return XML_ERROR_RANGE;
+    }
+
+    *value = neg ? (int64_t)(0 - m) : (int64_t)m;
+    return XML_ERROR_NONE;
+}
+
+
+
+static uint64_t mul128(uint64_t a, uint64_t b, uint64_t* hi)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+
+    *hi = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi, p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+    uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+
+    *hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+    return (mid << 32) | (uint32_t)p0;
+#endif
+}
+
+
+
+static int clz64(uint64_t x)
+{
+#ifdef __GNUC__
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+
+    while(!(x & 0x8000000000000000ULL))
+    {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+
+
+// Eisel-Lemire: w * 10^q rounded to nearest double, w != 0
+// returns 0 if result can not be decided or is subnormal or infinite
+static int eisel_lemire(uint64_t w, int q, int neg, double* value)
+{
+    const uint64_t* t = xml_pow5_table[q - XML_POW5_MIN];
+    int64_t exponent = (((152170 + 65536) * (int64_t)q) >> 16) + 1024 + 63;
+    int lz = clz64(w);
+    uint64_t upper, lower, upperbit, mantissa, bits;
+
+    w <<= lz;
+    lower = mul128(w, t[0], &upper);
+
+    // product is not exact enough, use lower 64 bits of power
+    if((upper & 0x1FF) == 0x1FF && lower + w < lower)
+    {
+        uint64_t high, middle2;
+        uint64_t low = mul128(w, t[1], &middle2);
+        uint64_t middle = lower + middle2;
+
+        high = upper;
+        if(middle < lower) high++;
+
+        if(middle + 1 == 0 && (high & 0x1FF) == 0x1FF && low + w < low) return 0;
+
+        upper = high;
+        lower = middle;
+    }
+
+    upperbit = upper >> 63;
+    mantissa = upper >> (upperbit + 9);
+    lz += (int)(1 ^ upperbit);
+
+    // exactly halfway between two doubles
+    if(lower == 0 && (upper & 0x1FF) == 0 && (mantissa & 3) == 1) return 0;
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= (1ULL << 53))
+    {
+        mantissa = 1ULL << 52;
+        lz--;
+    }
+    mantissa &= ~(1ULL << 52);
+
+    exponent -= lz;
+    if(exponent < 1 || exponent > 2046) return 0;
+
+    bits = mantissa | (uint64_t)exponent << 52 | (uint64_t)neg << 63;
+    memcpy(value, &bits, sizeof(bits));
+    return 1;
+}
+
+
+
+// slow path with strtod for values Eisel-Lemire can not decide
+static int strtod_fallback(const char* s, int len, int neg, double* value)
+{
+    char local[128];
+    char* buf = local;
+    char* end;
+    char point = *localeconv()->decimal_point;
+    int i, err = XML_ERROR_NONE;
+
+    if(len >= (int)sizeof(local))
+    {
+        buf = malloc(len + 1);
+        if(!buf) return XML_ERROR_NO_MEMORY;
+    }
+
+    // decimal point of current locale
+    for(i = 0; i < len; i++) buf[i] = s[i] == '.' ? point : s[i];
+    buf[len] = 0;
+
+    *value = strtod(buf, &end);
+    if(neg) *value = -*value;
+
+    if(end != buf + len) err = XML_ERROR_VALUE;
+    else if(isinf(*value) || *value == 0) err = XML_ERROR_RANGE;
+
+    if(buf != local) free(buf);
+    return err;
+}
+
+
+
+int xml_attr_to_double(const char* s, int len, double* value)
+{
+    uint64_t m = 0;
+    int neg = 0, n = 0, kept, i = 0, any = 0;
+    int64_t exp = 0;
+    double v;
+
+    trim(&s, &len);
+
+    if(len && (*s == '-' || *s == '+'))
+    {
+        neg = *s == '-';
+        s++;
+        len--;
+    }
+
+    if(len == 3 && !memcmp(s, "INF", 3))
+    {
+        *value = neg ? -HUGE_VAL : HUGE_VAL;
+        return XML_ERROR_NONE;
+    }
+    if(len == 3 && !memcmp(s, "NaN", 3))
+    {
+        *value = NAN;
+        return XML_ERROR_NONE;
+    }
+
+    // integer part, digits after first 19 only scale the value
+    while(i < len && s[i] == '0') i++, any = 1;
+    kept = i;
+    i = parse_digits(s, len, i, &m, &n);
+    if(i != kept) any = 1;
+    if(n > 19) exp = n - 19;
+
+    // fraction
+    if(i < len && s[i] == '.')
+    {
+        int before = n;
+
+        i++;
+        if(!n) while(i < len && s[i] == '0') i++, exp--, any = 1;
+
+        kept = i;
+        i = parse_digits(s, len, i, &m, &n);
+        if(i != kept) any = 1;
+        exp -= (n < 19 ? n : 19) - (before < 19 ? before : 19);
+    }
+
+    if(!any) return XML_ERROR_VALUE;
+
+    // exponent
+    if(i < len && (s[i] == 'e' || s[i] == 'E'))
+    {
+        int64_t e = 0;
+        int eneg = 0;
+
+        i++;
+        if(i < len && (s[i] == '-' || s[i] == '+')) eneg = s[i++] == '-';
+        if(i == len) return XML_ERROR_VALUE;
+
+        for(; i < len && is_digit(s[i]); i++)
+        {
+            if(e < 100000) e = e * 10 + (s[i] - '0');
+        }
+
+        exp += eneg ? -e : e;
+    }
+
+    if(i != len) return XML_ERROR_VALUE;
+
+    if(!m)
+    {
+        *value = neg ? -0.0 : 0.0;
+        return XML_ERROR_NONE;
+    }
+
+    // m < 10^19 so value is below half of smallest subnormal or above largest double
+    if(exp < -19 - 324)
+    {
+        *value = neg ? -0.0 : 0.0;
+        return XML_ERROR_RANGE;
+    }
+    if(exp > 308)
+    {
+        *value = neg ? -HUGE_VAL : HUGE_VAL;
+        return XML_ERROR_RANGE;
+    }
+
+    // Clinger: both m and 10^exp are exact doubles, result is correctly rounded
+    if(n <= 19 && m <= (1ULL << 53) && exp >= -22 && exp <= 22)
+    {
+        v = (double)m;
+        v = exp < 0 ? v / pow10_table[-exp] : v * pow10_table[exp];
+        *value = neg ? -v : v;
+        return XML_ERROR_NONE;
+    }
+
+    if(exp >= XML_POW5_MIN && eisel_lemire(m, (int)exp, neg, value))
+    {
+        double up;
+
+        // truncated digits: result is correct if it is same for m and m + 1
+        if(n <= 19 || (eisel_lemire(m + 1, (int)exp, neg, &up) && up == *value)) return XML_ERROR_NONE;
+    }
+
+    return strtod_fallback(s, len, neg, value);
+}
+
+
+
+int xml_attr_to_bool(const char* s, int len, int* value)
+{
+    trim(&s, &len);
+
+    if((len == 4 && !memcmp(s, "true", 4)) || (len == 3 && !memcmp(s, "yes", 3)) || (len == 1 && *s == '1'))
+    {
+        *value = 1;
+        return XML_ERROR_NONE;
+    }
+    if((len == 5 && !memcmp(s, "false", 5)) || (len == 2 && !memcmp(s, "no", 2)) || (len == 1 && *s == '0'))
+    {
+        *value = 0;
+        return XML_ERROR_NONE;
+    }
+
+    return XML_ERROR_VALUE;
+}
@@ -0,0 +1,58 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlnum.h
+// locale independent conversion of attribute values and text to numbers
+//
+// values are pointer/length views, leading and trailing white space is ignored
+// functions return XML_ERROR_NONE, XML_ERROR_VALUE if value is not a number or
+// XML_ERROR_RANGE if number does not fit in result, in which case result is
+// saturated (INT64_MIN/INT64_MAX, +-HUGE_VAL or +-0)
+// xml_attr_to_double can also return XML_ERROR_NO_MEMORY for very long values
+
+#ifndef __XMLNUM_H__
+#define __XMLNUM_H__
+
+#include <stdint.h>
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// decimal integer with optional sign
+int xml_attr_to_int64(const char* s, int len, int64_t* value);
+
+// decimal floating point number with optional exponent, INF, -INF and NaN
+// result is correctly rounded
+int xml_attr_to_double(const char* s, int len, double* value);
+
+// true, yes and 1 are 1, false, no and 0 are 0
+int xml_attr_to_bool(const char* s, int len, int* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLNUM_H__
@@ -25,18 +25,42 @@
 // xmlparser.c
 
 #include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 //#include <stdio.h>
 #include "xmlparser.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef XML_HAVE_THREADS
+#include <pthread.h>
+#endif
+
+#ifdef __GNUC__
+#define XML_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define XML_PREFETCH(addr) ((void)(addr))
+#endif
+
 void log_debug(const char* format, ...);
 
-#define XML_ERROR(code, string) xml_set_error(p, (code), (string))
+// errors are not reported while parsing is suspended waiting for next chunk of input,
+// parsing will be repeated from the start of current token
+#define XML_ERROR(code, string) do { if(!p->suspended) xml_parse_error(p, (code), (string)); } while(0)
 
 // macro to update pointers and return
 #define RETURN(n) do { p->pool = pool; p->pool_size = pool_size; return (n); } while(0)
 
+// events are not delivered while broken record is skipped in recovery mode
+#ifndef XML_NO_RECOVER
+#define XML_SKIPPING(p) ((p)->skip_level >= 0)
+#else
+#define XML_SKIPPING(p) 0
+#endif
+
 
 /*
     Allowed characters:
@@ -69,19 +93,111 @@ enum
     STATE_COMMENT,
     STATE_CDATA,
     STATE_ATTR,
+    STATE_RAW_ATTR,
+    STATE_RESYNC,           // recovery states are last
+    STATE_RESYNC_TAG,
 };
 
 
 
-// get next char from string
+// report parser error, in recovery mode parser is switched to resync state
+// and rest of broken record is skipped
+static void xml_parse_error(xml_parser_t* p, int code, const char* string)
+{
+#ifndef XML_NO_RECOVER
+    int fatal = code == XML_ERROR_DOCUMENT_END || code == XML_ERROR_SIZE;
+
+    // errors in skipped part of broken record are not reported again
+    if(p->skip_level < 0 || fatal) xml_set_error(p, code, string);
+
+    if(!(p->options & XML_OPTION_RECOVER) || fatal) return;
+
+    // end tag of broken start tag will come later, so it has to be counted as open element
+    if(p->state == STATE_TAG || p->state == STATE_ATTR || p->state == STATE_RAW_ATTR) p->state = STATE_RESYNC_TAG;
+    else p->state = STATE_RESYNC;
+
+    if(p->skip_level < 0 && p->record_level && p->level >= p->record_level)
+    {
+        p->skip_level = p->level;
+        p->skip_end = p->record_level;
+    }
+#else
+    xml_set_error(p, code, string);
+#endif
+}
+
+
+// elements opened while broken record is skipped are not delivered
+static void xml_start_element(xml_parser_t* p)
+{
+    if(p->start_element_handler && !XML_SKIPPING(p)) p->start_element_handler(p);
+}
+
+
+// p->level is already decremented, so closed element was opened after error if p->level >= skip_level
+static void xml_end_element(xml_parser_t* p)
+{
+#ifndef XML_NO_RECOVER
+    if(p->skip_level >= 0)
+    {
+        int skip = p->level >= p->skip_level;
+
+        if(!skip) p->skip_level = p->level;
+        if(p->level < p->skip_end) p->skip_level = -1;
+        if(skip) return;
+    }
+#endif
+
+    if(p->end_element_handler) p->end_element_handler(p);
+}
+
+
+
+// get next char from string
 // all kinds of line endings converted to '\n' ('\r' ignored in "\r\n", converted to '\n' in "\r")
+// p->src is not moved past terminating zero, so reads after end of input keep returning -1
 static int get_xml_char(xml_parser_t* p)
 {
     int i = *(p->src);
+
+    if(!i) return -1;
+    p->src++;
+
+    if(i == '\r')
+    {
+        i = *(p->src);
+        if(i == '\n') p->src++;
+        else if(!i) i = -1;
+        else i = '\n';
+    }
+
+    return i;
+}
+
+
+// get next char from buffer ending at p->src_end
+// if p->more is set parser is suspended at the end of buffer
+static int get_xml_buffer_char(xml_parser_t* p)
+{
+    int i;
+
+    if(p->src >= p->src_end)
+    {
+        if(p->more) p->suspended = 1;
+        return -1;
+    }
+
+    i = *(p->src);
     p->src++;
 
     if(i == '\r')
     {
+        if(p->src >= p->src_end)
+        {
+            if(!p->more) return '\n';
+            p->suspended = 1;
+            return -1;
+        }
         i = *(p->src);
         if(i == '\n') p->src++;
         else if(!i) i = -1;
@@ -93,9 +209,180 @@ static int get_xml_char(xml_parser_t* p)
 }
 
 
+// classes of chars that end a run copied by xml_copy_run
+enum
+{
+    CC_LT       = 0x001,    // '<' ends characters
+    CC_TAG      = 0x002,    // ' ', '>', '/' end tag name
+    CC_EQ       = 0x004,    // '=' ends attribute name
+    CC_QUOT     = 0x008,    // '"', '&' in attribute value
+    CC_APOS     = 0x010,    // '\'', '&' in attribute value
+    CC_QM       = 0x020,    // '?' ends PI
+    CC_GT       = 0x040,    // '>' ends end tag
+    CC_COMMENT  = 0x080,    // '-', '>' in comment
+    CC_CDATA    = 0x100,    // ']', '>' in CDATA
+    CC_RAW      = 0x200,    // '"', '\'', '>' in raw attributes
+    CC_ALL      = 0x3FF,    // '\0' and '\r' end every run
+};
+
+static const unsigned short char_class[256] =
+{
+    [0] = CC_ALL,
+    ['\r'] = CC_ALL,
+    ['<'] = CC_LT,
+    [' '] = CC_TAG,
+    ['/'] = CC_TAG,
+    ['>'] = CC_TAG | CC_GT | CC_COMMENT | CC_CDATA | CC_RAW,
+    ['='] = CC_EQ,
+    ['"'] = CC_QUOT | CC_RAW,
+    ['\''] = CC_APOS | CC_RAW,
+    ['&'] = CC_QUOT | CC_APOS,
+    ['?'] = CC_QM,
+    ['-'] = CC_COMMENT,
+    [']'] = CC_CDATA,
+};
+
+
+// copy chars to pool until char of class cc
+// runs from string and buffer sources are scanned in place and pool capacity
+// is checked once for the whole run, line endings and end of input go through get_char
+// returns char that ended the run (not copied), -1 at the end of input or -2 if pool is full
+static int xml_copy_run(xml_parser_t* p, char** pool, int* pool_size, int cc)
+{
+    int c;
+
+    while(1)
+    {
+        if(p->get_char == get_xml_char || p->get_char == get_xml_buffer_char)
+        {
+            const char* s = p->src;
+            char* d = *pool;
+            int n = 0, max = *pool_size;
+
+            if(p->get_char == get_xml_buffer_char && p->src_end - s < max) max = (int)(p->src_end - s);
+
+            // copy while scanning, runs are mostly short
+            for(; n < max; n++)
+            {
+                unsigned char ch = s[n];
+                if(char_class[ch] & cc) break;
+                d[n] = ch;
+            }
+
+            *pool += n;
+            *pool_size -= n;
+            p->src += n;
+        }
+
+        c = p->get_char(p);
+        if(c == -1 || (char_class[(unsigned char)c] & cc)) return c;
+
+        // '\n' converted from '\r' or char after full pool
+        if(!*pool_size) return -2;
+
+        *(*pool)++ = c;
+        (*pool_size)--;
+    }
+}
+
+
+
+static int is_space(int c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+// skip whitespace of string or buffer source without copying it to pool
+static void xml_skip_space(xml_parser_t* p)
+{
+    const char* s = p->src;
+
+    if(p->get_char == get_xml_buffer_char)
+    {
+        const char* end = p->src_end;
+
+#ifdef __SSE2__
+        const __m128i sp = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+
+        while(end - s >= 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)s);
+            __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tab)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+            int mask = _mm_movemask_epi8(m) ^ 0xFFFF;
+
+            if(mask)
+            {
+                p->src = (char*)s + __builtin_ctz(mask);
+                return;
+            }
+            s += 16;
+        }
+#endif
+
+        while(s < end && is_space(*s)) s++;
+    }
+    else if(p->get_char == get_xml_char)
+    {
+        while(is_space(*s)) s++;
+    }
+
+    p->src = (char*)s;
+}
+
+
+// returns 1 and reports error if new element would exceed depth limit
+// whole start tag is already read, so in recovery mode parsing resyncs after it
+// and end tag of not empty element is skipped later
+static int xml_depth_exceeded(xml_parser_t* p, int empty)
+{
+    if(p->max_depth && p->level >= p->max_depth)
+    {
+#ifndef XML_NO_RECOVER
+        if(p->options & XML_OPTION_RECOVER) p->state = STATE_CHARS;
+#endif
+        XML_ERROR(XML_ERROR_DEPTH, "Elements nested too deep");
+#ifndef XML_NO_RECOVER
+        if(!empty && p->state == STATE_RESYNC)
+        {
+            if(p->skip_level < 0)
+            {
+                p->skip_level = p->level;
+                p->skip_end = p->level + 1;
+            }
+            p->level++;
+        }
+#else
+        (void)empty;
+#endif
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// returns 1 and reports error if name is longer than limit
+static int xml_name_exceeded(xml_parser_t* p, const char* name, const char* end)
+{
+    if(p->max_name && end - name > p->max_name)
+    {
+        XML_ERROR(XML_ERROR_NAME, "Name too long");
+        return 1;
+    }
+
+    return 0;
+}
+
+
+
 // generic parser
 
-// after '<' we have to test next char
+// after '<' we have to test next char
 // returns 1 if we need to stop parsing, 0 otherwise
 static int xml_parse_testlt(xml_parser_t* p)
 {
@@ -118,7 +405,9 @@ static int xml_parse_testlt(xml_parser_t* p)
         c = p->get_char(p);
 
         if(c == '-') p->state = STATE_COMMENT;
+#ifndef XML_NO_CDATA
         else if(c == '[') p->state = STATE_CDATA;
+#endif
         else if(c == -1)
         {
             XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
@@ -137,6 +426,12 @@ static int xml_parse_testlt(xml_parser_t* p)
     }
     else
     {
+        if(!p->pool_size)
+        {
+            XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+            return 1;
+        }
+
         p->state = STATE_TAG;
         p->tag = p->pool;
         *p->pool++ = c;
@@ -147,7 +442,9 @@ static int xml_parse_testlt(xml_parser_t* p)
 }
 
 
-// after '<![' we have to extract CDATA block ending with ']]>'
+#ifndef XML_NO_CDATA
+
+// after '<![' we have to extract CDATA block ending with ']]>'
 // returns 1 if we need to stop parsing, 0 otherwise
 static int xml_parse_cdata(xml_parser_t* p)
 {
@@ -181,8 +478,12 @@ static int xml_parse_cdata(xml_parser_t* p)
 
     while(1)
     {
-        c = p->get_char(p);
-        if(!pool_size)
+        char* run = pool;
+
+        c = xml_copy_run(p, &pool, &pool_size, CC_CDATA);
+        if(pool != run) i = 0;
+
+        if(c == -2 || !pool_size)
         {
             XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
             RETURN(1);
@@ -201,7 +502,7 @@ static int xml_parse_cdata(xml_parser_t* p)
                 pool[-3] = 0;
 
                 // call cdata handler
-                if(p->cdata_handler) p->cdata_handler(p);
+                if(p->cdata_handler && !XML_SKIPPING(p)) p->cdata_handler(p);
 
                 // reset pool memory
                 p->pool = p->_pool;
@@ -226,9 +527,11 @@ static int xml_parse_cdata(xml_parser_t* p)
     RETURN(0);
 }
 
+#endif
 
 
-// after first char of attributes we have to parse rest of the chars
+
+// after first char of attributes we have to parse rest of the chars
 // returns 1 if we need to stop parsing, 0 otherwise
 static int xml_parse_attributes(xml_parser_t* p)
 {
@@ -236,12 +539,14 @@ static int xml_parse_attributes(xml_parser_t* p)
     char* pool = p->pool;
     int pool_size = p->pool_size;
     char* ref;
+    char* name = pool - 1;      // first char of name is stored by xml_parse_tag
+    int attrs = 0;
 
     c = p->get_char(p);
 
 parse_name:
 
-    while(c != -1 && c != '=')
+    if(c != -1 && c != '=')
     {
         if(!pool_size)
         {
@@ -251,7 +556,13 @@ parse_name:
 
         *pool++ = c;
         pool_size--;
-        c = p->get_char(p);
+
+        c = xml_copy_run(p, &pool, &pool_size, CC_EQ);
+        if(c == -2)
+        {
+            XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+            RETURN(1);
+        }
     }
 
     if(c == -1)
@@ -260,6 +571,14 @@ parse_name:
         RETURN(1);
     }
 
+    if(xml_name_exceeded(p, name, pool)) RETURN(1);
+
+    if(p->max_attrs && ++attrs > p->max_attrs)
+    {
+        XML_ERROR(XML_ERROR_ATTRS, "Too many attributes");
+        RETURN(1);
+    }
+
     // c is now '=' so we have to test next char to see is it ' or "
     if(!pool_size)
     {
@@ -310,10 +629,17 @@ parse_name:
         {
             long t = -1;
 
+            if(!pool_size)
+            {
+                XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+                RETURN(1);
+            }
+
             *pool = 0;          // terminatin char for reference
 
             // ref now points to reference after '&' character
             // and ends with ';' character
+#ifndef XML_NO_CHAR_REFS
             if(ref[0] == '#')   // CharRef
             {
                 if(ref[1] == 'x')   // hexadecimal CharRef
@@ -325,7 +651,9 @@ parse_name:
                     t = strtol(ref + 1, 0, 10);
                 }
             }
-            else if(ref[0] == 'a')
+            else
+#endif
+            if(ref[0] == 'a')
             {
                 if(ref[1] == 'm' && ref[2] == 'p') t = '&';
                 else if(ref[1] == 'p' && ref[2] == 'o' && ref[3] == 's') t = '\'';
@@ -349,7 +677,15 @@ parse_name:
             ref = 0;
         }
 
-        c = p->get_char(p);
+        // inside reference chars are checked one by one
+        if(ref) c = p->get_char(p);
+        else c = xml_copy_run(p, &pool, &pool_size, quote_char == '"' ? CC_QUOT : CC_APOS);
+
+        if(c == -2)
+        {
+            XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+            RETURN(1);
+        }
     }
 
     if(c == -1)
@@ -390,13 +726,19 @@ parse_name:
         RETURN(1);
     }
 
+    // space for terminating char or next attribute name
+    if(!pool_size)
+    {
+        XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+        RETURN(1);
+    }
+
     // we have to test c to see is it end of tag or new attribute name
     if(c == '/')
     {
         *pool = 0;       // terminating char
         // trim trailing space chars
-        pool--;
-        while(*pool == ' ') *pool-- = 0;
+        while(pool > p->attr && pool[-1] == ' ') *--pool = 0;
 
         // next char should be '>'
         c = p->get_char(p);
@@ -412,28 +754,32 @@ parse_name:
             RETURN(1);
         }
 
+        if(xml_depth_exceeded(p, 1)) RETURN(1);
+
         p->level++;
         // call start_element_handler
-        if(p->start_element_handler) p->start_element_handler(p);
+        xml_start_element(p);
 
         p->level--;
         // call end_element_handler
-        if(p->end_element_handler) p->end_element_handler(p);
+        xml_end_element(p);
     }
     else if(c == '>')
     {
         *pool = 0;       // terminating char
         // trim trailing space chars
-        pool--;
-        while(*pool == ' ') *pool-- = 0;
+        while(pool > p->attr && pool[-1] == ' ') *--pool = 0;
+
+        if(xml_depth_exceeded(p, 0)) RETURN(1);
 
         p->level++;
         // call start_element_handler
-        if(p->start_element_handler) p->start_element_handler(p);
+        xml_start_element(p);
     }
     else
     {
         // new attribute name
+        name = pool;
         goto parse_name;
     }
 
@@ -449,29 +795,24 @@ parse_name:
 
 
 
+// lazy attributes: copy attributes up to '>' as they are, without tokenizing
+// and decoding them, quoted values can contain '>'
 // returns 1 if we need to stop parsing, 0 otherwise
-static int xml_parse_comment(xml_parser_t* p)
+static int xml_parse_raw_attributes(xml_parser_t* p)
 {
     char* pool = p->pool;
     int pool_size = p->pool_size;
+    int c, empty;
 
-    // we get here after '<!-' so we have to test next char
-    // and than wait for '-->'
-
-    int c = p->get_char(p);
+    c = xml_copy_run(p, &pool, &pool_size, CC_RAW);
 
-    if(c == '-')
+    while(c == '"' || c == '\'')
     {
-        const char comment_end[] = "-->";
-        int i;
-
-        // we are now in comment block which must end with '-->'
-        i = 0;
-        p->comment = pool;
+        int cc = c == '"' ? CC_QUOT : CC_APOS;
 
-        while(1)
+        // quote and references are copied too
+        do
         {
-            c = p->get_char(p);
             if(!pool_size)
             {
                 XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
@@ -481,66 +822,13 @@ static int xml_parse_comment(xml_parser_t* p)
             *pool++ = c;
             pool_size--;
 
-            if(c == comment_end[i])
-            {
-                i++;
-                if(i == 3) // we are done
-                {
-                    //p->state = STATE_START;
-                    p->state = STATE_CHARS;
-                    // we have to trim '-->' from the end of pool
-                    pool[-3] = 0;
-
-                    // call comment handler
-                    if(p->comment_handler) p->comment_handler(p);
-
-                    // reset pool memory
-                    p->pool = p->_pool;
-                    p->pool_size = p->_pool_size;
-
-                    p->chars = p->_pool;
-
-                    return 0;
-                }
-            }
-            else
-            {
-                i = 0;
-                if(c == -1)
-                {
-                    XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
-                    RETURN(1);
-                }
-            }
+            c = xml_copy_run(p, &pool, &pool_size, cc);
         }
-    }
-    else if(c == -1)
-    {
-        XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
-        RETURN(1);
-    }
-    else
-    {
-        XML_ERROR(XML_ERROR_MALFORMED, "Malformed xml document");
-        RETURN(1);
-    }
-
-    RETURN(0);
-}
-
+        while(c == '&');
 
-
-// parse processing instructions <?...?>
-// returns 1 if we need to stop parsing, 0 otherwise
-static int xml_parse_pi(xml_parser_t* p)
-{
-    int c;
-    char* pool = p->pool;
-    int pool_size = p->pool_size;
+        if(c < 0) break;
 
-    c = p->get_char(p);
-    while(c != -1 && c != '?')
-    {
+        // closing quote
         if(!pool_size)
         {
             XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
@@ -549,7 +837,14 @@ static int xml_parse_pi(xml_parser_t* p)
 
         *pool++ = c;
         pool_size--;
-        c = p->get_char(p);
+
+        c = xml_copy_run(p, &pool, &pool_size, CC_RAW);
+    }
+
+    if(c == -2 || (c == '>' && !pool_size))
+    {
+        XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+        RETURN(1);
     }
 
     if(c == -1)
@@ -558,25 +853,234 @@ static int xml_parse_pi(xml_parser_t* p)
         RETURN(1);
     }
 
-    // now we know it's '?', next char should be '>'
-    c = p->get_char(p);
+    // now we know c == '>'
+    *pool = 0;       // terminating char
 
-    if(c == '>')
-    {
-        *pool = 0;
-        // trim trailing space chars
-        pool--;
-        while(*pool == ' ') *pool-- = 0;
+    empty = pool[-1] == '/';
+    if(empty) *--pool = 0;
 
+    // trim trailing whitespace chars
+    while(pool > p->attr && (pool[-1] == ' ' || pool[-1] == '\t' || pool[-1] == '\n')) *--pool = 0;
 
-        // call PI callback
-        if(p->pi_handler) p->pi_handler(p);
+    if(xml_depth_exceeded(p, empty)) RETURN(1);
 
-        // reset memory pool
-        p->pool = p->_pool;
-        p->pool_size = p->_pool_size;
-        p->state = STATE_CHARS;
-        p->chars = p->_pool;
+    p->level++;
+    // call start_element_handler
+    xml_start_element(p);
+
+    if(empty)
+    {
+        p->level--;
+        // call end_element_handler
+        xml_end_element(p);
+    }
+
+    // reset pool memory
+    p->pool = p->_pool;
+    p->pool_size = p->_pool_size;
+
+    p->state = STATE_CHARS;
+    p->chars = p->_pool;
+
+    return 0;
+}
+
+
+
+#if defined(XML_NO_COMMENTS) || defined(XML_NO_PI)
+
+// skip input up to and including end without copying it to pool
+// returns 1 if we need to stop parsing, 0 otherwise
+static int xml_skip_markup(xml_parser_t* p, const char* end)
+{
+    int i = 0;
+
+    while(end[i])
+    {
+        int c = p->get_char(p);
+
+        if(c == -1)
+        {
+            XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
+            return 1;
+        }
+
+        // "--->" ends comment and "??>" ends PI too
+        if(c == end[i]) i++;
+        else if(c != end[0]) i = 0;
+        else if(!i || end[i - 1] != c) i = 1;
+    }
+
+    p->pool = p->_pool;
+    p->pool_size = p->_pool_size;
+    p->state = STATE_CHARS;
+    p->chars = p->_pool;
+
+    return 0;
+}
+
+#endif
+
+
+
+#ifndef XML_NO_COMMENTS
+
+// returns 1 if we need to stop parsing, 0 otherwise
+static int xml_parse_comment(xml_parser_t* p)
+{
+    char* pool = p->pool;
+    int pool_size = p->pool_size;
+
+    // we get here after '<!-' so we have to test next char
+    // and than wait for '-->'
+
+    int c = p->get_char(p);
+
+    if(c == '-')
+    {
+        const char comment_end[] = "-->";
+        int i;
+
+        // we are now in comment block which must end with '-->'
+        i = 0;
+        p->comment = pool;
+
+        while(1)
+        {
+            char* run = pool;
+
+            c = xml_copy_run(p, &pool, &pool_size, CC_COMMENT);
+            if(pool != run) i = 0;
+
+            if(c == -2 || !pool_size)
+            {
+                XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+                RETURN(1);
+            }
+
+            *pool++ = c;
+            pool_size--;
+
+            if(c == comment_end[i])
+            {
+                i++;
+                if(i == 3) // we are done
+                {
+                    //p->state = STATE_START;
+                    p->state = STATE_CHARS;
+                    // we have to trim '-->' from the end of pool
+                    pool[-3] = 0;
+
+                    // call comment handler
+                    if(p->comment_handler && !XML_SKIPPING(p)) p->comment_handler(p);
+
+                    // reset pool memory
+                    p->pool = p->_pool;
+                    p->pool_size = p->_pool_size;
+
+                    p->chars = p->_pool;
+
+                    return 0;
+                }
+            }
+            else
+            {
+                i = 0;
+                if(c == -1)
+                {
+                    XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
+                    RETURN(1);
+                }
+            }
+        }
+    }
+    else if(c == -1)
+    {
+        XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
+        RETURN(1);
+    }
+    else
+    {
+        XML_ERROR(XML_ERROR_MALFORMED, "Malformed xml document");
+        RETURN(1);
+    }
+
+    RETURN(0);
+}
+
+#else
+
+// comments are skipped, we get here after '<!-'
+// returns 1 if we need to stop parsing, 0 otherwise
+static int xml_parse_comment(xml_parser_t* p)
+{
+    int c = p->get_char(p);
+
+    if(c == '-') return xml_skip_markup(p, "-->");
+
+    if(c == -1)
+    {
+        XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
+    }
+    else
+    {
+        XML_ERROR(XML_ERROR_MALFORMED, "Malformed xml document");
+    }
+
+    return 1;
+}
+
+#endif
+
+
+
+#ifndef XML_NO_PI
+
+// parse processing instructions <?...?>
+// returns 1 if we need to stop parsing, 0 otherwise
+static int xml_parse_pi(xml_parser_t* p)
+{
+    int c;
+    char* pool = p->pool;
+    int pool_size = p->pool_size;
+
+    c = xml_copy_run(p, &pool, &pool_size, CC_QM);
+    if(c == -2)
+    {
+        XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+        RETURN(1);
+    }
+
+    if(c == -1)
+    {
+        XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
+        RETURN(1);
+    }
+
+    // now we know it's '?', next char should be '>'
+    c = p->get_char(p);
+
+    if(c == '>')
+    {
+        if(!pool_size)
+        {
+            XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+            RETURN(1);
+        }
+
+        *pool = 0;
+        // trim trailing space chars
+        while(pool > p->pi && pool[-1] == ' ') *--pool = 0;
+
+
+        // call PI callback
+        if(!XML_SKIPPING(p)) xml_handle_pi(p);
+
+        // reset memory pool
+        p->pool = p->_pool;
+        p->pool_size = p->_pool_size;
+        p->state = STATE_CHARS;
+        p->chars = p->_pool;
         return 0;
     }
     else if(c == -1)
@@ -593,9 +1097,20 @@ static int xml_parse_pi(xml_parser_t* p)
     RETURN(0);
 }
 
+#else
+
+// processing instructions are skipped
+// returns 1 if we need to stop parsing, 0 otherwise
+static int xml_parse_pi(xml_parser_t* p)
+{
+    return xml_skip_markup(p, "?>");
+}
+
+#endif
+
 
 
-// find start of tag
+// find start of tag
 // returns 1 if we need to stop parsing, 0 otherwise
 static int xml_parse_start(xml_parser_t* p)
 {
@@ -618,28 +1133,108 @@ static int xml_parse_start(xml_parser_t* p)
     return 0;
 }
 
-
 
+
+#ifndef XML_NO_RECOVER
+
+// after error in recovery mode skip input up to next '<' that can start a tag,
+// comment, CDATA or PI; parsing continues at the same level
 // returns 1 if we need to stop parsing, 0 otherwise
-static int xml_parse_tagend(xml_parser_t* p)
+static int xml_parse_resync(xml_parser_t* p)
 {
-    char* pool = p->pool;
-    int pool_size = p->pool_size;
-    int c = p->get_char(p);
+    int c;
 
-    while(c != -1 && c != '>')
+    p->pool = p->_pool;
+    p->pool_size = p->_pool_size;
+
+    if(p->state == STATE_RESYNC_TAG)
     {
-        if(!pool_size)
+        // broken start tag is empty element if it ends with "/>"
+        int last = 0;
+
+        c = p->get_char(p);
+        while(c != -1 && c != '>' && c != '<')
         {
-            XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
-            RETURN(1);
+            last = c;
+            c = p->get_char(p);
         }
 
-        *pool++ = c;
-        pool_size--;
+        if(p->suspended) return 1;
+        if(c == '<') p->src--;
+
+        if(c != '>' || last != '/')
+        {
+            if(p->skip_level < 0)
+            {
+                p->skip_level = p->level;
+                p->skip_end = p->level + 1;
+            }
+            p->level++;
+        }
+
+        p->state = STATE_RESYNC;
+        if(c == -1) return 0;
+    }
+
+    while(1)
+    {
+        char* src = p->src;
+
+        if(p->get_char == get_xml_buffer_char)
+        {
+            char* lt = memchr(p->src, '<', p->src_end - p->src);
+            p->src = lt ? lt : p->src_end;
+        }
+        else if(p->get_char == get_xml_char) p->src += strcspn(p->src, "<");
+
+        // skipped input is consumed even if chunk ends before next '<'
+        if(p->src != src) return 0;
+
         c = p->get_char(p);
+        while(c != -1 && c != '<') c = p->get_char(p);
+
+        if(c == -1) break;
+
+        c = p->get_char(p);
+        if(c == '/' || c == '!' || c == '?' || c == '_' || c == ':' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+        {
+            // none of these chars is '\r', so it took one byte of input
+            p->src--;
+            p->state = STATE_TESTLT;
+            return 0;
+        }
+
+        if(c == -1) break;
+        if(c == '<') p->src--;
+    }
+
+    if(p->level)
+    {
+        XML_ERROR(XML_ERROR_DOCUMENT_END, "Premature end of xml document");
+    }
+
+    return 1;
+}
+
+#endif
+
+
+
+// returns 1 if we need to stop parsing, 0 otherwise
+static int xml_parse_tagend(xml_parser_t* p)
+{
+    char* pool = p->pool;
+    int pool_size = p->pool_size;
+    int c = xml_copy_run(p, &pool, &pool_size, CC_GT);
+
+    if(c == -2)
+    {
+        XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+        RETURN(1);
     }
 
+    if(xml_name_exceeded(p, p->tag, pool)) RETURN(1);
+
     // end of stream or end of tag name
     if(c == -1)
     {
@@ -659,7 +1254,7 @@ static int xml_parse_tagend(xml_parser_t* p)
 
     p->level--;
     // call end_element_handler
-    if(p->end_element_handler) p->end_element_handler(p);
+    xml_end_element(p);
 
     p->state = STATE_CHARS;
     p->chars = p->_pool;
@@ -673,27 +1268,23 @@ static int xml_parse_tagend(xml_parser_t* p)
 
 
 
-// get xml tag
+// get xml tag
 // returns 1 if we need to stop parsing, 0 otherwise
 static int xml_parse_tag(xml_parser_t* p)
 {
     char* pool = p->pool;
     int pool_size = p->pool_size;
-    int c = p->get_char(p);
+    int c = xml_copy_run(p, &pool, &pool_size, CC_TAG);
+    int empty;
 
-    while(c != -1 && c != ' ' && c != '>' && c != '/')
+    if(c == -2)
     {
-        if(!pool_size)
-        {
-            XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
-            RETURN(1);
-        }
-
-        *pool++ = c;
-        pool_size--;
-        c = p->get_char(p);
+        XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+        RETURN(1);
     }
 
+    if(xml_name_exceeded(p, p->tag, pool)) RETURN(1);
+
     // skip all whitespace chars
     while(c == ' ') c = p->get_char(p);
 
@@ -715,12 +1306,9 @@ static int xml_parse_tag(xml_parser_t* p)
         // it's a tag without attributes
         p->attr = pool;     // no attributes, so p->attr points to null string
         *pool = 0;          // terminating char
+        empty = c == '/';
 
-        p->level++;
-        // call start_element_handler
-        if(p->start_element_handler) p->start_element_handler(p);
-
-        if(c == '/')
+        if(empty)
         {
             // next char should be '>'
             c = p->get_char(p);
@@ -735,10 +1323,19 @@ static int xml_parse_tag(xml_parser_t* p)
                 XML_ERROR(XML_ERROR_MALFORMED, "Malformed xml document");
                 RETURN(1);
             }
+        }
 
+        if(xml_depth_exceeded(p, empty)) RETURN(1);
+
+        p->level++;
+        // call start_element_handler
+        xml_start_element(p);
+
+        if(empty)
+        {
             p->level--;
             // call end_element_handler
-            if(p->end_element_handler) p->end_element_handler(p);
+            xml_end_element(p);
         }
 
         p->state = STATE_CHARS;
@@ -775,32 +1372,42 @@ static int xml_parse_tag(xml_parser_t* p)
         *pool++ = c;
         pool_size--;
 
-        p->state = STATE_ATTR;
+        p->state = (p->options & XML_OPTION_LAZY_ATTRS) ? STATE_RAW_ATTR : STATE_ATTR;
     }
 
     RETURN(0);
 }
 
 
-
+
 // returns 1 if we need to stop parsing, 0 otherwise
 static int xml_parse_chars(xml_parser_t* p)
 {
     char* pool = p->pool;
     int pool_size = p->pool_size;
-    int c = p->get_char(p);
+    int c;
 
-    while(c != -1 && c != '<')
+    if(p->options & (XML_OPTION_SKIP_WHITESPACE | XML_OPTION_TRIM))
     {
-        if(!pool_size)
+        // whitespace before '<' is never copied to pool,
+        // leading whitespace of text is copied only if it is not trimmed
+        char* src = p->src;
+
+        xml_skip_space(p);
+
+        if(!(p->options & XML_OPTION_TRIM) && p->src != src)
         {
-            XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
-            RETURN(1);
+            if(p->get_char == get_xml_buffer_char && p->src == p->src_end) p->src = src;
+            else if(*p->src != '<') p->src = src;
         }
-
-        *pool++ = c;
-        pool_size--;
-        c = p->get_char(p);
+    }
+
+    c = xml_copy_run(p, &pool, &pool_size, CC_LT);
+
+    if(c == -2)
+    {
+        XML_ERROR(XML_ERROR_NO_MEMORY, "No enough memory in pool");
+        RETURN(1);
     }
 
     if(c == -1)
@@ -820,10 +1427,33 @@ static int xml_parse_chars(xml_parser_t* p)
         RETURN(1);
     }
 
-    *pool++ = 0;     // terminating char
+    *pool = 0;       // terminating char
+
+    if(p->options & (XML_OPTION_SKIP_WHITESPACE | XML_OPTION_TRIM))
+    {
+        // other sources copy whitespace to pool, so it is checked here too
+        char* text = p->chars;
+
+        while(pool > text && is_space(pool[-1])) pool--;
+
+        if(pool == text && (p->options & XML_OPTION_SKIP_WHITESPACE))
+        {
+            p->pool = p->_pool;
+            p->pool_size = p->_pool_size;
+            p->state = STATE_TESTLT;
+            return 0;
+        }
+
+        if(p->options & XML_OPTION_TRIM)
+        {
+            *pool = 0;
+            while(is_space(*text)) text++;
+            p->chars = text;
+        }
+    }
 
     // call characters_handler
-    if(p->characters_handler) p->characters_handler(p);
+    if(p->characters_handler && !XML_SKIPPING(p)) p->characters_handler(p);
 
     // reset memory pool
     p->pool = p->_pool;
@@ -831,7 +1461,51 @@ static int xml_parse_chars(xml_parser_t* p)
 
     p->state = STATE_TESTLT;
 
-    RETURN(0);
+    return 0;
+}
+
+
+
+// parse one token
+// returns 1 if we need to stop parsing, 0 otherwise
+static int xml_parse_step(xml_parser_t* p)
+{
+    char* src = p->src;
+#ifndef XML_NO_RECOVER
+    int state = p->state;
+#endif
+    int stop;
+
+         if(p->state == STATE_CHARS)    stop = xml_parse_chars(p);
+    else if(p->state == STATE_TESTLT)   stop = xml_parse_testlt(p);
+    else if(p->state == STATE_TAG)      stop = xml_parse_tag(p);
+    else if(p->state == STATE_ATTR)     stop = xml_parse_attributes(p);
+    else if(p->state == STATE_RAW_ATTR) stop = xml_parse_raw_attributes(p);
+    else if(p->state == STATE_ETAG)     stop = xml_parse_tagend(p);
+    else if(p->state == STATE_PI)       stop = xml_parse_pi(p);
+    else if(p->state == STATE_COMMENT)  stop = xml_parse_comment(p);
+#ifndef XML_NO_CDATA
+    else if(p->state == STATE_CDATA)    stop = xml_parse_cdata(p);
+#endif
+    else if(p->state == STATE_START)    stop = xml_parse_start(p);
+#ifndef XML_NO_RECOVER
+    else if(p->state >= STATE_RESYNC)   stop = xml_parse_resync(p);
+#endif
+    else return 1;
+
+#ifndef XML_NO_RECOVER
+    // error was reported and parser is in recovery mode
+    if(stop && state < STATE_RESYNC && p->state >= STATE_RESYNC) stop = 0;
+#endif
+
+    p->bytes += (size_t)(p->src - src);
+    if(!stop && p->max_bytes && p->bytes > p->max_bytes)
+    {
+        XML_ERROR(XML_ERROR_SIZE, "Document too large");
+        stop = 1;
+    }
+
+    return stop;
 }
 
 
@@ -842,18 +1516,7 @@ static void xml_parse(xml_parser_t* p)
 
     p->state = STATE_START;
 
-    while(stop == 0)
-    {
-             if(p->state == STATE_CHARS)    stop = xml_parse_chars(p);
-        else if(p->state == STATE_TESTLT)   stop = xml_parse_testlt(p);
-        else if(p->state == STATE_TAG)      stop = xml_parse_tag(p);
-        else if(p->state == STATE_ATTR)     stop = xml_parse_attributes(p);
-        else if(p->state == STATE_ETAG)     stop = xml_parse_tagend(p);
-        else if(p->state == STATE_PI)       stop = xml_parse_pi(p);
-        else if(p->state == STATE_COMMENT)  stop = xml_parse_comment(p);
-        else if(p->state == STATE_CDATA)    stop = xml_parse_cdata(p);
-        else if(p->state == STATE_START)    stop = xml_parse_start(p);
-    }
+    while(stop == 0) stop = xml_parse_step(p);
 }
 
 
@@ -869,6 +1532,230 @@ void xml_parse_string(xml_parser_t* p, char* string)
 }
 
 
+void xml_parse_buffer(xml_parser_t* p, char* buffer, size_t size)
+{
+    p->src = buffer;
+    p->src_end = buffer + size;
+    p->get_char = get_xml_buffer_char;
+
+    xml_parse(p);
+
+    xml_reset(p);
+}
+
+
+// if token is not complete at the end of chunk, parser state is restored
+// to the start of that token and unconsumed bytes have to be passed again
+int xml_parse_chunk(xml_parser_t* p, char* chunk, int size, int final)
+{
+    char* src;
+    char* pool;
+    char* tag;
+    char* attr;
+    int pool_size, state, level;
+    size_t bytes;
+    int stop = 0;
+
+    p->src = chunk;
+    p->src_end = chunk + size;
+    p->get_char = get_xml_buffer_char;
+    p->more = !final;
+    p->suspended = 0;
+    p->errorcode = XML_ERROR_NONE;
+
+    while(stop == 0)
+    {
+        src = p->src;
+        pool = p->pool;
+        pool_size = p->pool_size;
+        tag = p->tag;
+        attr = p->attr;
+        state = p->state;
+        level = p->level;
+        bytes = p->bytes;
+
+        stop = xml_parse_step(p);
+    }
+
+    if(p->suspended)
+    {
+        p->src = src;
+        p->pool = pool;
+        p->pool_size = pool_size;
+        p->tag = tag;
+        p->attr = attr;
+        p->state = state;
+        p->level = level;
+        p->bytes = bytes;
+        p->suspended = 0;
+
+        return (int)(src - chunk);
+    }
+
+    // end of document or error
+    xml_reset(p);
+
+    return p->errorcode ? -1 : size;
+}
+
+
+// parse documents first..last-1 of batch, p->doc_index is index of document
+// returns number of documents with errors
+static int xml_parse_range(xml_parser_t* p, char* const* docs, const size_t* lens, int first, int last)
+{
+    int errors = 0;
+    int i;
+
+    for(i = first; i < last; i++)
+    {
+        // start of next document is loaded while this one is parsed
+        if(i + 1 < last)
+        {
+            XML_PREFETCH(docs[i + 1]);
+            XML_PREFETCH(docs[i + 1] + 64);
+        }
+
+        p->doc_index = i;
+        p->errorcode = XML_ERROR_NONE;
+        p->src = docs[i];
+
+        if(lens)
+        {
+            p->src_end = docs[i] + lens[i];
+            p->get_char = get_xml_buffer_char;
+        }
+        else p->get_char = get_xml_char;
+
+        xml_parse(p);
+
+        if(p->errorcode) errors++;
+        xml_reset(p);
+    }
+
+    return errors;
+}
+
+
+
+int xml_parse_batch(xml_parser_t* p, char* const* docs, const size_t* lens, int n)
+{
+    return xml_parse_range(p, docs, lens, 0, n);
+}
+
+
+
+#ifdef XML_HAVE_THREADS
+
+// number of documents taken by worker at once
+#define XML_BATCH_GRAIN 16
+
+typedef struct xml_batch_s xml_batch_t;
+typedef struct xml_worker_s xml_worker_t;
+
+struct xml_batch_s
+{
+    char* const* docs;
+    const size_t* lens;
+    int n;
+    int next;               // first document not taken by worker
+    pthread_mutex_t lock;
+};
+
+struct xml_worker_s
+{
+    xml_batch_t* batch;
+    xml_parser_t p;
+    int errors;
+};
+
+
+
+static void* xml_batch_worker(void* arg)
+{
+    xml_worker_t* w = arg;
+    xml_batch_t* b = w->batch;
+    int first, last;
+
+    while(1)
+    {
+        pthread_mutex_lock(&b->lock);
+        first = b->next;
+        last = first + XML_BATCH_GRAIN < b->n ? first + XML_BATCH_GRAIN : b->n;
+        b->next = last;
+        pthread_mutex_unlock(&b->lock);
+
+        if(first >= last) break;
+
+        w->errors += xml_parse_range(&w->p, b->docs, b->lens, first, last);
+    }
+
+    return 0;
+}
+
+#endif
+
+
+
+int xml_parse_batch_threaded(xml_parser_t* p, char* const* docs, const size_t* lens, int n, char* pools, int pool_size, int threads)
+{
+#ifdef XML_HAVE_THREADS
+    xml_batch_t b;
+    xml_worker_t* w;
+    pthread_t* tid;
+    int errors = 0;
+    int started, i;
+
+    if(threads > 1 && n > XML_BATCH_GRAIN)
+    {
+        w = malloc(threads * (sizeof(xml_worker_t) + sizeof(pthread_t)));
+        if(w)
+        {
+            tid = (pthread_t*)(w + threads);
+
+            b.docs = docs;
+            b.lens = lens;
+            b.n = n;
+            b.next = 0;
+            pthread_mutex_init(&b.lock, 0);
+
+            // workers use copies of p with own pools
+            for(i = 0; i < threads; i++)
+            {
+                w[i].batch = &b;
+                w[i].p = *p;
+                w[i].p._pool = pools + (size_t)i * pool_size;
+                w[i].p._pool_size = pool_size;
+                w[i].errors = 0;
+                xml_reset(&w[i].p);
+            }
+
+            // calling thread is worker 0
+            for(started = 1; started < threads; started++)
+            {
+                if(pthread_create(tid + started, 0, xml_batch_worker, w + started)) break;
+            }
+
+            xml_batch_worker(w);
+
+            for(i = 1; i < started; i++) pthread_join(tid[i], 0);
+            for(i = 0; i < threads; i++) errors += w[i].errors;
+
+            pthread_mutex_destroy(&b.lock);
+            free(w);
+            return errors;
+        }
+    }
+#endif
+
+    (void)pools;
+    (void)pool_size;
+    (void)threads;
+
+    return xml_parse_range(p, docs, lens, 0, n);
+}
+
+
+
 int xml_set_handler(xml_parser_t *p, void *handler, int handler_type)
 {
     int i = XML_ERROR_NONE;
@@ -879,9 +1766,11 @@ int xml_set_handler(xml_parser_t *p, void *handler, int handler_type)
             p->error_handler = handler;
         break;
 
+#ifndef XML_NO_COMMENTS
         case XML_COMMENT_HANDLER:
             p->comment_handler = handler;
         break;
+#endif
 
         case XML_START_ELEMENT_HANDLER:
             p->start_element_handler = handler;
@@ -895,13 +1784,52 @@ int xml_set_handler(xml_parser_t *p, void *handler, int handler_type)
             p->characters_handler = handler;
         break;
 
+#ifndef XML_NO_PI
         case XML_PI_HANDLER:
             p->pi_handler = handler;
         break;
 
+        case XML_INCLUDE_HANDLER:
+            p->include_handler = handler;
+        break;
+#endif
+
+#ifndef XML_NO_CDATA
         case XML_CDATA_HANDLER:
             p->cdata_handler = handler;
         break;
+#endif
+
+        default: i = XML_ERROR_ARG;
+    }
+
+    return i;
+}
+
+
+
+int xml_set_limit(xml_parser_t* p, int limit_type, size_t value)
+{
+    int i = XML_ERROR_NONE;
+    int n = value > INT_MAX ? INT_MAX : (int)value;   // int limits can not be reached anyway
+
+    switch(limit_type)
+    {
+        case XML_LIMIT_DEPTH:
+            p->max_depth = n;
+        break;
+
+        case XML_LIMIT_ATTRS:
+            p->max_attrs = n;
+        break;
+
+        case XML_LIMIT_NAME:
+            p->max_name = n;
+        break;
+
+        case XML_LIMIT_BYTES:
+            p->max_bytes = value;
+        break;
 
         default: i = XML_ERROR_ARG;
     }
@@ -911,6 +1839,40 @@ int xml_set_handler(xml_parser_t *p, void *handler, int handler_type)
 
 
 
+int xml_set_option(xml_parser_t* p, int option, int value)
+{
+#ifndef XML_NO_RECOVER
+    if(!option || (option & ~(XML_OPTION_LAZY_ATTRS | XML_OPTION_SKIP_WHITESPACE | XML_OPTION_TRIM | XML_OPTION_RECOVER))) return XML_ERROR_ARG;
+#else
+    if(!option || (option & ~(XML_OPTION_LAZY_ATTRS | XML_OPTION_SKIP_WHITESPACE | XML_OPTION_TRIM))) return XML_ERROR_ARG;
+#endif
+
+    if(value) p->options |= option;
+    else p->options &= ~option;
+
+    return XML_ERROR_NONE;
+}
+
+
+
+int xml_set_record_level(xml_parser_t* p, int level)
+{
+#ifndef XML_NO_RECOVER
+    if(level < 0) return XML_ERROR_ARG;
+
+    p->record_level = level;
+
+    return XML_ERROR_NONE;
+#else
+    (void)p;
+    (void)level;
+
+    return XML_ERROR_ARG;
+#endif
+}
+
+
+
 void xml_init(xml_parser_t* p, char* pool, int pool_size)
 {
     p->pool = pool;
@@ -918,18 +1880,41 @@ void xml_init(xml_parser_t* p, char* pool, int pool_size)
     p->pool_size = pool_size;
     p->_pool_size = pool_size;
     p->src = 0;
+    p->src_end = 0;
     p->tag = 0;
     p->attr = 0;
     p->state = 0;
     p->level = 0;
+    p->more = 0;
+    p->suspended = 0;
+    p->options = 0;
+    p->max_depth = 0;
+    p->max_attrs = 0;
+    p->max_name = 0;
+    p->max_bytes = 0;
+    p->bytes = 0;
     p->get_char = 0;
     p->error_handler = 0;
+#ifndef XML_NO_COMMENTS
     p->comment_handler = 0;
+#endif
+#ifndef XML_NO_PI
     p->pi_handler = 0;
+    p->include_handler = 0;
+#endif
+#ifndef XML_NO_CDATA
     p->cdata_handler = 0;
+#endif
     p->start_element_handler = 0;
     p->end_element_handler = 0;
     p->characters_handler = 0;
+    p->include_ptr = 0;
+#ifndef XML_NO_RECOVER
+    p->record_level = 0;
+    p->skip_level = -1;
+    p->skip_end = 0;
+#endif
+    p->doc_index = 0;
 }
 
 
@@ -938,10 +1923,17 @@ void xml_reset(xml_parser_t* p)
     p->pool = p->_pool;
     p->pool_size = p->_pool_size;
     p->src = 0;
+    p->src_end = 0;
     p->tag = 0;
     p->attr = 0;
     p->state = 0;
     p->level = 0;
+    p->more = 0;
+    p->suspended = 0;
+    p->bytes = 0;
+#ifndef XML_NO_RECOVER
+    p->skip_level = -1;
+#endif
     p->get_char = 0;
 }
 
@@ -996,9 +1988,237 @@ int xml_find_attr(const char* attr_string, const char* attr_name, char** attr_va
 
 
 
+// helper function for iterating over attributes in attribute string
+// fills attr with next attribute and advances *attr_string past it
+// returns 1 if attribute is found, 0 at the end of attribute string
+int xml_next_attr(char** attr_string, xml_attr_t* attr)
+{
+    char* ptr = *attr_string;
+    int quote_char;
+
+    while(*ptr == ' ' || *ptr == '\t' || *ptr == '\n') ptr++;
+    if(!*ptr) return 0;
+
+    attr->name = ptr;
+    while(*ptr && *ptr != '=') ptr++;
+    if(!*ptr) return 0;
+
+    attr->name_len = (int)(ptr - attr->name);
+    while(attr->name_len && (attr->name[attr->name_len - 1] == ' ' || attr->name[attr->name_len - 1] == '\t' || attr->name[attr->name_len - 1] == '\n')) attr->name_len--;
+
+    ptr++;
+    quote_char = *ptr;
+    if(quote_char != '"' && quote_char != '\'') return 0;
+
+    // values are already decoded so they can contain quote char
+    // value ends with quote char followed by whitespace or end of string
+    attr->value = ++ptr;
+    while(1)
+    {
+        ptr = strchr(ptr, quote_char);
+        if(!ptr) return 0;
+        if(!ptr[1] || ptr[1] == ' ' || ptr[1] == '\t' || ptr[1] == '\n') break;
+        ptr++;
+    }
+
+    attr->value_len = (int)(ptr - attr->value);
+    *attr_string = ptr + 1;
+
+    return 1;
+}
+
+
+
+int xml_get_attr(const char* attr_string, const char* attr_name, xml_attr_t* attr)
+{
+    char* ptr = (char*)attr_string;
+    int len = (int)strlen(attr_name);
+
+    while(ptr && xml_next_attr(&ptr, attr))
+    {
+        if(attr->name_len == len && !memcmp(attr->name, attr_name, len)) return 1;
+    }
+
+    return 0;
+}
+
+
+
+// value of reference between '&' and ';', -1 if reference is not valid
+static long xml_ref_value(const char* ref, int len)
+{
+#ifndef XML_NO_CHAR_REFS
+    long t = 0;
+    int i;
+
+    if(len > 1 && ref[0] == '#')
+    {
+        if(ref[1] == 'x')   // hexadecimal CharRef
+        {
+            if(len == 2) return -1;
+            for(i = 2; i < len; i++)
+            {
+                int c = ref[i];
+
+                if(c >= '0' && c <= '9') c -= '0';
+                else if(c >= 'a' && c <= 'f') c -= 'a' - 10;
+                else if(c >= 'A' && c <= 'F') c -= 'A' - 10;
+                else return -1;
+
+                t = t * 16 + c;
+                if(t > 0x10FFFF) return -1;
+            }
+        }
+        else                // decimal CharRef
+        {
+            for(i = 1; i < len; i++)
+            {
+                if(ref[i] < '0' || ref[i] > '9') return -1;
+                t = t * 10 + (ref[i] - '0');
+                if(t > 0x10FFFF) return -1;
+            }
+        }
+        return t;
+    }
+#endif
+
+    if(len == 3 && !memcmp(ref, "amp", 3)) return '&';
+    if(len == 4 && !memcmp(ref, "apos", 4)) return '\'';
+    if(len == 2 && !memcmp(ref, "lt", 2)) return '<';
+    if(len == 2 && !memcmp(ref, "gt", 2)) return '>';
+    if(len == 4 && !memcmp(ref, "quot", 4)) return '"';
+
+    return -1;
+}
+
+
+
+// store char t as UTF-8, returns number of stored bytes
+static int xml_put_utf8(char* buf, long t)
+{
+    if(t < 0x80)
+    {
+        buf[0] = (char)t;
+        return 1;
+    }
+#ifndef XML_NO_CHAR_REFS
+    if(t < 0x800)
+    {
+        buf[0] = (char)(0xC0 | (t >> 6));
+        buf[1] = (char)(0x80 | (t & 0x3F));
+        return 2;
+    }
+    if(t < 0x10000)
+    {
+        buf[0] = (char)(0xE0 | (t >> 12));
+        buf[1] = (char)(0x80 | ((t >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (t & 0x3F));
+        return 3;
+    }
+    buf[0] = (char)(0xF0 | (t >> 18));
+    buf[1] = (char)(0x80 | ((t >> 12) & 0x3F));
+    buf[2] = (char)(0x80 | ((t >> 6) & 0x3F));
+    buf[3] = (char)(0x80 | (t & 0x3F));
+    return 4;
+#else
+    return 0;
+#endif
+}
+
+
+
+int xml_attr_decode(const xml_attr_t* attr, char* buf, int size)
+{
+    const char* src = attr->value;
+    const char* end = src + attr->value_len;
+    int n = 0;
+
+    while(src < end)
+    {
+        const char* amp = memchr(src, '&', end - src);
+        const char* semi;
+        int len = (int)((amp ? amp : end) - src);
+        long t;
+
+        // copy run without references, buf can overlap value
+        if(len >= size - n) return -1;
+        memmove(buf + n, src, len);
+        n += len;
+        if(!amp) break;
+
+        semi = memchr(amp, ';', end - amp);
+        if(!semi) return -1;
+
+        t = xml_ref_value(amp + 1, (int)(semi - amp - 1));
+        if(t <= 0) return -1;
+
+        // UTF-8
+        if(size - n <= 4) return -1;
+        n += xml_put_utf8(buf + n, t);
+
+        src = semi + 1;
+    }
+
+    buf[n] = 0;
+    return n;
+}
+
+
+
+// reference is never shorter than its UTF-8 encoding, so text can be decoded in place
+int xml_text_decode(char* text, int len)
+{
+    const char* src = text;
+    const char* end = text + len;
+    char* dst = text;
+
+    while(src < end)
+    {
+        const char* amp = memchr(src, '&', end - src);
+        const char* semi;
+        long t;
+
+        if(!amp) amp = end;
+        if(dst != src) memmove(dst, src, amp - src);
+        dst += amp - src;
+        src = amp;
+        if(src == end) break;
+
+        semi = memchr(amp, ';', end - amp < 12 ? end - amp : 12);
+        t = semi ? xml_ref_value(amp + 1, (int)(semi - amp - 1)) : -1;
+
+        if(t > 0)
+        {
+            dst += xml_put_utf8(dst, t);
+            src = semi + 1;
+        }
+        else *dst++ = *src++;
+    }
+
+    *dst = 0;
+    return (int)(dst - text);
+}
+
+
+
 void xml_set_error(xml_parser_t* p, int err_code, const char* err_string)
 {
     p->tag = (char*)err_string;
     p->errorcode = err_code;
     if(p->error_handler) p->error_handler(p);
 }
+
+
+
+#ifndef XML_NO_PI
+
+void xml_handle_pi(xml_parser_t* p)
+{
+    if(p->include_handler && !strncmp(p->pi, "include", 7) && (p->pi[7] == ' ' || p->pi[7] == '\t' || p->pi[7] == '\n'))
+    {
+        p->include_handler(p);
+    }
+    else if(p->pi_handler) p->pi_handler(p);
+}
+
+#endif
@@ -27,6 +27,23 @@
 #ifndef __XMLPARSER_H__
 #define __XMLPARSER_H__
 
+#include <stddef.h>
+
+// features can be left out of small builds, parser states and handlers of
+// disabled features are not compiled:
+//     XML_NO_COMMENTS     comments are skipped, no comment handler
+//     XML_NO_PI           processing instructions are skipped, no PI and include
+//                         handlers and no xml_handle_pi
+//     XML_NO_CDATA        CDATA section is reported as malformed input, no CDATA handler
+//     XML_NO_CHAR_REFS    only predefined entity references are decoded in attributes,
+//                         character references are reported as malformed input
+//     XML_NO_RECOVER      no XML_OPTION_RECOVER and record level
+// macros can be collected in config header given as XML_CONFIG_FILE, for
+// example -DXML_CONFIG_FILE='"xmlconfig.h"'; all files have to be compiled
+// with the same configuration
+#ifdef XML_CONFIG_FILE
+#include XML_CONFIG_FILE
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,7 +54,9 @@ typedef struct xml_parser_s xml_parser_t;
 struct xml_parser_s
 {
     void* user_ptr;
+    void* include_ptr;
     char* src;
+    char* src_end;
     union
     {
         char* tag;
@@ -55,14 +74,50 @@ struct xml_parser_s
     int _pool_size;
     int state;
     int level;
+    int more;
+    int suspended;
+    int options;
+    int max_depth;
+    int max_attrs;
+    int max_name;
+    size_t max_bytes;
+    size_t bytes;           // input offset of current token, also in error_handler
+#ifndef XML_NO_RECOVER
+    int record_level;
+    int skip_level;         // level of last delivered open element while broken record is skipped or -1
+    int skip_end;           // skipping ends when level drops below skip_end
+#endif
+    int doc_index;          // index of document in xml_parse_batch
     int (*get_char)(xml_parser_t* p);
     void (*error_handler)(xml_parser_t* p);
+#ifndef XML_NO_COMMENTS
     void (*comment_handler)(xml_parser_t* p);
+#endif
+#ifndef XML_NO_PI
     void (*pi_handler)(xml_parser_t* p);
+#endif
+#ifndef XML_NO_CDATA
     void (*cdata_handler)(xml_parser_t* p);
+#endif
     void (*start_element_handler)(xml_parser_t* p);
     void (*end_element_handler)(xml_parser_t* p);
     void (*characters_handler)(xml_parser_t* p);
+#ifndef XML_NO_PI
+    void (*include_handler)(xml_parser_t* p);
+#endif
+};
+
+
+
+typedef struct xml_attr_s xml_attr_t;
+
+// one attribute from attribute string, strings are not zero terminated
+struct xml_attr_s
+{
+    char* name;
+    int name_len;
+    char* value;
+    int value_len;
 };
 
 
@@ -79,10 +134,13 @@ enum
     XML_CHARACTER_HANDLER,
     XML_PI_HANDLER,
     XML_CDATA_HANDLER,
+    XML_INCLUDE_HANDLER,
 };
 
 // parser error codes
-// error codes >= XML_ERROR_USERSTART are user defined
+// error codes from XML_ERROR_USERSTART to XML_ERROR_EXTSTART - 1 are user
+// defined; built-in codes added later start at XML_ERROR_EXTSTART, so
+// XML_ERROR_USERSTART keeps its value
 enum
 {
     XML_ERROR_NONE = 0,
@@ -91,14 +149,79 @@ enum
     XML_ERROR_NO_MEMORY,    // 3
     XML_ERROR_MALFORMED,    // 4
     XML_ERROR_USERSTART,    // 5
+    XML_ERROR_EXTSTART = 256,
+    XML_ERROR_INCLUDE = XML_ERROR_EXTSTART,
+    XML_ERROR_VALUE,        // 257
+    XML_ERROR_RANGE,        // 258
+    XML_ERROR_DEPTH,        // 259
+    XML_ERROR_ATTRS,        // 260
+    XML_ERROR_NAME,         // 261
+    XML_ERROR_SIZE,         // 262
+    XML_ERROR_INVALID,      // 263
+};
+
+
+// limit type values
+// limits are checked at token boundaries, 0 means no limit; depth, attribute
+// and name limits above INT_MAX are set to INT_MAX
+enum
+{
+    XML_LIMIT_DEPTH = 0,    // element nesting, XML_ERROR_DEPTH
+    XML_LIMIT_ATTRS,        // attributes per element, XML_ERROR_ATTRS
+    XML_LIMIT_NAME,         // length of element or attribute name, XML_ERROR_NAME
+    XML_LIMIT_BYTES,        // total input bytes, XML_ERROR_SIZE
 };
 
 
-// register handler
+// option values
+enum
+{
+    XML_OPTION_LAZY_ATTRS       = 1,    // p->attr is raw attribute text, values are not decoded
+                                        // and attribute limits are not checked
+    XML_OPTION_SKIP_WHITESPACE  = 2,    // no characters events for empty and whitespace only text
+    XML_OPTION_TRIM             = 4,    // leading and trailing whitespace is removed from text
+    XML_OPTION_RECOVER          = 8,    // after malformed token parsing continues at next tag,
+                                        // only end of input and size limit stop parsing
+};
+
+
+// register handler, returns XML_ERROR_ARG for handlers of disabled features
 int xml_set_handler(xml_parser_t *p, void *handler, int handler_type);
 
+// set limit for untrusted input
+int xml_set_limit(xml_parser_t* p, int limit_type, size_t value);
+
+// set or clear options, option can be combination of XML_OPTION_ values
+// returns XML_ERROR_ARG for XML_OPTION_RECOVER with XML_NO_RECOVER
+int xml_set_option(xml_parser_t* p, int option, int value);
+
+// with XML_OPTION_RECOVER rest of element at record level is skipped after error,
+// end events of its open elements are still delivered so element nesting stays balanced
+// level 2 skips to next child of document element, 0 resyncs at depth of error
+// returns XML_ERROR_ARG with XML_NO_RECOVER
+int xml_set_record_level(xml_parser_t* p, int level);
+
 void xml_parse_string(xml_parser_t* p, char* string);
 
+// parse size bytes from buffer, buffer does not have to be zero terminated
+void xml_parse_buffer(xml_parser_t* p, char* buffer, size_t size);
+
+// parse input in chunks, final is set for last chunk
+// returns number of bytes consumed, bytes that are not consumed must be passed
+// again at the start of next chunk; returns -1 if parsing is stopped by error
+int xml_parse_chunk(xml_parser_t* p, char* chunk, int size, int final);
+
+// parse n documents with warm parser, p->doc_index is set to index of document
+// for all events; lens can be 0 if documents are zero terminated strings
+// returns number of documents with errors
+int xml_parse_batch(xml_parser_t* p, char* const* docs, const size_t* lens, int n);
+
+// same as xml_parse_batch but documents are spread across threads workers,
+// each worker parses with copy of p that uses pool_size bytes of pools,
+// so handlers are called concurrently and get pointer to copy of p
+// without XML_HAVE_THREADS documents are parsed by p on calling thread
+int xml_parse_batch_threaded(xml_parser_t* p, char* const* docs, const size_t* lens, int n, char* pools, int pool_size, int threads);
+
 void xml_init(xml_parser_t* p, char* pool, int pool_size);
 
 void xml_reset(xml_parser_t* p);
@@ -106,9 +229,32 @@ void xml_reset(xml_parser_t* p);
 // helper function for finding attribute in attribute string
 int xml_find_attr(const char* attr_string, const char* attr_name, char** attr_val);
 
+// helper function for iterating over attributes in attribute string
+int xml_next_attr(char** attr_string, xml_attr_t* attr);
+
+// helper function for finding attribute with exact name in attribute string
+// returns 1 if attribute is found, 0 otherwise
+int xml_get_attr(const char* attr_string, const char* attr_name, xml_attr_t* attr);
+
+// decode references in raw attribute value to zero terminated buf
+// character references are stored as UTF-8; buf can be attr->value with size
+// value_len + 1 to decode value in place
+// returns length of decoded value or -1 if value is malformed or buf is too small
+int xml_attr_decode(const xml_attr_t* attr, char* buf, int size);
+
+// decode references in text of len chars in place, p->chars is not decoded by
+// parser; malformed references are left as they are, decoded text is zero terminated
+// returns length of decoded text
+int xml_text_decode(char* text, int len);
+
 // helper function for setting error string from user code
 void xml_set_error(xml_parser_t* p, int err_code, const char* err_string);
 
+#ifndef XML_NO_PI
+// call include_handler for <?include ...?> and pi_handler for other processing instructions
+void xml_handle_pi(xml_parser_t* p);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
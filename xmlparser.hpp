@@ -0,0 +1,201 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlparser.hpp
+// header-only C++17 front end
+//
+// handler class is a template parameter, only events for which handler has
+// a member function are registered with the parser, all others are compiled out
+//
+//     struct my_handler
+//     {
+//         void start_element(std::string_view name, xml::attributes attrs, int level);
+//         void end_element(std::string_view name, int level);
+//         void characters(std::string_view text, int level);
+//         void cdata(std::string_view text, int level);
+//         void comment(std::string_view text, int level);
+//         void pi(std::string_view text, int level);
+//         void error(int code, std::string_view message);
+//     };
+
+#ifndef __XMLPARSER_HPP__
+#define __XMLPARSER_HPP__
+
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "xmlparser.h"
+
+namespace xml
+{
+
+// one attribute of start element
+struct attribute
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+
+// forward range over attribute string passed to start_element
+class attributes
+{
+public:
+    class iterator
+    {
+    public:
+        iterator() : ptr_(nullptr) {}
+        explicit iterator(char* ptr) : ptr_(ptr) { next(); }
+
+        const attribute& operator*() const { return attr_; }
+        const attribute* operator->() const { return &attr_; }
+        iterator& operator++() { next(); return *this; }
+        bool operator==(const iterator& other) const { return ptr_ == other.ptr_; }
+        bool operator!=(const iterator& other) const { return ptr_ != other.ptr_; }
+
+    private:
+        void next()
+        {
+            xml_attr_t a;
+
+            if(ptr_ && xml_next_attr(&ptr_, &a))
+            {
+                attr_.name = std::string_view(a.name, a.name_len);
+                attr_.value = std::string_view(a.value, a.value_len);
+            }
+            else ptr_ = nullptr;
+        }
+
+        char* ptr_;
+        attribute attr_;
+    };
+
+    explicit attributes(char* attr_string) : attr_string_(attr_string) {}
+
+    iterator begin() const { return iterator(attr_string_); }
+    iterator end() const { return iterator(); }
+
+    // returns true and sets value if attribute name is found
+    bool find(std::string_view name, std::string_view& value) const
+    {
+        for(const attribute& a : *this)
+        {
+            if(a.name == name)
+            {
+                value = a.value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // raw attribute string as stored in parser pool
+    std::string_view str() const { return attr_string_ ? std::string_view(attr_string_) : std::string_view(); }
+
+private:
+    char* attr_string_;
+};
+
+
+namespace detail
+{
+
+template<class H, class = void> struct has_start_element : std::false_type {};
+template<class H> struct has_start_element<H, std::void_t<decltype(std::declval<H&>().start_element(std::string_view(), std::declval<attributes>(), 0))>> : std::true_type {};
+
+template<class H, class = void> struct has_end_element : std::false_type {};
+template<class H> struct has_end_element<H, std::void_t<decltype(std::declval<H&>().end_element(std::string_view(), 0))>> : std::true_type {};
+
+template<class H, class = void> struct has_characters : std::false_type {};
+template<class H> struct has_characters<H, std::void_t<decltype(std::declval<H&>().characters(std::string_view(), 0))>> : std::true_type {};
+
+template<class H, class = void> struct has_cdata : std::false_type {};
+template<class H> struct has_cdata<H, std::void_t<decltype(std::declval<H&>().cdata(std::string_view(), 0))>> : std::true_type {};
+
+template<class H, class = void> struct has_comment : std::false_type {};
+template<class H> struct has_comment<H, std::void_t<decltype(std::declval<H&>().comment(std::string_view(), 0))>> : std::true_type {};
+
+template<class H, class = void> struct has_pi : std::false_type {};
+template<class H> struct has_pi<H, std::void_t<decltype(std::declval<H&>().pi(std::string_view(), 0))>> : std::true_type {};
+
+template<class H, class = void> struct has_error : std::false_type {};
+template<class H> struct has_error<H, std::void_t<decltype(std::declval<H&>().error(0, std::string_view()))>> : std::true_type {};
+
+} // namespace detail
+
+
+template<class Handler>
+class parser
+{
+public:
+    parser(Handler& handler, char* pool, int pool_size) : handler_(handler)
+    {
+        xml_init(&p_, pool, pool_size);
+        p_.user_ptr = &handler_;
+
+        if constexpr(detail::has_start_element<Handler>::value) p_.start_element_handler = on_start_element;
+        if constexpr(detail::has_end_element<Handler>::value) p_.end_element_handler = on_end_element;
+        if constexpr(detail::has_characters<Handler>::value) p_.characters_handler = on_characters;
+#ifndef XML_NO_CDATA
+        if constexpr(detail::has_cdata<Handler>::value) p_.cdata_handler = on_cdata;
+#endif
+#ifndef XML_NO_COMMENTS
+        if constexpr(detail::has_comment<Handler>::value) p_.comment_handler = on_comment;
+#endif
+#ifndef XML_NO_PI
+        if constexpr(detail::has_pi<Handler>::value) p_.pi_handler = on_pi;
+#endif
+        if constexpr(detail::has_error<Handler>::value) p_.error_handler = on_error;
+    }
+
+    parser(const parser&) = delete;
+    parser& operator=(const parser&) = delete;
+
+    void parse(char* string) { xml_parse_string(&p_, string); }
+    void parse(std::string_view buffer) { xml_parse_buffer(&p_, const_cast<char*>(buffer.data()), buffer.size()); }
+
+    // set error from handler, same as xml_set_error
+    void set_error(int code, const char* message) { xml_set_error(&p_, code, message); }
+
+    xml_parser_t* c_parser() { return &p_; }
+    Handler& handler() { return handler_; }
+
+private:
+    static Handler& self(xml_parser_t* p) { return *static_cast<Handler*>(p->user_ptr); }
+
+    static void on_start_element(xml_parser_t* p) { self(p).start_element(std::string_view(p->tag), attributes(p->attr), p->level); }
+    static void on_end_element(xml_parser_t* p) { self(p).end_element(std::string_view(p->tag), p->level); }
+    static void on_characters(xml_parser_t* p) { self(p).characters(std::string_view(p->chars), p->level); }
+    static void on_cdata(xml_parser_t* p) { self(p).cdata(std::string_view(p->cdata), p->level); }
+    static void on_comment(xml_parser_t* p) { self(p).comment(std::string_view(p->comment), p->level); }
+    static void on_pi(xml_parser_t* p) { self(p).pi(std::string_view(p->pi), p->level); }
+    static void on_error(xml_parser_t* p) { self(p).error(p->errorcode, std::string_view(p->errorstr)); }
+
+    Handler& handler_;
+    xml_parser_t p_;
+};
+
+} // namespace xml
+
+#endif // __XMLPARSER_HPP__
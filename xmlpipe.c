@@ -0,0 +1,373 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlpipe.c
+
+#include <string.h>
+#include "xmlpipe.h"
+
+
+// pass event through stages starting with s and write it if no stage dropped it
+static void pipe_run(xml_pipe_t* pipe, xml_stage_t* s, xml_event_t* ev)
+{
+    int (*hook)(xml_stage_t* s, xml_event_t* ev);
+    xml_writer_t* w = pipe->writer;
+    int i;
+
+    for(; s; s = s->next)
+    {
+        switch(ev->type)
+        {
+            case XML_ERROR_HANDLER:         hook = s->error;            break;
+            case XML_COMMENT_HANDLER:       hook = s->comment;          break;
+            case XML_START_ELEMENT_HANDLER: hook = s->start_element;    break;
+            case XML_END_ELEMENT_HANDLER:   hook = s->end_element;      break;
+            case XML_CHARACTER_HANDLER:     hook = s->characters;       break;
+            case XML_PI_HANDLER:            hook = s->pi;               break;
+            case XML_CDATA_HANDLER:         hook = s->cdata;            break;
+            default: hook = 0;
+        }
+
+        if(hook && hook(s, ev) == XML_PIPE_DROP) return;
+    }
+
+    if(!w) return;
+
+    switch(ev->type)
+    {
+        case XML_COMMENT_HANDLER:
+            xml_write_comment(w, ev->text, ev->text_len);
+        break;
+
+        case XML_START_ELEMENT_HANDLER:
+            xml_write_start_element(w, ev->name);
+            for(i = 0; i < ev->attr_count; i++) xml_write_attr(w, ev->attrs + i);
+        break;
+
+        case XML_END_ELEMENT_HANDLER:
+            xml_write_end_element(w, ev->name);
+        break;
+
+        case XML_CHARACTER_HANDLER:
+            xml_write_characters(w, ev->text, ev->text_len);
+        break;
+
+        case XML_PI_HANDLER:
+            xml_write_pi(w, ev->text, ev->text_len);
+        break;
+
+        case XML_CDATA_HANDLER:
+            xml_write_cdata(w, ev->text, ev->text_len);
+        break;
+    }
+}
+
+
+
+// pass parser event to first stage
+// element with too many attributes is dropped with all events inside it,
+// only errors are passed
+static void pipe_deliver(xml_pipe_t* pipe, xml_event_t* ev)
+{
+    if(pipe->skip_level && ev->type != XML_ERROR_HANDLER)
+    {
+        if(ev->type == XML_END_ELEMENT_HANDLER && ev->level == pipe->skip_level - 1) pipe->skip_level = 0;
+        return;
+    }
+
+    pipe_run(pipe, pipe->first, ev);
+}
+
+
+
+// make event with text from parser
+static void pipe_text_event(xml_parser_t* p, int type, const char* text, int len)
+{
+    xml_event_t ev;
+
+    ev.type = type;
+    ev.level = p->level;
+    ev.name = 0;
+    ev.text = text;
+    ev.text_len = len < 0 ? (int)strlen(text) : len;
+    ev.attrs = 0;
+    ev.attr_count = 0;
+
+    pipe_deliver(p->user_ptr, &ev);
+}
+
+
+
+// parser handlers
+
+static void pipe_error(xml_parser_t* p)
+{
+    pipe_text_event(p, XML_ERROR_HANDLER, p->errorstr, -1);
+}
+
+static void pipe_comment(xml_parser_t* p)
+{
+    pipe_text_event(p, XML_COMMENT_HANDLER, p->comment, -1);
+}
+
+static void pipe_pi(xml_parser_t* p)
+{
+    pipe_text_event(p, XML_PI_HANDLER, p->pi, -1);
+}
+
+static void pipe_cdata(xml_parser_t* p)
+{
+    pipe_text_event(p, XML_CDATA_HANDLER, p->cdata, -1);
+}
+
+// parser text is raw, it is decoded so stages and writer see the same text as
+// in CDATA and writer does not escape references again
+static void pipe_characters(xml_parser_t* p)
+{
+    int len = xml_text_decode(p->chars, (int)strlen(p->chars));
+
+    pipe_text_event(p, XML_CHARACTER_HANDLER, p->chars, len);
+}
+
+static void pipe_start_element(xml_parser_t* p)
+{
+    xml_pipe_t* pipe = p->user_ptr;
+    xml_event_t ev;
+    xml_attr_t a;
+    char* ptr = p->attr;
+
+    ev.type = XML_START_ELEMENT_HANDLER;
+    ev.level = p->level;
+    ev.name = p->tag;
+    ev.text = 0;
+    ev.text_len = 0;
+    ev.attrs = pipe->attrs;
+    ev.attr_count = 0;
+
+    if(ptr && !pipe->skip_level)
+    {
+        while(ev.attr_count < pipe->max_attrs && xml_next_attr(&ptr, ev.attrs + ev.attr_count))
+        {
+            xml_attr_t* v = ev.attrs + ev.attr_count++;
+
+            // raw values are decoded in place, their closing quote is already passed
+            if(p->options & XML_OPTION_LAZY_ATTRS) v->value_len = xml_text_decode(v->value, v->value_len);
+        }
+
+        if(xml_next_attr(&ptr, &a))
+        {
+            // element is not written without some of its attributes,
+            // p->tag is kept for end event of empty element
+            char* tag = p->tag;
+
+            xml_set_error(p, XML_ERROR_ATTRS, "Too many attributes");
+            p->tag = tag;
+            pipe->skip_level = p->level;
+            return;
+        }
+    }
+
+    pipe_deliver(pipe, &ev);
+}
+
+static void pipe_end_element(xml_parser_t* p)
+{
+    xml_event_t ev;
+
+    ev.type = XML_END_ELEMENT_HANDLER;
+    ev.level = p->level;
+    ev.name = p->tag;
+    ev.text = 0;
+    ev.text_len = 0;
+    ev.attrs = 0;
+    ev.attr_count = 0;
+
+    pipe_deliver(p->user_ptr, &ev);
+}
+
+
+
+void xml_pipe_init(xml_pipe_t* pipe, xml_writer_t* writer, xml_attr_t* attrs, int max_attrs)
+{
+    pipe->user_ptr = 0;
+    pipe->first = 0;
+    pipe->last = 0;
+    pipe->writer = writer;
+    pipe->attrs = attrs;
+    pipe->max_attrs = max_attrs;
+    pipe->skip_level = 0;
+}
+
+
+
+void xml_pipe_add(xml_pipe_t* pipe, xml_stage_t* s)
+{
+    s->pipe = pipe;
+    s->next = 0;
+
+    if(pipe->last) pipe->last->next = s;
+    else pipe->first = s;
+
+    pipe->last = s;
+}
+
+
+
+void xml_pipe_attach(xml_pipe_t* pipe, xml_parser_t* p)
+{
+    p->user_ptr = pipe;
+
+    xml_set_handler(p, pipe_error, XML_ERROR_HANDLER);
+    xml_set_handler(p, pipe_comment, XML_COMMENT_HANDLER);
+    xml_set_handler(p, pipe_start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, pipe_end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, pipe_characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, pipe_pi, XML_PI_HANDLER);
+    xml_set_handler(p, pipe_cdata, XML_CDATA_HANDLER);
+}
+
+
+
+void xml_stage_emit(xml_stage_t* s, xml_event_t* ev)
+{
+    pipe_run(s->pipe, s->next, ev);
+}
+
+
+
+void xml_stage_init(xml_stage_t* s)
+{
+    s->user_ptr = 0;
+    s->pipe = 0;
+    s->next = 0;
+    s->name = 0;
+    s->arg = 0;
+    s->skip_level = 0;
+    s->error = 0;
+    s->comment = 0;
+    s->pi = 0;
+    s->cdata = 0;
+    s->start_element = 0;
+    s->end_element = 0;
+    s->characters = 0;
+}
+
+
+
+// built-in stages
+
+static int stage_match(xml_stage_t* s, xml_event_t* ev)
+{
+    return !s->name || !strcmp(s->name, ev->name);
+}
+
+
+
+static int stage_rename(xml_stage_t* s, xml_event_t* ev)
+{
+    if(stage_match(s, ev)) ev->name = s->arg;
+    return XML_PIPE_PASS;
+}
+
+void xml_stage_rename_element(xml_stage_t* s, const char* from, const char* to)
+{
+    xml_stage_init(s);
+    s->name = from;
+    s->arg = to;
+    s->start_element = stage_rename;
+    s->end_element = stage_rename;
+}
+
+
+
+static int stage_drop_attribute(xml_stage_t* s, xml_event_t* ev)
+{
+    int len = (int)strlen(s->arg);
+    int i, n = 0;
+
+    if(!stage_match(s, ev)) return XML_PIPE_PASS;
+
+    for(i = 0; i < ev->attr_count; i++)
+    {
+        if(ev->attrs[i].name_len == len && !memcmp(ev->attrs[i].name, s->arg, len)) continue;
+        ev->attrs[n++] = ev->attrs[i];
+    }
+
+    ev->attr_count = n;
+
+    return XML_PIPE_PASS;
+}
+
+void xml_stage_drop_attribute(xml_stage_t* s, const char* element, const char* attr)
+{
+    xml_stage_init(s);
+    s->name = element;
+    s->arg = attr;
+    s->start_element = stage_drop_attribute;
+}
+
+
+
+// drops matching element and all events inside it
+static int stage_drop_element(xml_stage_t* s, xml_event_t* ev)
+{
+    if(s->skip_level)
+    {
+        if(ev->type == XML_END_ELEMENT_HANDLER && ev->level == s->skip_level - 1) s->skip_level = 0;
+        return XML_PIPE_DROP;
+    }
+
+    if(ev->type == XML_START_ELEMENT_HANDLER && stage_match(s, ev))
+    {
+        s->skip_level = ev->level;
+        return XML_PIPE_DROP;
+    }
+
+    return XML_PIPE_PASS;
+}
+
+void xml_stage_drop_element(xml_stage_t* s, const char* element)
+{
+    xml_stage_init(s);
+    s->name = element;
+    s->comment = stage_drop_element;
+    s->pi = stage_drop_element;
+    s->cdata = stage_drop_element;
+    s->start_element = stage_drop_element;
+    s->end_element = stage_drop_element;
+    s->characters = stage_drop_element;
+}
+
+
+
+static int stage_drop(xml_stage_t* s, xml_event_t* ev)
+{
+    return XML_PIPE_DROP;
+}
+
+void xml_stage_drop_comments(xml_stage_t* s)
+{
+    xml_stage_init(s);
+    s->comment = stage_drop;
+}
@@ -0,0 +1,121 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlpipe.h
+// streaming filter pipeline: parser events pass through chain of stages
+// and end in xml writer, no tree and no copies of event data are made
+
+#ifndef __XMLPIPE_H__
+#define __XMLPIPE_H__
+
+#include "xmlparser.h"
+#include "xmlwriter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xml_event_s xml_event_t;
+typedef struct xml_stage_s xml_stage_t;
+typedef struct xml_pipe_s xml_pipe_t;
+
+struct xml_event_s
+{
+    int type;               // handler type, XML_START_ELEMENT_HANDLER, ...
+    int level;
+    const char* name;       // element name
+    const char* text;       // characters, CDATA, comment, PI or error string
+    int text_len;
+    xml_attr_t* attrs;      // attributes of start element
+    int attr_count;
+};
+
+// stage hooks return one of these
+enum
+{
+    XML_PIPE_PASS = 0,      // pass (possibly modified) event to next stage
+    XML_PIPE_DROP,          // drop event
+};
+
+struct xml_stage_s
+{
+    void* user_ptr;
+    xml_pipe_t* pipe;
+    xml_stage_t* next;
+    const char* name;       // arguments of built-in stages
+    const char* arg;
+    int skip_level;
+    int (*error)(xml_stage_t* s, xml_event_t* ev);
+    int (*comment)(xml_stage_t* s, xml_event_t* ev);
+    int (*pi)(xml_stage_t* s, xml_event_t* ev);
+    int (*cdata)(xml_stage_t* s, xml_event_t* ev);
+    int (*start_element)(xml_stage_t* s, xml_event_t* ev);
+    int (*end_element)(xml_stage_t* s, xml_event_t* ev);
+    int (*characters)(xml_stage_t* s, xml_event_t* ev);
+};
+
+struct xml_pipe_s
+{
+    void* user_ptr;
+    xml_stage_t* first;
+    xml_stage_t* last;
+    xml_writer_t* writer;
+    xml_attr_t* attrs;
+    int max_attrs;
+    int skip_level;         // level of dropped element with too many attributes or 0
+};
+
+
+// attrs is storage for attribute views of one start element, element with
+// more than max_attrs attributes is reported as XML_ERROR_ATTRS and dropped
+// with its content
+// characters events carry text with decoded references
+// writer can be 0 if pipeline output is consumed by last stage
+void xml_pipe_init(xml_pipe_t* pipe, xml_writer_t* writer, xml_attr_t* attrs, int max_attrs);
+
+// append stage to pipeline
+void xml_pipe_add(xml_pipe_t* pipe, xml_stage_t* s);
+
+// set handlers of p to feed pipeline, p->user_ptr is set to pipe
+void xml_pipe_attach(xml_pipe_t* pipe, xml_parser_t* p);
+
+// send event to stages after s and to writer
+// used by stage hooks to inject new events
+void xml_stage_emit(xml_stage_t* s, xml_event_t* ev);
+
+// stage without hooks, passes all events
+void xml_stage_init(xml_stage_t* s);
+
+// built-in stages
+// element name 0 matches any element
+void xml_stage_rename_element(xml_stage_t* s, const char* from, const char* to);
+void xml_stage_drop_attribute(xml_stage_t* s, const char* element, const char* attr);
+void xml_stage_drop_element(xml_stage_t* s, const char* element);
+void xml_stage_drop_comments(xml_stage_t* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLPIPE_H__
@@ -0,0 +1,649 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlprofile.c
+
+#include <stdlib.h>
+#include <string.h>
+#include "xmlprofile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// find first '>', '"' or '\'' in [ptr, end)
+static const char* profile_find_tag_char(const char* ptr, const char* end)
+{
+#ifdef __SSE2__
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i dq = _mm_set1_epi8('"');
+    const __m128i sq = _mm_set1_epi8('\'');
+
+    while(end - ptr >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_or_si128(_mm_cmpeq_epi8(v, dq), _mm_cmpeq_epi8(v, sq)));
+        int mask = _mm_movemask_epi8(m);
+
+        if(mask) return ptr + __builtin_ctz(mask);
+        ptr += 16;
+    }
+#endif
+
+    while(ptr < end && *ptr != '>' && *ptr != '"' && *ptr != '\'') ptr++;
+    return ptr;
+}
+
+
+
+// find end of tag, '>' inside quoted attribute values is skipped
+// returns pointer after '>' or 0 if end of buffer is reached
+static const char* profile_find_tag_end(const char* ptr, const char* end)
+{
+    while(1)
+    {
+        ptr = profile_find_tag_char(ptr, end);
+        if(ptr == end) return 0;
+        if(*ptr == '>') return ptr + 1;
+
+        // skip quoted value
+        ptr = memchr(ptr + 1, *ptr, end - ptr - 1);
+        if(!ptr) return 0;
+        ptr++;
+    }
+}
+
+
+
+// find string s of len chars in [ptr, end)
+// returns pointer after s or 0 if not found
+static const char* profile_find_str(const char* ptr, const char* end, const char* s, int len)
+{
+    while(end - ptr >= len)
+    {
+        ptr = memchr(ptr, s[0], end - ptr - len + 1);
+        if(!ptr) return 0;
+        if(!memcmp(ptr, s, len)) return ptr + len;
+        ptr++;
+    }
+
+    return 0;
+}
+
+
+
+// find end of DOCTYPE, internal subset in '[' ']' is skipped
+// returns pointer after '>' or 0 if end of buffer is reached
+static const char* profile_find_doctype_end(const char* ptr, const char* end)
+{
+    int subset = 0;
+
+    while(ptr < end)
+    {
+        char c = *ptr++;
+
+        if(c == '"' || c == '\'')
+        {
+            ptr = memchr(ptr, c, end - ptr);
+            if(!ptr) return 0;
+            ptr++;
+        }
+        else if(c == '[') subset = 1;
+        else if(c == ']') subset = 0;
+        else if(c == '>' && !subset) return ptr;
+        else if(c == '<' && subset && end - ptr >= 3 && !memcmp(ptr, "!--", 3))
+        {
+            ptr = profile_find_str(ptr + 3, end, "-->", 3);
+            if(!ptr) return 0;
+        }
+    }
+
+    return 0;
+}
+
+
+
+static int profile_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+
+static unsigned profile_hash(const char* s, int len)
+{
+    unsigned h = 2166136261u;
+
+    while(len--) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+
+
+// returns name id, name is added if needed, -1 if there is no enough memory
+static int profile_intern(xml_profile_t* pr, const char* name, int len)
+{
+    unsigned h = profile_hash(name, len);
+    unsigned mask, i;
+    int id;
+
+    if(pr->name_slots)
+    {
+        mask = pr->name_slots - 1;
+        for(i = h & mask; (id = pr->name_table[i]) != 0; i = (i + 1) & mask)
+        {
+            const xml_profile_name_t* n = pr->names + id - 1;
+
+            if(n->hash == h && n->len == len && !memcmp(pr->chars + n->offset, name, len)) return id - 1;
+        }
+    }
+
+    // hash table is at most half full
+    if(2 * (pr->name_count + 1) > pr->name_slots)
+    {
+        int slots = pr->name_slots ? 2 * pr->name_slots : 64;
+        int* table = calloc(slots, sizeof(int));
+
+        if(!table) return -1;
+
+        for(id = 0; id < pr->name_count; id++)
+        {
+            for(i = pr->names[id].hash & (slots - 1); table[i]; i = (i + 1) & (slots - 1));
+            table[i] = id + 1;
+        }
+
+        free(pr->name_table);
+        pr->name_table = table;
+        pr->name_slots = slots;
+    }
+
+    if(pr->name_count == pr->name_size)
+    {
+        int size = pr->name_size ? 2 * pr->name_size : 32;
+        xml_profile_name_t* names = realloc(pr->names, size * sizeof(xml_profile_name_t));
+
+        if(!names) return -1;
+        pr->names = names;
+        pr->name_size = size;
+    }
+
+    if(pr->chars_used + len + 1 > pr->chars_size)
+    {
+        int size = pr->chars_size ? pr->chars_size : 1024;
+        char* chars;
+
+        while(pr->chars_used + len + 1 > size) size *= 2;
+        chars = realloc(pr->chars, size);
+        if(!chars) return -1;
+        pr->chars = chars;
+        pr->chars_size = size;
+    }
+
+    id = pr->name_count++;
+    memset(pr->names + id, 0, sizeof(xml_profile_name_t));
+    pr->names[id].offset = pr->chars_used;
+    pr->names[id].len = len;
+    pr->names[id].hash = h;
+    memcpy(pr->chars + pr->chars_used, name, len);
+    pr->chars[pr->chars_used + len] = 0;
+    pr->chars_used += len + 1;
+
+    mask = pr->name_slots - 1;
+    for(i = h & mask; pr->name_table[i]; i = (i + 1) & mask);
+    pr->name_table[i] = id + 1;
+
+    return id;
+}
+
+
+
+static unsigned profile_attr_hash(int element, int attr)
+{
+    return ((unsigned)element * 2654435761u) ^ ((unsigned)attr * 40503u);
+}
+
+
+
+// count attribute attr of element, returns 0 if there is no enough memory
+static int profile_count_attr(xml_profile_t* pr, int element, int attr)
+{
+    unsigned h = profile_attr_hash(element, attr);
+    unsigned mask, i;
+    int n;
+
+    if(pr->attr_slots)
+    {
+        mask = pr->attr_slots - 1;
+        for(i = h & mask; (n = pr->attr_table[i]) != 0; i = (i + 1) & mask)
+        {
+            xml_profile_attr_t* a = pr->attrs + n - 1;
+
+            if(a->element == element && a->attr == attr)
+            {
+                a->count++;
+                return 1;
+            }
+        }
+    }
+
+    if(2 * (pr->attr_count + 1) > pr->attr_slots)
+    {
+        int slots = pr->attr_slots ? 2 * pr->attr_slots : 64;
+        int* table = calloc(slots, sizeof(int));
+
+        if(!table) return 0;
+
+        for(n = 0; n < pr->attr_count; n++)
+        {
+            for(i = profile_attr_hash(pr->attrs[n].element, pr->attrs[n].attr) & (slots - 1); table[i]; i = (i + 1) & (slots - 1));
+            table[i] = n + 1;
+        }
+
+        free(pr->attr_table);
+        pr->attr_table = table;
+        pr->attr_slots = slots;
+    }
+
+    if(pr->attr_count == pr->attr_size)
+    {
+        int size = pr->attr_size ? 2 * pr->attr_size : 32;
+        xml_profile_attr_t* attrs = realloc(pr->attrs, size * sizeof(xml_profile_attr_t));
+
+        if(!attrs) return 0;
+        pr->attrs = attrs;
+        pr->attr_size = size;
+    }
+
+    n = pr->attr_count++;
+    pr->attrs[n].element = element;
+    pr->attrs[n].attr = attr;
+    pr->attrs[n].count = 1;
+
+    mask = pr->attr_slots - 1;
+    for(i = h & mask; pr->attr_table[i]; i = (i + 1) & mask);
+    pr->attr_table[i] = n + 1;
+
+    return 1;
+}
+
+
+
+static void profile_token(xml_profile_t* pr, size_t len)
+{
+    if(len > pr->max_token) pr->max_token = len;
+}
+
+
+
+// count start tag [tag, tag_end), returns element name id or -1 if there is
+// no enough memory
+static int profile_start_tag(xml_profile_t* pr, const char* tag, const char* tag_end, int depth)
+{
+    const char* ptr = tag + 1;
+    const char* end = tag_end - 1;
+    const char* name = ptr;
+    xml_profile_name_t* n;
+    int id, attr, attrs = 0;
+
+    if(end > ptr && end[-1] == '/') end--;
+
+    while(ptr < end && !profile_space(*ptr)) ptr++;
+    id = profile_intern(pr, name, (int)(ptr - name));
+    if(id < 0) return -1;
+
+    while(1)
+    {
+        while(ptr < end && profile_space(*ptr)) ptr++;
+        if(ptr == end) break;
+
+        name = ptr;
+        while(ptr < end && *ptr != '=' && !profile_space(*ptr)) ptr++;
+        attr = profile_intern(pr, name, (int)(ptr - name));
+        if(attr < 0 || !profile_count_attr(pr, id, attr)) return -1;
+        pr->names[attr].attributes++;
+        attrs++;
+
+        // skip value, quotes are matched by tag scan
+        while(ptr < end && *ptr != '"' && *ptr != '\'') ptr++;
+        if(ptr == end) break;
+        ptr = memchr(ptr + 1, *ptr, end - ptr - 1);
+        if(!ptr) break;
+        ptr++;
+    }
+
+    n = pr->names + id;
+    n->elements++;
+    if(depth > n->max_depth) n->max_depth = depth;
+    if(attrs > n->max_attrs) n->max_attrs = attrs;
+
+    pr->elements++;
+    pr->attributes += attrs;
+    if(attrs > pr->max_attrs) pr->max_attrs = attrs;
+    if(depth > pr->max_depth) pr->max_depth = depth;
+    pr->depths[depth < XML_PROFILE_DEPTH ? depth : XML_PROFILE_DEPTH]++;
+    profile_token(pr, tag_end - tag);
+
+    return id;
+}
+
+
+
+// count text [ptr, end) of element id or -1 outside of stack
+static void profile_text(xml_profile_t* pr, const char* ptr, const char* end, int id)
+{
+    size_t len = end - ptr;
+    int size_class = 0;
+
+    while(ptr < end && profile_space(*ptr)) ptr++;
+    if(ptr == end)
+    {
+        pr->space_runs++;
+        return;
+    }
+
+    while((len >> size_class) && size_class < XML_PROFILE_SIZES - 1) size_class++;
+
+    pr->text_runs++;
+    pr->text_bytes += len;
+    pr->text_sizes[size_class]++;
+    if(id >= 0) pr->names[id].text_bytes += len;
+    profile_token(pr, len);
+}
+
+
+
+void xml_profile_init(xml_profile_t* pr)
+{
+    memset(pr, 0, sizeof(*pr));
+}
+
+
+
+void xml_profile_free(xml_profile_t* pr)
+{
+    free(pr->name_table);
+    free(pr->names);
+    free(pr->chars);
+    free(pr->attr_table);
+    free(pr->attrs);
+    xml_profile_init(pr);
+}
+
+
+
+int xml_profile_scan(xml_profile_t* pr, const char* buf, size_t size)
+{
+    const char* end = buf + size;
+    const char* ptr = buf;
+    const char* text;
+    const char* tag;
+    int stack[XML_PROFILE_DEPTH];
+    int level = 0;
+    int id;
+
+    pr->documents++;
+    pr->bytes += size;
+
+    while(1)
+    {
+        text = ptr;
+        ptr = memchr(ptr, '<', end - ptr);
+        if(!ptr) break;
+
+        // only text inside document element is counted
+        if(ptr != text && level) profile_text(pr, text, ptr, level <= XML_PROFILE_DEPTH ? stack[level - 1] : -1);
+
+        tag = ptr++;
+        if(ptr == end) return XML_ERROR_DOCUMENT_END;
+
+        if(*ptr == '!')
+        {
+            if(end - ptr >= 3 && ptr[1] == '-' && ptr[2] == '-')
+            {
+                ptr = profile_find_str(ptr + 3, end, "-->", 3);
+                pr->comments++;
+            }
+            else if(end - ptr >= 8 && !memcmp(ptr, "![CDATA[", 8))
+            {
+                ptr = profile_find_str(ptr + 8, end, "]]>", 3);
+                pr->cdata++;
+            }
+            else ptr = profile_find_doctype_end(ptr, end);
+
+            if(ptr) profile_token(pr, ptr - tag);
+        }
+        else if(*ptr == '?')
+        {
+            ptr = profile_find_str(ptr + 1, end, "?>", 2);
+            pr->pis++;
+            if(ptr) profile_token(pr, ptr - tag);
+        }
+        else if(*ptr == '/')
+        {
+            ptr = memchr(ptr, '>', end - ptr);
+            if(!ptr) return XML_ERROR_DOCUMENT_END;
+            ptr++;
+
+            if(!level) return XML_ERROR_MALFORMED;
+            level--;
+        }
+        else
+        {
+            ptr = profile_find_tag_end(ptr, end);
+            if(!ptr) return XML_ERROR_DOCUMENT_END;
+
+            id = profile_start_tag(pr, tag, ptr, level + 1);
+            if(id < 0) return XML_ERROR_NO_MEMORY;
+
+            if(ptr[-2] != '/')
+            {
+                if(level < XML_PROFILE_DEPTH) stack[level] = id;
+                level++;
+            }
+        }
+
+        if(!ptr) return XML_ERROR_DOCUMENT_END;
+    }
+
+    if(level) return XML_ERROR_DOCUMENT_END;
+
+    return XML_ERROR_NONE;
+}
+
+
+
+int xml_profile_file(xml_profile_t* pr, const char* path)
+{
+    char* image;
+    size_t size;
+    int err;
+
+#ifndef _WIN32
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0) return XML_ERROR_ARG;
+
+    if(fstat(fd, &st) || st.st_size <= 0)
+    {
+        close(fd);
+        return XML_ERROR_ARG;
+    }
+
+    size = (size_t)st.st_size;
+    image = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(image == MAP_FAILED) return XML_ERROR_ARG;
+
+    // file is read once from start to end
+#ifdef MADV_SEQUENTIAL
+    madvise(image, size, MADV_SEQUENTIAL);
+#endif
+
+    err = xml_profile_scan(pr, image, size);
+    munmap(image, size);
+#else
+    FILE* f = fopen(path, "rb");
+    long len;
+
+    if(!f) return XML_ERROR_ARG;
+
+    image = 0;
+    if(!fseek(f, 0, SEEK_END) && (len = ftell(f)) > 0 && !fseek(f, 0, SEEK_SET))
+    {
+        size = (size_t)len;
+        image = malloc(size);
+        if(image && fread(image, 1, size, f) != size)
+        {
+            free(image);
+            image = 0;
+        }
+    }
+    fclose(f);
+
+    if(!image) return XML_ERROR_ARG;
+
+    err = xml_profile_scan(pr, image, size);
+    free(image);
+#endif
+
+    return err;
+}
+
+
+
+const char* xml_profile_name(const xml_profile_t* pr, int id)
+{
+    return pr->chars + pr->names[id].offset;
+}
+
+
+
+static long long profile_uses(const xml_profile_name_t* n)
+{
+    return n->elements + n->attributes;
+}
+
+
+
+int xml_profile_top_names(const xml_profile_t* pr, int* ids, int max)
+{
+    int count = 0;
+    int id, i;
+
+    // insertion into sorted ids, names are few
+    for(id = 0; id < pr->name_count; id++)
+    {
+        long long uses = profile_uses(pr->names + id);
+
+        if(count == max && (!max || uses <= profile_uses(pr->names + ids[count - 1]))) continue;
+
+        i = count < max ? count++ : count - 1;
+        while(i > 0 && profile_uses(pr->names + ids[i - 1]) < uses)
+        {
+            ids[i] = ids[i - 1];
+            i--;
+        }
+        ids[i] = id;
+    }
+
+    return count;
+}
+
+
+
+int xml_profile_pool_size(const xml_profile_t* pr)
+{
+    // parser stores zero terminator after name and every attribute name and
+    // value, it is less than size of tag
+    size_t need = pr->max_token + 16;
+    size_t size = 256;
+
+    while(size < need && size < 0x40000000) size *= 2;
+
+    return (int)size;
+}
+
+
+
+void xml_profile_report(const xml_profile_t* pr, FILE* f)
+{
+    int* ids = malloc((pr->name_count ? pr->name_count : 1) * sizeof(int));
+    int count, i, j;
+
+    fprintf(f, "documents   %lld\n", pr->documents);
+    fprintf(f, "bytes       %lld\n", pr->bytes);
+    fprintf(f, "elements    %lld\n", pr->elements);
+    fprintf(f, "attributes  %lld\n", pr->attributes);
+    fprintf(f, "text        %lld runs, %lld bytes, %lld whitespace runs\n", pr->text_runs, pr->text_bytes, pr->space_runs);
+    fprintf(f, "comments    %lld\n", pr->comments);
+    fprintf(f, "pis         %lld\n", pr->pis);
+    fprintf(f, "cdata       %lld\n", pr->cdata);
+    fprintf(f, "names       %d\n", pr->name_count);
+    fprintf(f, "max depth   %d\n", pr->max_depth);
+    fprintf(f, "max attrs   %d\n", pr->max_attrs);
+    fprintf(f, "max token   %lu\n", (unsigned long)pr->max_token);
+    fprintf(f, "pool size   %d\n", xml_profile_pool_size(pr));
+
+    fprintf(f, "\ndepth       elements\n");
+    for(i = 1; i <= XML_PROFILE_DEPTH; i++)
+    {
+        if(pr->depths[i]) fprintf(f, "%s%-10d %lld\n", i == XML_PROFILE_DEPTH ? ">=" : "  ", i, pr->depths[i]);
+    }
+
+    fprintf(f, "\ntext bytes  runs\n");
+    for(i = 0; i < XML_PROFILE_SIZES; i++)
+    {
+        if(pr->text_sizes[i]) fprintf(f, "  <%-9lu %lld\n", 1ul << i, pr->text_sizes[i]);
+    }
+
+    if(!ids) return;
+    count = xml_profile_top_names(pr, ids, pr->name_count);
+
+    fprintf(f, "\n%-24s %12s %12s %12s %6s %6s\n", "name", "elements", "attributes", "text bytes", "depth", "attrs");
+    for(i = 0; i < count; i++)
+    {
+        const xml_profile_name_t* n = pr->names + ids[i];
+
+        fprintf(f, "%-24s %12lld %12lld %12lld %6d %6d\n", xml_profile_name(pr, ids[i]), n->elements, n->attributes, n->text_bytes, n->max_depth, n->max_attrs);
+
+        for(j = 0; j < pr->attr_count; j++)
+        {
+            const xml_profile_attr_t* a = pr->attrs + j;
+
+            if(a->element == ids[i]) fprintf(f, "  @%-21s %12lld\n", xml_profile_name(pr, a->attr), a->count);
+        }
+    }
+
+    free(ids);
+}
@@ -0,0 +1,147 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlprofile.h
+// shape profile of documents: element and attribute name histograms,
+// attributes used by every element, depth and text size distributions
+//
+// documents are scanned in place with structural scan like xmlindex.h,
+// nothing is copied to parser pool and text is only measured; names are
+// interned to hash table with counters, so profile of many documents or of
+// multi-GB file needs memory only for distinct names
+//
+//     xml_profile_init(&pr);
+//     xml_profile_file(&pr, "feed.xml");
+//     xml_profile_report(&pr, stdout);
+//     xml_init(&p, malloc(xml_profile_pool_size(&pr)), xml_profile_pool_size(&pr));
+//
+// text size is size of raw text between tags, references are not decoded;
+// DOCTYPE is skipped
+
+#ifndef __XMLPROFILE_H__
+#define __XMLPROFILE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// elements deeper than this are counted at last depth and their text is not
+// counted to their element name
+#define XML_PROFILE_DEPTH   64
+
+// number of text size classes, class i counts text of 2^(i-1) to 2^i - 1 bytes
+#define XML_PROFILE_SIZES   32
+
+typedef struct xml_profile_name_s xml_profile_name_t;
+typedef struct xml_profile_attr_s xml_profile_attr_t;
+typedef struct xml_profile_s xml_profile_t;
+
+struct xml_profile_name_s
+{
+    int offset;             // of zero terminated name in chars
+    int len;
+    unsigned hash;
+    long long elements;     // count as element name
+    long long attributes;   // count as attribute name
+    long long text_bytes;   // text directly inside elements with this name
+    int max_depth;
+    int max_attrs;
+};
+
+// attribute used by element
+struct xml_profile_attr_s
+{
+    int element;            // name ids
+    int attr;
+    long long count;
+};
+
+struct xml_profile_s
+{
+    long long documents;
+    long long bytes;
+    long long elements;
+    long long attributes;
+    long long text_runs;    // text with other chars than whitespace
+    long long text_bytes;
+    long long space_runs;   // whitespace only text
+    long long comments;
+    long long pis;
+    long long cdata;
+    int max_depth;
+    int max_attrs;          // attributes of one element
+    size_t max_token;       // largest start tag, text, comment, PI or CDATA
+    long long depths[XML_PROFILE_DEPTH + 1];    // elements by depth
+    long long text_sizes[XML_PROFILE_SIZES];    // text runs by size class
+    int name_count;
+    int name_size;
+    int name_slots;
+    int* name_table;        // hash table of name ids + 1, 0 is empty slot
+    xml_profile_name_t* names;
+    char* chars;
+    int chars_used;
+    int chars_size;
+    int attr_count;
+    int attr_size;
+    int attr_slots;
+    int* attr_table;        // hash table of attr indices + 1
+    xml_profile_attr_t* attrs;
+};
+
+
+void xml_profile_init(xml_profile_t* pr);
+
+void xml_profile_free(xml_profile_t* pr);
+
+// add document of size bytes to profile
+// returns XML_ERROR_NONE, XML_ERROR_NO_MEMORY, XML_ERROR_MALFORMED or
+// XML_ERROR_DOCUMENT_END; counts up to error stay in profile
+int xml_profile_scan(xml_profile_t* pr, const char* buf, size_t size);
+
+// same as xml_profile_scan for file, file is mapped to memory if possible
+// returns XML_ERROR_ARG if file can not be read
+int xml_profile_file(xml_profile_t* pr, const char* path);
+
+// zero terminated name of name id
+const char* xml_profile_name(const xml_profile_t* pr, int id);
+
+// store ids of up to max names ordered by number of uses, most used first,
+// for seeding name tables; returns number of stored ids
+int xml_profile_top_names(const xml_profile_t* pr, int* ids, int max);
+
+// pool size that fits largest token of profiled documents
+int xml_profile_pool_size(const xml_profile_t* pr);
+
+// write text report
+void xml_profile_report(const xml_profile_t* pr, FILE* f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLPROFILE_H__
@@ -0,0 +1,629 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlscan.c
+// command line tool that parses many xml files in parallel
+//
+//     xmlscan [-j threads] [-c | -p path | -v dtd | -s] [-r] file|dir ...
+//
+//     -c          count elements (default)
+//     -p path     print text or attribute of elements at absolute path,
+//                 "Profile/Tools/Tool/@Filename" or "Profile/Tools/Tool/Description"
+//     -v dtd      validate files with DTD subset
+//     -s          print statistics of files
+//     -r          recover after errors
+//
+// directories are searched recursively for *.xml files, patterns that are not
+// expanded by shell are expanded with glob; plain files are mapped to memory,
+// .gz and .zst files are decompressed while they are parsed
+//
+// files are split between workers, worker that runs out of files steals half
+// of remaining files of another worker, every worker has its own parser and pool
+//
+//     gcc -O2 -DXML_HAVE_THREADS xmlscan.c xmlvalid.c xmlzip.c xmlparser.c -o xmlscan -lpthread
+//
+// add -DXML_HAVE_ZLIB -lz for gzip and -DXML_HAVE_ZSTD -lzstd for zstd input,
+// directories and globs need POSIX
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "xmlparser.h"
+#include "xmlvalid.h"
+#include "xmlzip.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef XML_HAVE_THREADS
+#include <pthread.h>
+#endif
+
+
+#define SCAN_POOL       (64 * 1024)
+#define SCAN_LEVELS     64
+#define SCAN_PATH       1024
+#define SCAN_TEXT       4096
+#define SCAN_THREADS    64
+
+enum
+{
+    ACTION_COUNT = 0,
+    ACTION_PATH,
+    ACTION_VALIDATE,
+    ACTION_STATS,
+};
+
+typedef struct scan_worker_s scan_worker_t;
+
+struct scan_worker_s
+{
+    xml_parser_t p;
+    xml_valid_t valid;      // copy of compiled DTD with own element stack
+    char* pool;
+    const char* file;
+    int head;               // next file of worker
+    int tail;               // end of files of worker
+    int file_errors;        // errors in current file
+    long long files;
+    long long error_files;
+    long long bytes;
+    long long elements;
+    long long attrs;
+    long long text_bytes;
+    int max_depth;
+    int match_level;        // level of element at path or 0
+    int text_len;
+    int path_len[SCAN_LEVELS];
+    char path[SCAN_PATH];
+    char text[SCAN_TEXT];
+#ifdef XML_HAVE_THREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+#endif
+};
+
+
+static char** files;
+static int file_count;
+static int file_size;
+
+static int action = ACTION_COUNT;
+static const char* match_path;      // element part of path
+static int match_len;
+static const char* match_attr;      // attribute name or 0
+
+static scan_worker_t* workers;
+static int worker_count = 1;
+
+#ifdef XML_HAVE_THREADS
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+#define OUTPUT_LOCK()   pthread_mutex_lock(&output_lock)
+#define OUTPUT_UNLOCK() pthread_mutex_unlock(&output_lock)
+#else
+#define OUTPUT_LOCK()
+#define OUTPUT_UNLOCK()
+#endif
+
+
+
+static void add_file(const char* path)
+{
+    if(file_count == file_size)
+    {
+        file_size = file_size ? 2 * file_size : 1024;
+        files = realloc(files, file_size * sizeof(char*));
+        if(!files)
+        {
+            fprintf(stderr, "xmlscan: no enough memory\n");
+            exit(2);
+        }
+    }
+
+    files[file_count++] = strdup(path);
+}
+
+
+
+static int has_suffix(const char* s, const char* suffix)
+{
+    size_t len = strlen(s), n = strlen(suffix);
+
+    return len >= n && !strcmp(s + len - n, suffix);
+}
+
+
+
+static int is_xml_file(const char* name)
+{
+    return has_suffix(name, ".xml") || has_suffix(name, ".xml.gz") || has_suffix(name, ".xml.zst");
+}
+
+
+
+#ifndef _WIN32
+
+static void add_dir(const char* dir)
+{
+    DIR* d = opendir(dir);
+    struct dirent* e;
+    char path[4096];
+
+    if(!d)
+    {
+        fprintf(stderr, "xmlscan: can not open %s\n", dir);
+        return;
+    }
+
+    while((e = readdir(d)) != 0)
+    {
+        struct stat st;
+
+        if(e->d_name[0] == '.') continue;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if(stat(path, &st)) continue;
+
+        if(S_ISDIR(st.st_mode)) add_dir(path);
+        else if(S_ISREG(st.st_mode) && is_xml_file(e->d_name)) add_file(path);
+    }
+
+    closedir(d);
+}
+
+#endif
+
+
+
+static void add_arg(const char* arg)
+{
+#ifndef _WIN32
+    struct stat st;
+    glob_t g;
+    size_t i;
+
+    if(!stat(arg, &st))
+    {
+        if(S_ISDIR(st.st_mode)) add_dir(arg);
+        else add_file(arg);
+        return;
+    }
+
+    if(strpbrk(arg, "*?[") && !glob(arg, 0, 0, &g))
+    {
+        for(i = 0; i < g.gl_pathc; i++) add_arg(g.gl_pathv[i]);
+        globfree(&g);
+        return;
+    }
+
+    fprintf(stderr, "xmlscan: can not open %s\n", arg);
+#else
+    add_file(arg);
+#endif
+}
+
+
+
+static void scan_error(xml_parser_t* p)
+{
+    scan_worker_t* w = p->user_ptr;
+
+    w->file_errors++;
+
+    OUTPUT_LOCK();
+    fprintf(stderr, "%s:%lu: error %d: %s\n", w->file, (unsigned long)p->bytes, p->errorcode, p->errorstr ? p->errorstr : "");
+    OUTPUT_UNLOCK();
+}
+
+
+
+static void scan_start_element(xml_parser_t* p)
+{
+    scan_worker_t* w = p->user_ptr;
+
+    w->elements++;
+    if(p->level > w->max_depth) w->max_depth = p->level;
+
+    if(action == ACTION_STATS)
+    {
+        char* attr_string = p->attr;
+        xml_attr_t a;
+
+        while(attr_string && xml_next_attr(&attr_string, &a)) w->attrs++;
+    }
+    else if(action == ACTION_VALIDATE) xml_valid_start(&w->valid, p);
+    else if(action == ACTION_PATH && p->level < SCAN_LEVELS)
+    {
+        int start = w->path_len[p->level - 1];
+        int len = (int)strlen(p->tag);
+
+        // append element name to path
+        w->path_len[p->level] = start;
+        if(start + len + 2 > SCAN_PATH) return;
+        if(start) w->path[start++] = '/';
+        memcpy(w->path + start, p->tag, len);
+        w->path_len[p->level] = start + len;
+
+        if(w->path_len[p->level] != match_len || memcmp(w->path, match_path, match_len)) return;
+
+        if(match_attr)
+        {
+            xml_attr_t a;
+
+            if(!xml_get_attr(p->attr, match_attr, &a)) return;
+
+            OUTPUT_LOCK();
+            printf("%s: %.*s\n", w->file, a.value_len, a.value);
+            OUTPUT_UNLOCK();
+        }
+        else
+        {
+            w->match_level = p->level;
+            w->text_len = 0;
+        }
+    }
+}
+
+
+
+static void scan_end_element(xml_parser_t* p)
+{
+    scan_worker_t* w = p->user_ptr;
+
+    if(action == ACTION_VALIDATE) xml_valid_end(&w->valid, p);
+    else if(action == ACTION_PATH && w->match_level && w->match_level == p->level + 1)
+    {
+        w->match_level = 0;
+
+        OUTPUT_LOCK();
+        printf("%s: %.*s\n", w->file, w->text_len, w->text);
+        OUTPUT_UNLOCK();
+    }
+}
+
+
+
+static void scan_text(scan_worker_t* w, xml_parser_t* p, const char* text)
+{
+    if(action == ACTION_STATS) w->text_bytes += strlen(text);
+    else if(action == ACTION_VALIDATE) xml_valid_text(&w->valid, p, text);
+    else if(action == ACTION_PATH && w->match_level == p->level)
+    {
+        int len = (int)strlen(text);
+
+        if(len > SCAN_TEXT - w->text_len) len = SCAN_TEXT - w->text_len;
+        memcpy(w->text + w->text_len, text, len);
+        w->text_len += len;
+    }
+}
+
+
+
+// parser text is raw, printed text is decoded in place
+static void scan_characters(xml_parser_t* p)
+{
+    scan_worker_t* w = p->user_ptr;
+
+    if(action == ACTION_PATH && w->match_level == p->level) xml_text_decode(p->chars, (int)strlen(p->chars));
+    scan_text(w, p, p->chars);
+}
+
+
+
+static void scan_cdata(xml_parser_t* p)
+{
+    scan_text(p->user_ptr, p, p->cdata);
+}
+
+
+
+static void scan_file(scan_worker_t* w, const char* path)
+{
+    xml_parser_t* p = &w->p;
+
+    w->file = path;
+    w->file_errors = 0;
+    w->match_level = 0;
+    w->path_len[0] = 0;
+    p->errorcode = XML_ERROR_NONE;
+
+    if(has_suffix(path, ".gz") || has_suffix(path, ".zst"))
+    {
+        xml_parse_zip_file(p, path, XML_ZIP_AUTO, 0);
+    }
+    else
+    {
+#ifndef _WIN32
+        struct stat st;
+        int fd = open(path, O_RDONLY);
+        char* data;
+
+        if(fd < 0 || fstat(fd, &st))
+        {
+            if(fd >= 0) close(fd);
+            xml_set_error(p, XML_ERROR_ARG, "Can not open file");
+            w->error_files++;
+            return;
+        }
+
+        // empty file can not be mapped, it is parsed as empty buffer
+        data = st.st_size ? mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+        close(fd);
+
+        if(data == MAP_FAILED)
+        {
+            xml_set_error(p, XML_ERROR_NO_MEMORY, "Can not map file");
+            w->error_files++;
+            return;
+        }
+
+#ifdef MADV_SEQUENTIAL
+        if(st.st_size) madvise(data, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+        xml_parse_buffer(p, data, st.st_size);
+        w->bytes += st.st_size;
+
+        if(st.st_size) munmap(data, st.st_size);
+#else
+        xml_parse_zip_file(p, path, XML_ZIP_NONE, 0);
+#endif
+    }
+
+    w->files++;
+    if(w->file_errors) w->error_files++;
+}
+
+
+
+#ifdef XML_HAVE_THREADS
+
+// take next file of worker or steal half of remaining files of other worker
+// returns file index or -1 if there are no more files
+static int next_file(scan_worker_t* w)
+{
+    int i, n;
+
+    pthread_mutex_lock(&w->lock);
+    n = w->head < w->tail ? w->head++ : -1;
+    pthread_mutex_unlock(&w->lock);
+
+    if(n >= 0) return n;
+
+    for(i = 1; i < worker_count; i++)
+    {
+        scan_worker_t* v = workers + (w - workers + i) % worker_count;
+        int head = 0, tail = 0;
+
+        pthread_mutex_lock(&v->lock);
+        if(v->tail - v->head > 1)
+        {
+            // thief takes upper half, owner keeps files it is close to
+            tail = v->tail;
+            head = v->tail -= (v->tail - v->head) / 2;
+        }
+        pthread_mutex_unlock(&v->lock);
+
+        if(head < tail)
+        {
+            pthread_mutex_lock(&w->lock);
+            w->head = head + 1;
+            w->tail = tail;
+            pthread_mutex_unlock(&w->lock);
+            return head;
+        }
+    }
+
+    return -1;
+}
+
+
+
+static void* scan_worker(void* arg)
+{
+    scan_worker_t* w = arg;
+    int n;
+
+    while((n = next_file(w)) >= 0) scan_file(w, files[n]);
+
+    return 0;
+}
+
+#endif
+
+
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: xmlscan [-j threads] [-c | -p path | -v dtd | -s] [-r] file|dir ...\n");
+    exit(2);
+}
+
+
+
+static char* read_file(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    char* data = 0;
+    long size;
+
+    if(f && !fseek(f, 0, SEEK_END) && (size = ftell(f)) >= 0 && !fseek(f, 0, SEEK_SET) &&
+       (data = malloc(size + 1)) != 0)
+    {
+        data[fread(data, 1, size, f)] = 0;
+    }
+
+    if(f) fclose(f);
+    return data;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    xml_valid_t valid;
+    scan_worker_t total;
+    const char* dtd_path = 0;
+    int recover = 0;
+    clock_t start = clock();
+    int i, err;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-j") && i + 1 < argc) worker_count = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-c")) action = ACTION_COUNT;
+        else if(!strcmp(argv[i], "-p") && i + 1 < argc)
+        {
+            const char* at;
+
+            action = ACTION_PATH;
+            match_path = argv[++i];
+            at = strchr(match_path, '@');
+            match_attr = at ? at + 1 : 0;
+            match_len = at ? (int)(at - match_path) : (int)strlen(match_path);
+            if(at && match_len) match_len--;
+        }
+        else if(!strcmp(argv[i], "-v") && i + 1 < argc)
+        {
+            action = ACTION_VALIDATE;
+            dtd_path = argv[++i];
+        }
+        else if(!strcmp(argv[i], "-s")) action = ACTION_STATS;
+        else if(!strcmp(argv[i], "-r")) recover = 1;
+        else if(argv[i][0] == '-') usage();
+        else add_arg(argv[i]);
+    }
+
+    if(!file_count) usage();
+    if(worker_count < 1) worker_count = 1;
+    if(worker_count > SCAN_THREADS) worker_count = SCAN_THREADS;
+    if(worker_count > file_count) worker_count = file_count;
+
+    if(action == ACTION_VALIDATE)
+    {
+        char* dtd = read_file(dtd_path);
+
+        if(!dtd)
+        {
+            fprintf(stderr, "xmlscan: can not read %s\n", dtd_path);
+            return 2;
+        }
+
+        err = xml_valid_compile(&valid, dtd);
+        if(err)
+        {
+            fprintf(stderr, "%s:%d: %s\n", dtd_path, valid.error_pos, valid.errorstr);
+            return 2;
+        }
+        free(dtd);
+    }
+
+    workers = calloc(worker_count, sizeof(scan_worker_t));
+    if(!workers) return 2;
+
+    for(i = 0; i < worker_count; i++)
+    {
+        scan_worker_t* w = workers + i;
+
+        w->pool = malloc(SCAN_POOL);
+        if(!w->pool) return 2;
+
+        xml_init(&w->p, w->pool, SCAN_POOL);
+        w->p.user_ptr = w;
+        xml_set_handler(&w->p, scan_error, XML_ERROR_HANDLER);
+        xml_set_handler(&w->p, scan_start_element, XML_START_ELEMENT_HANDLER);
+        xml_set_handler(&w->p, scan_end_element, XML_END_ELEMENT_HANDLER);
+        xml_set_handler(&w->p, scan_characters, XML_CHARACTER_HANDLER);
+        xml_set_handler(&w->p, scan_cdata, XML_CDATA_HANDLER);
+        if(action == ACTION_PATH) xml_set_option(&w->p, XML_OPTION_TRIM, 1);
+        if(recover) xml_set_option(&w->p, XML_OPTION_RECOVER, 1);
+
+        // compiled tables are shared, element stack is per worker
+        if(action == ACTION_VALIDATE) w->valid = valid;
+
+        // contiguous ranges of files
+        w->head = (int)((long long)file_count * i / worker_count);
+        w->tail = (int)((long long)file_count * (i + 1) / worker_count);
+    }
+
+#ifdef XML_HAVE_THREADS
+    for(i = 0; i < worker_count; i++) pthread_mutex_init(&workers[i].lock, 0);
+    for(i = 1; i < worker_count; i++) pthread_create(&workers[i].thread, 0, scan_worker, workers + i);
+    scan_worker(workers);
+    for(i = 1; i < worker_count; i++) pthread_join(workers[i].thread, 0);
+#else
+    for(i = 0; i < file_count; i++) scan_file(workers, files[i]);
+#endif
+
+    memset(&total, 0, sizeof(total));
+    for(i = 0; i < worker_count; i++)
+    {
+        scan_worker_t* w = workers + i;
+
+        total.files += w->files;
+        total.error_files += w->error_files;
+        total.bytes += w->bytes;
+        total.elements += w->elements;
+        total.attrs += w->attrs;
+        total.text_bytes += w->text_bytes;
+        if(w->max_depth > total.max_depth) total.max_depth = w->max_depth;
+        free(w->pool);
+    }
+
+    if(action == ACTION_COUNT)
+    {
+        printf("files %lld, elements %lld, files with errors %lld\n", total.files, total.elements, total.error_files);
+    }
+    else if(action == ACTION_VALIDATE)
+    {
+        printf("files %lld, invalid or malformed %lld\n", total.files, total.error_files);
+        xml_valid_free(&valid);
+    }
+    else if(action == ACTION_STATS)
+    {
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        printf("files             %lld\n", total.files);
+        printf("files with errors %lld\n", total.error_files);
+        printf("mapped bytes      %lld\n", total.bytes);
+        printf("elements          %lld\n", total.elements);
+        printf("attributes        %lld\n", total.attrs);
+        printf("text bytes        %lld\n", total.text_bytes);
+        printf("max depth         %d\n", total.max_depth);
+        printf("cpu seconds       %.3f\n", seconds);
+    }
+
+    free(workers);
+    for(i = 0; i < file_count; i++) free(files[i]);
+    free(files);
+
+    return total.error_files ? 1 : 0;
+}
@@ -0,0 +1,421 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlshred.c
+
+#include <string.h>
+#include "xmlshred.h"
+#include "xmlnum.h"
+
+
+// allocate size bytes aligned to 8 from arena
+static char* shred_alloc(char** arena, int* arena_size, int size)
+{
+    int pad = (int)(-(intptr_t)*arena & 7);
+    char* ptr;
+
+    if(size < 0 || pad + size > *arena_size) return 0;
+
+    ptr = *arena + pad;
+    *arena += pad + size;
+    *arena_size -= pad + size;
+
+    return ptr;
+}
+
+
+
+static unsigned shred_hash(const char* s, int len)
+{
+    unsigned h = 2166136261u;
+
+    while(len--) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+
+
+// returns id of string, string is added to dictionary if needed
+// returns -1 if dictionary is full
+static int32_t shred_intern(xml_shred_t* s, const char* str, int len)
+{
+    unsigned mask = s->dict_slots - 1;
+    unsigned i = shred_hash(str, len) & mask;
+    int id;
+
+    while((id = s->dict_table[i]) != 0)
+    {
+        const char* d = s->dict_chars + s->dict_offset[id - 1];
+
+        if(!memcmp(d, str, len) && !d[len]) return id - 1;
+        i = (i + 1) & mask;
+    }
+
+    if(s->dict_count == s->dict_size || len >= s->dict_bytes - s->dict_used) return -1;
+
+    id = s->dict_count++;
+    s->dict_offset[id] = s->dict_used;
+    memcpy(s->dict_chars + s->dict_used, str, len);
+    s->dict_chars[s->dict_used + len] = 0;
+    s->dict_used += len + 1;
+    s->dict_table[i] = id + 1;
+
+    return id;
+}
+
+
+
+// convert value and store it to current row of column c
+static void shred_value(xml_shred_t* s, xml_parser_t* p, xml_column_t* c, const char* str, int len)
+{
+    int row = s->rows;
+    int32_t id;
+
+    switch(c->type)
+    {
+    case XML_COLUMN_INT64:
+        c->valid[row] = xml_attr_to_int64(str, len, c->ints + row) == XML_ERROR_NONE;
+        break;
+
+    case XML_COLUMN_DOUBLE:
+        c->valid[row] = xml_attr_to_double(str, len, c->reals + row) == XML_ERROR_NONE;
+        break;
+
+    case XML_COLUMN_STRING:
+        id = shred_intern(s, str, len);
+        c->ids[row] = id;
+        c->valid[row] = id >= 0;
+
+        if(id < 0 && !s->dict_full)
+        {
+            s->dict_full = 1;
+            xml_set_error(p, XML_ERROR_NO_MEMORY, "No enough memory in string dictionary");
+        }
+        break;
+    }
+}
+
+
+
+// rel is element path relative to record, "" for record element itself
+static void shred_element(xml_shred_t* s, xml_parser_t* p, const char* rel, int rel_len)
+{
+    char* attr_string = p->attr;
+    xml_attr_t a;
+    int i;
+
+    for(i = 0; i < s->column_count; i++)
+    {
+        xml_column_t* c = s->columns + i;
+
+        if(!c->attr && c->elem_len == rel_len && !memcmp(c->path, rel, rel_len))
+        {
+            s->text_column[p->level] = i;
+            break;
+        }
+    }
+
+    while(attr_string && xml_next_attr(&attr_string, &a))
+    {
+        for(i = 0; i < s->column_count; i++)
+        {
+            xml_column_t* c = s->columns + i;
+
+            if(c->attr && c->elem_len == rel_len && !memcmp(c->path, rel, rel_len) &&
+               !strncmp(c->attr, a.name, a.name_len) && !c->attr[a.name_len])
+            {
+                shred_value(s, p, c, a.value, a.value_len);
+            }
+        }
+    }
+}
+
+
+
+static void shred_start_element(xml_parser_t* p)
+{
+    xml_shred_t* s = p->user_ptr;
+    int len = (int)strlen(p->tag);
+    int start, i;
+
+    if(p->level >= XML_SHRED_LEVELS) return;
+
+    // text of element follows text of its ancestors
+    s->text_column[p->level] = -1;
+    s->text_start[p->level] = s->text_len;
+
+    // append element name to path
+    start = s->path_len[p->level - 1];
+    if(start + len + 2 > XML_SHRED_PATH)
+    {
+        s->path_len[p->level] = start;
+        return;
+    }
+    if(start) s->path[start++] = '/';
+    memcpy(s->path + start, p->tag, len + 1);
+    s->path_len[p->level] = start + len;
+
+    if(!s->record_level)
+    {
+        if(s->path_len[p->level] != s->record_path_len || memcmp(s->path, s->record_path, s->record_path_len)) return;
+
+        // new row, all fields are missing until they are found
+        s->record_level = p->level;
+        for(i = 0; i < s->column_count; i++) s->columns[i].valid[s->rows] = 0;
+
+        shred_element(s, p, "", 0);
+    }
+    else
+    {
+        start = s->record_path_len + 1;
+        shred_element(s, p, s->path + start, s->path_len[p->level] - start);
+    }
+}
+
+
+
+static void shred_end_element(xml_parser_t* p)
+{
+    xml_shred_t* s = p->user_ptr;
+    int level = p->level + 1;
+
+    if(level >= XML_SHRED_LEVELS) return;
+
+    if(s->text_column[level] >= 0)
+    {
+        shred_value(s, p, s->columns + s->text_column[level], s->text + s->text_start[level],
+                    s->text_len - s->text_start[level]);
+        s->text_column[level] = -1;
+    }
+    s->text_len = s->text_start[level];
+
+    if(s->record_level == level)
+    {
+        s->record_level = 0;
+        if(++s->rows == s->batch_rows)
+        {
+            if(s->batch_handler) s->batch_handler(s);
+            s->total_rows += s->rows;
+            s->rows = 0;
+        }
+    }
+
+    s->path[s->path_len[level - 1]] = 0;
+}
+
+
+
+// returns 1 if text of current element is collected
+static int shred_collects(xml_shred_t* s, xml_parser_t* p)
+{
+    return p->level > 0 && p->level < XML_SHRED_LEVELS && s->text_column[p->level] >= 0;
+}
+
+
+
+// text split by comments or CDATA is joined, too long text is invalid value
+// text of open elements is collected as stack, text of child is dropped from
+// text when child ends, so parent text continues after it
+static void shred_text(xml_parser_t* p, const char* text)
+{
+    xml_shred_t* s = p->user_ptr;
+    int len;
+
+    if(!shred_collects(s, p)) return;
+
+    len = (int)strlen(text);
+    if(len > XML_SHRED_TEXT - s->text_len)
+    {
+        s->columns[s->text_column[p->level]].valid[s->rows] = 0;
+        s->text_column[p->level] = -1;
+        return;
+    }
+
+    memcpy(s->text + s->text_len, text, len);
+    s->text_len += len;
+}
+
+
+
+// parser text is raw, references are decoded in place
+static void shred_characters(xml_parser_t* p)
+{
+    xml_shred_t* s = p->user_ptr;
+
+    if(shred_collects(s, p)) xml_text_decode(p->chars, (int)strlen(p->chars));
+    shred_text(p, p->chars);
+}
+
+
+
+static void shred_cdata(xml_parser_t* p)
+{
+    shred_text(p, p->cdata);
+}
+
+
+
+int xml_shred_init(xml_shred_t* s, const char* record_path, xml_column_t* columns, int column_count,
+                   int batch_rows, int dict_size, char* arena, int arena_size)
+{
+    int i, slots;
+
+    s->user_ptr = 0;
+    s->record_path = record_path;
+    s->record_path_len = (int)strlen(record_path);
+    s->columns = columns;
+    s->column_count = column_count;
+    s->batch_rows = batch_rows;
+    s->rows = 0;
+    s->total_rows = 0;
+    s->record_level = 0;
+    s->text_len = 0;
+    s->dict_count = 0;
+    s->dict_size = dict_size;
+    s->dict_used = 0;
+    s->dict_full = 0;
+    s->batch_handler = 0;
+    s->path[0] = 0;
+    s->path_len[0] = 0;
+    s->text_column[0] = -1;
+    s->text_start[0] = 0;
+
+    if(batch_rows <= 0 || dict_size < 0 || dict_size > (1 << 28)) return XML_ERROR_ARG;
+
+    for(i = 0; i < column_count; i++)
+    {
+        xml_column_t* c = columns + i;
+        const char* at = strchr(c->path, '@');
+        int size = c->type == XML_COLUMN_STRING ? (int)sizeof(int32_t) : 8;
+
+        // element part of path without '/' before attribute
+        c->attr = at ? at + 1 : 0;
+        c->elem_len = at ? (int)(at - c->path) : (int)strlen(c->path);
+        if(at && c->elem_len) c->elem_len--;
+
+        c->ints = (int64_t*)shred_alloc(&arena, &arena_size, batch_rows * size);
+        c->valid = (unsigned char*)shred_alloc(&arena, &arena_size, batch_rows);
+        if(!c->ints || !c->valid) return XML_ERROR_NO_MEMORY;
+    }
+
+    // hash table is at most half full
+    for(slots = 2; slots < 2 * dict_size; slots *= 2);
+
+    s->dict_slots = slots;
+    s->dict_table = (int*)shred_alloc(&arena, &arena_size, slots * (int)sizeof(int));
+    s->dict_offset = (int*)shred_alloc(&arena, &arena_size, dict_size * (int)sizeof(int));
+    if(!s->dict_table || !s->dict_offset) return XML_ERROR_NO_MEMORY;
+
+    memset(s->dict_table, 0, slots * sizeof(int));
+    s->dict_chars = arena;
+    s->dict_bytes = arena_size;
+
+    return XML_ERROR_NONE;
+}
+
+
+
+void xml_shred_attach(xml_shred_t* s, xml_parser_t* p)
+{
+    p->user_ptr = s;
+    xml_set_handler(p, shred_start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, shred_end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, shred_characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, shred_cdata, XML_CDATA_HANDLER);
+}
+
+
+
+void xml_shred_finish(xml_shred_t* s)
+{
+    if(s->rows)
+    {
+        if(s->batch_handler) s->batch_handler(s);
+        s->total_rows += s->rows;
+        s->rows = 0;
+    }
+}
+
+
+
+const char* xml_shred_string(const xml_shred_t* s, int32_t id)
+{
+    if(id < 0 || id >= s->dict_count) return 0;
+    return s->dict_chars + s->dict_offset[id];
+}
+
+
+
+// fields with separator, quote or line break are quoted
+static void shred_csv_string(FILE* f, const char* str)
+{
+    if(!str[strcspn(str, ",\"\r\n")])
+    {
+        fputs(str, f);
+        return;
+    }
+
+    fputc('"', f);
+    for(; *str; str++)
+    {
+        if(*str == '"') fputc('"', f);
+        fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+
+
+int xml_shred_write_csv(const xml_shred_t* s, FILE* f, int header)
+{
+    int row, i;
+
+    if(header)
+    {
+        for(i = 0; i < s->column_count; i++)
+        {
+            if(i) fputc(',', f);
+            shred_csv_string(f, s->columns[i].path);
+        }
+        fputc('\n', f);
+    }
+
+    for(row = 0; row < s->rows; row++)
+    {
+        for(i = 0; i < s->column_count; i++)
+        {
+            const xml_column_t* c = s->columns + i;
+
+            if(i) fputc(',', f);
+            if(!c->valid[row]) continue;
+
+            if(c->type == XML_COLUMN_INT64) fprintf(f, "%lld", (long long)c->ints[row]);
+            else if(c->type == XML_COLUMN_DOUBLE) fprintf(f, "%.17g", c->reals[row]);
+            else shred_csv_string(f, xml_shred_string(s, c->ids[row]));
+        }
+        fputc('\n', f);
+    }
+
+    return ferror(f) ? XML_ERROR_ARG : XML_ERROR_NONE;
+}
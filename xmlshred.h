@@ -0,0 +1,146 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlshred.h
+// columnar shredding of repeated records: values of record fields are
+// written to typed column arrays, handler is called once per batch of rows
+//
+// record path is absolute element path, field paths are relative to record:
+//     "Profile/Tools/Tool"     record path
+//     "@Timeout"               attribute of record element
+//     "Description"            text of child element
+//     "Info/@Id"               attribute of child element
+//     ""                       text of record element
+//
+//     static xml_column_t columns[] =
+//     {
+//         { "@Filename", XML_COLUMN_STRING },
+//         { "@Timeout", XML_COLUMN_INT64 },
+//     };
+//
+//     xml_shred_init(&s, "Profile/Tools/Tool", columns, 2, 1024, 4096, arena, sizeof(arena));
+//     s.batch_handler = process_batch;     // columns[1].ints[0..s.rows-1] are timeouts
+//
+// strings are dictionary encoded, ids index one dictionary shared by all
+// string columns and stay valid for all batches
+// missing fields and values that can not be converted are marked invalid
+
+#ifndef __XMLSHRED_H__
+#define __XMLSHRED_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max length of element path and max element level that is tracked
+#define XML_SHRED_PATH      256
+#define XML_SHRED_LEVELS    64
+
+// max length of text values of open elements together
+#define XML_SHRED_TEXT      256
+
+// column types
+enum
+{
+    XML_COLUMN_INT64 = 1,   // ints
+    XML_COLUMN_DOUBLE,      // reals
+    XML_COLUMN_STRING,      // ids of strings in dictionary
+};
+
+typedef struct xml_column_s xml_column_t;
+typedef struct xml_shred_s xml_shred_t;
+
+struct xml_column_s
+{
+    const char* path;
+    int type;
+    union
+    {
+        int64_t* ints;
+        double* reals;
+        int32_t* ids;
+    };
+    unsigned char* valid;   // 1 if row has value
+    int elem_len;           // length of element part of path
+    const char* attr;       // attribute name or 0 for element text
+};
+
+struct xml_shred_s
+{
+    void* user_ptr;
+    const char* record_path;
+    int record_path_len;
+    xml_column_t* columns;
+    int column_count;
+    int batch_rows;
+    int rows;               // rows in current batch
+    int64_t total_rows;     // rows in all finished batches
+    int record_level;       // level of current record element or 0
+    int text_len;           // collected text of all open elements
+    int dict_count;
+    int dict_size;
+    int dict_slots;
+    int* dict_table;        // hash table of string ids + 1, 0 is empty slot
+    int* dict_offset;       // offset of zero terminated string in dict_chars
+    char* dict_chars;
+    int dict_used;
+    int dict_bytes;
+    int dict_full;
+    void (*batch_handler)(xml_shred_t* s);
+    char text[XML_SHRED_TEXT];
+    char path[XML_SHRED_PATH];
+    int path_len[XML_SHRED_LEVELS];
+    int text_column[XML_SHRED_LEVELS];  // column of element text being collected or -1
+    int text_start[XML_SHRED_LEVELS];   // start of element text in text
+};
+
+
+// column arrays of batch_rows values and string dictionary of up to dict_size
+// strings are allocated from arena, rest of arena is used for string chars
+// returns XML_ERROR_NONE or XML_ERROR_NO_MEMORY if arena is too small
+int xml_shred_init(xml_shred_t* s, const char* record_path, xml_column_t* columns, int column_count,
+                   int batch_rows, int dict_size, char* arena, int arena_size);
+
+// set handlers of p, p->user_ptr is set to s
+void xml_shred_attach(xml_shred_t* s, xml_parser_t* p);
+
+// call batch handler for last, partially filled batch
+void xml_shred_finish(xml_shred_t* s);
+
+// string of dictionary id
+const char* xml_shred_string(const xml_shred_t* s, int32_t id);
+
+// write rows of current batch as CSV, header line has field paths
+// returns XML_ERROR_NONE or XML_ERROR_ARG if write fails
+int xml_shred_write_csv(const xml_shred_t* s, FILE* f, int header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLSHRED_H__
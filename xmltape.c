@@ -0,0 +1,674 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmltape.c
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include "xmltape.h"
+
+/*
+    Tape format:
+    every event starts with opcode byte, followed by event data
+    Varint          LEB128 encoded unsigned int
+    String          Varint(length) bytes 0
+    Name            Varint(0) String | Varint(distance back to previous String with same name)
+
+    XML_TAPE_START_ELEMENT      Name(tag) String(attributes)
+    XML_TAPE_END_ELEMENT        Name(tag)
+    XML_TAPE_EMPTY_END_ELEMENT  end of element started with previous XML_TAPE_START_ELEMENT
+    XML_TAPE_CHARACTERS         String
+    XML_TAPE_COMMENT            String
+    XML_TAPE_PI                 String
+    XML_TAPE_CDATA              String
+    XML_TAPE_ERROR              Varint(error code) String
+    XML_TAPE_END                end of tape
+
+    Strings are zero terminated so replay can pass pointers into tape to handlers.
+*/
+
+// cache file header, stored in native byte order (cache is local to machine)
+// header is followed by source path, path_len bytes, and by tape
+#define XML_TAPE_MAGIC      0x50415458  // "XTAP"
+#define XML_TAPE_VERSION    3
+
+struct xml_tape_header_s
+{
+    uint32_t magic;
+    uint32_t version;
+    int64_t src_mtime;
+    int64_t src_size;
+    uint32_t tape_size;
+    uint32_t checksum;
+    uint32_t path_len;
+    int32_t options;
+    int32_t max_depth;
+    int32_t max_attrs;
+    int32_t max_name;
+    uint32_t reserved;
+};
+
+
+
+static uint32_t tape_hash(const char* s, int len)
+{
+    uint32_t h = 2166136261u;
+    while(len--) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+
+
+// make room for n more bytes on tape
+// returns 1 if there is no more memory, 0 otherwise
+static int tape_reserve(xml_tape_t* t, int n)
+{
+    if(t->overflow) return 1;
+
+    if(t->size + n > t->capacity)
+    {
+        int capacity = t->capacity ? t->capacity : 4096;
+        char* buf;
+
+        if(!t->growable)
+        {
+            t->overflow = 1;
+            return 1;
+        }
+
+        while(capacity < t->size + n) capacity *= 2;
+        buf = realloc(t->buf, capacity);
+        if(!buf)
+        {
+            t->overflow = 1;
+            return 1;
+        }
+
+        t->buf = buf;
+        t->capacity = capacity;
+    }
+
+    return 0;
+}
+
+
+
+static void tape_put_byte(xml_tape_t* t, int c)
+{
+    if(tape_reserve(t, 1)) return;
+    t->buf[t->size++] = (char)c;
+}
+
+
+
+static void tape_put_varint(xml_tape_t* t, unsigned int v)
+{
+    if(tape_reserve(t, 5)) return;
+
+    while(v >= 0x80)
+    {
+        t->buf[t->size++] = (char)(v | 0x80);
+        v >>= 7;
+    }
+    t->buf[t->size++] = (char)v;
+}
+
+
+
+// returns tape offset of string bytes
+static int tape_put_string(xml_tape_t* t, const char* s)
+{
+    int len = (int)strlen(s);
+    int offset;
+
+    tape_put_varint(t, len);
+    if(tape_reserve(t, len + 1)) return 0;
+
+    offset = t->size;
+    memcpy(t->buf + offset, s, len + 1);
+    t->size += len + 1;
+
+    return offset;
+}
+
+
+
+// names are interned, only first occurrence of every name is stored
+static void tape_put_name(xml_tape_t* t, const char* s)
+{
+    int len = (int)strlen(s);
+    int slot = tape_hash(s, len) % XML_TAPE_NAMES;
+    int i, offset;
+
+    for(i = 0; i < XML_TAPE_NAMES; i++)
+    {
+        offset = t->names[slot];
+        if(!offset) break;
+
+        if(!strcmp(t->buf + offset, s))
+        {
+            tape_put_varint(t, t->size - offset);
+            return;
+        }
+
+        slot = (slot + 1) % XML_TAPE_NAMES;
+    }
+
+    tape_put_varint(t, 0);
+    offset = tape_put_string(t, s);
+
+    // if interning table is full name is just stored inline
+    if(i < XML_TAPE_NAMES && !t->overflow) t->names[slot] = offset;
+}
+
+
+
+// recording handlers, p->user_ptr points to tape while recording
+
+static void tape_error(xml_parser_t* p)
+{
+    xml_tape_t* t = p->user_ptr;
+    tape_put_byte(t, XML_TAPE_ERROR);
+    tape_put_varint(t, p->errorcode);
+    tape_put_string(t, p->errorstr);
+}
+
+#ifndef XML_NO_COMMENTS
+static void tape_comment(xml_parser_t* p)
+{
+    xml_tape_t* t = p->user_ptr;
+    tape_put_byte(t, XML_TAPE_COMMENT);
+    tape_put_string(t, p->comment);
+}
+#endif
+
+#ifndef XML_NO_PI
+static void tape_pi(xml_parser_t* p)
+{
+    xml_tape_t* t = p->user_ptr;
+    tape_put_byte(t, XML_TAPE_PI);
+    tape_put_string(t, p->pi);
+}
+#endif
+
+#ifndef XML_NO_CDATA
+static void tape_cdata(xml_parser_t* p)
+{
+    xml_tape_t* t = p->user_ptr;
+    tape_put_byte(t, XML_TAPE_CDATA);
+    tape_put_string(t, p->cdata);
+}
+#endif
+
+static void tape_start_element(xml_parser_t* p)
+{
+    xml_tape_t* t = p->user_ptr;
+    tape_put_byte(t, XML_TAPE_START_ELEMENT);
+    tape_put_name(t, p->tag);
+    tape_put_string(t, p->attr);
+}
+
+static void tape_end_element(xml_parser_t* p)
+{
+    xml_tape_t* t = p->user_ptr;
+
+    // empty element tag leaves p->attr set, end tag clears it
+    if(p->attr) tape_put_byte(t, XML_TAPE_EMPTY_END_ELEMENT);
+    else
+    {
+        tape_put_byte(t, XML_TAPE_END_ELEMENT);
+        tape_put_name(t, p->tag);
+    }
+}
+
+static void tape_characters(xml_parser_t* p)
+{
+    xml_tape_t* t = p->user_ptr;
+    tape_put_byte(t, XML_TAPE_CHARACTERS);
+    tape_put_string(t, p->chars);
+}
+
+
+
+void xml_tape_init(xml_tape_t* t, char* buf, int size)
+{
+    t->buf = buf;
+    t->capacity = buf ? size : 0;
+    t->growable = buf ? 0 : 1;
+    xml_tape_clear(t);
+}
+
+
+
+void xml_tape_free(xml_tape_t* t)
+{
+    if(t->growable) free(t->buf);
+    t->buf = 0;
+    t->capacity = 0;
+    xml_tape_clear(t);
+}
+
+
+
+void xml_tape_clear(xml_tape_t* t)
+{
+    t->size = 0;
+    t->overflow = 0;
+    t->options = 0;
+    t->max_depth = 0;
+    t->max_attrs = 0;
+    t->max_name = 0;
+    memset(t->names, 0, sizeof(t->names));
+}
+
+
+
+int xml_tape_record(xml_tape_t* t, xml_parser_t* p, char* string)
+{
+    xml_parser_t saved = *p;
+
+    p->user_ptr = t;
+    p->error_handler = tape_error;
+#ifndef XML_NO_COMMENTS
+    p->comment_handler = tape_comment;
+#endif
+#ifndef XML_NO_PI
+    p->pi_handler = tape_pi;
+    p->include_handler = 0;
+#endif
+#ifndef XML_NO_CDATA
+    p->cdata_handler = tape_cdata;
+#endif
+    p->start_element_handler = tape_start_element;
+    p->end_element_handler = tape_end_element;
+    p->characters_handler = tape_characters;
+
+    t->options = p->options;
+    t->max_depth = p->max_depth;
+    t->max_attrs = p->max_attrs;
+    t->max_name = p->max_name;
+
+    xml_parse_string(p, string);
+    tape_put_byte(t, XML_TAPE_END);
+
+    p->user_ptr = saved.user_ptr;
+    p->error_handler = saved.error_handler;
+#ifndef XML_NO_COMMENTS
+    p->comment_handler = saved.comment_handler;
+#endif
+#ifndef XML_NO_PI
+    p->pi_handler = saved.pi_handler;
+    p->include_handler = saved.include_handler;
+#endif
+#ifndef XML_NO_CDATA
+    p->cdata_handler = saved.cdata_handler;
+#endif
+    p->start_element_handler = saved.start_element_handler;
+    p->end_element_handler = saved.end_element_handler;
+    p->characters_handler = saved.characters_handler;
+
+    return t->overflow ? XML_ERROR_NO_MEMORY : XML_ERROR_NONE;
+}
+
+
+
+// replay helpers
+// return pointer past decoded item or 0 if tape is corrupted
+
+static const unsigned char* tape_get_varint(const unsigned char* ptr, const unsigned char* end, unsigned int* v)
+{
+    unsigned int shift = 0;
+
+    *v = 0;
+    while(ptr < end && shift < 32)
+    {
+        *v |= (unsigned int)(*ptr & 0x7f) << shift;
+        if(!(*ptr++ & 0x80)) return ptr;
+        shift += 7;
+    }
+
+    return 0;
+}
+
+static const unsigned char* tape_get_string(const unsigned char* ptr, const unsigned char* end, char** s)
+{
+    unsigned int len;
+
+    ptr = tape_get_varint(ptr, end, &len);
+    if(!ptr || len >= (unsigned int)(end - ptr) || ptr[len]) return 0;
+
+    *s = (char*)ptr;
+    return ptr + len + 1;
+}
+
+static const unsigned char* tape_get_name(const unsigned char* ptr, const unsigned char* start, const unsigned char* end, char** s)
+{
+    const unsigned char* name = ptr;
+    unsigned int distance;
+
+    ptr = tape_get_varint(ptr, end, &distance);
+    if(!ptr) return 0;
+    if(!distance) return tape_get_string(ptr, end, s);
+
+    if(distance > (unsigned int)(name - start)) return 0;
+    *s = (char*)(name - distance);
+    return ptr;
+}
+
+
+
+int xml_tape_compatible(const xml_tape_t* t, const xml_parser_t* p)
+{
+    return t->options == p->options && t->max_depth == p->max_depth &&
+        t->max_attrs == p->max_attrs && t->max_name == p->max_name;
+}
+
+
+
+// copy string from tape to parser pool after used bytes, so handlers get
+// writable memory as they do from parser and can decode text in place
+// returns 0 if pool is full
+static char* tape_to_pool(xml_parser_t* p, const char* s, int* used)
+{
+    int len = (int)strlen(s) + 1;
+    char* copy = p->_pool + *used;
+
+    if(len > p->_pool_size - *used) return 0;
+
+    memcpy(copy, s, len);
+    *used += len;
+    return copy;
+}
+
+
+
+int xml_tape_replay(xml_parser_t* p, const xml_tape_t* t)
+{
+    const unsigned char* start = (const unsigned char*)t->buf;
+    const unsigned char* end = start + t->size;
+    const unsigned char* ptr = start;
+    int level = p->level;
+    int used;
+    unsigned int code;
+    char* s;
+    char* attr;
+
+    while(ptr && ptr < end)
+    {
+        used = 0;
+
+        switch(*ptr++)
+        {
+            case XML_TAPE_END:
+                p->level = level;
+                return XML_ERROR_NONE;
+
+            case XML_TAPE_START_ELEMENT:
+                ptr = tape_get_name(ptr, start, end, &s);
+                if(ptr) ptr = tape_get_string(ptr, end, &attr);
+                if(!ptr) break;
+                p->tag = tape_to_pool(p, s, &used);
+                p->attr = tape_to_pool(p, attr, &used);
+                if(!p->tag || !p->attr) goto no_memory;
+                if(p->max_depth && p->level >= p->max_depth)
+                {
+                    xml_set_error(p, XML_ERROR_DEPTH, "Elements nested too deep");
+                    p->level = level;
+                    return XML_ERROR_DEPTH;
+                }
+                p->level++;
+                if(p->start_element_handler) p->start_element_handler(p);
+            break;
+
+            case XML_TAPE_END_ELEMENT:
+                ptr = tape_get_name(ptr, start, end, &s);
+                if(!ptr) break;
+                p->tag = tape_to_pool(p, s, &used);
+                if(!p->tag) goto no_memory;
+                p->attr = 0;
+                p->level--;
+                if(p->end_element_handler) p->end_element_handler(p);
+            break;
+
+            case XML_TAPE_EMPTY_END_ELEMENT:
+                p->level--;
+                if(p->end_element_handler) p->end_element_handler(p);
+            break;
+
+            case XML_TAPE_CHARACTERS:
+                ptr = tape_get_string(ptr, end, &s);
+                if(!ptr || !p->characters_handler) break;
+                if(!(p->chars = tape_to_pool(p, s, &used))) goto no_memory;
+                p->characters_handler(p);
+            break;
+
+            // events of disabled features are dropped
+            case XML_TAPE_COMMENT:
+                ptr = tape_get_string(ptr, end, &s);
+#ifndef XML_NO_COMMENTS
+                if(!ptr || !p->comment_handler) break;
+                if(!(p->comment = tape_to_pool(p, s, &used))) goto no_memory;
+                p->comment_handler(p);
+#endif
+            break;
+
+            case XML_TAPE_PI:
+                ptr = tape_get_string(ptr, end, &s);
+#ifndef XML_NO_PI
+                if(!ptr) break;
+                if(!(p->pi = tape_to_pool(p, s, &used))) goto no_memory;
+                xml_handle_pi(p);
+#endif
+            break;
+
+            case XML_TAPE_CDATA:
+                ptr = tape_get_string(ptr, end, &s);
+#ifndef XML_NO_CDATA
+                if(!ptr || !p->cdata_handler) break;
+                if(!(p->cdata = tape_to_pool(p, s, &used))) goto no_memory;
+                p->cdata_handler(p);
+#endif
+            break;
+
+            case XML_TAPE_ERROR:
+                ptr = tape_get_varint(ptr, end, &code);
+                if(ptr) ptr = tape_get_string(ptr, end, &p->errorstr);
+                if(ptr) xml_set_error(p, code, p->errorstr);
+            break;
+
+            default: ptr = 0;
+        }
+    }
+
+    p->level = level;
+
+    return ptr ? XML_ERROR_NONE : XML_ERROR_MALFORMED;
+
+no_memory:
+    xml_set_error(p, XML_ERROR_NO_MEMORY, "No enough memory in pool");
+    p->level = level;
+    return XML_ERROR_NO_MEMORY;
+}
+
+
+
+int xml_tape_save(const xml_tape_t* t, const char* cache_path, const char* src_path)
+{
+    struct xml_tape_header_s h;
+    struct stat st;
+    FILE* f;
+    int ok;
+
+    if(t->overflow || stat(src_path, &st)) return XML_ERROR_ARG;
+
+    h.magic = XML_TAPE_MAGIC;
+    h.version = XML_TAPE_VERSION;
+    h.src_mtime = (int64_t)st.st_mtime;
+    h.src_size = (int64_t)st.st_size;
+    h.tape_size = (uint32_t)t->size;
+    h.checksum = tape_hash(t->buf, t->size);
+    h.path_len = (uint32_t)strlen(src_path);
+    h.options = t->options;
+    h.max_depth = t->max_depth;
+    h.max_attrs = t->max_attrs;
+    h.max_name = t->max_name;
+    h.reserved = 0;
+
+    f = fopen(cache_path, "wb");
+    if(!f) return XML_ERROR_ARG;
+
+    ok = fwrite(&h, sizeof(h), 1, f) == 1 && (!h.path_len || fwrite(src_path, h.path_len, 1, f) == 1);
+    ok = ok && (!t->size || fwrite(t->buf, t->size, 1, f) == 1);
+    ok = !fclose(f) && ok;
+    if(!ok) remove(cache_path);
+
+    return ok ? XML_ERROR_NONE : XML_ERROR_NO_MEMORY;
+}
+
+
+
+int xml_tape_load(xml_tape_t* t, const char* cache_path, const char* src_path)
+{
+    struct xml_tape_header_s h;
+    struct stat st;
+    FILE* f;
+    int err = XML_ERROR_MALFORMED;
+    size_t path_len = strlen(src_path);
+    char* path;
+    int ok;
+
+    if(stat(src_path, &st)) return XML_ERROR_ARG;
+
+    f = fopen(cache_path, "rb");
+    if(!f) return XML_ERROR_ARG;
+
+    xml_tape_clear(t);
+
+    if(fread(&h, sizeof(h), 1, f) != 1) goto done;
+
+    // cache entry is stale if source file changed
+    if(h.magic != XML_TAPE_MAGIC || h.version != XML_TAPE_VERSION) goto done;
+    if(h.src_mtime != (int64_t)st.st_mtime || h.src_size != (int64_t)st.st_size) goto done;
+
+    // cache file names are path hashes, so entry can belong to other source
+    if(h.path_len != path_len) goto done;
+    err = XML_ERROR_NO_MEMORY;
+    path = malloc(path_len + 1);
+    if(!path) goto done;
+    err = XML_ERROR_MALFORMED;
+    ok = !path_len || (fread(path, path_len, 1, f) == 1 && !memcmp(path, src_path, path_len));
+    free(path);
+    if(!ok) goto done;
+
+    err = XML_ERROR_NO_MEMORY;
+    if(h.tape_size > 0x7fffffff || tape_reserve(t, (int)h.tape_size)) goto done;
+
+    err = XML_ERROR_MALFORMED;
+    if(h.tape_size && fread(t->buf, h.tape_size, 1, f) != 1) goto done;
+    if(tape_hash(t->buf, h.tape_size) != h.checksum) goto done;
+
+    t->size = (int)h.tape_size;
+    t->options = h.options;
+    t->max_depth = h.max_depth;
+    t->max_attrs = h.max_attrs;
+    t->max_name = h.max_name;
+    err = XML_ERROR_NONE;
+
+done:
+    fclose(f);
+    if(err) xml_tape_clear(t);
+    return err;
+}
+
+
+
+// read whole file to zero terminated buffer allocated with malloc
+static char* tape_read_file(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    char* buf = 0;
+    long len;
+
+    if(!f) return 0;
+
+    if(!fseek(f, 0, SEEK_END) && (len = ftell(f)) >= 0 && !fseek(f, 0, SEEK_SET))
+    {
+        buf = malloc(len + 1);
+        if(buf && fread(buf, 1, len, f) != (size_t)len)
+        {
+            free(buf);
+            buf = 0;
+        }
+        if(buf) buf[len] = 0;
+    }
+
+    fclose(f);
+    return buf;
+}
+
+
+
+int xml_tape_record_file(xml_tape_t* t, xml_parser_t* p, const char* path)
+{
+    char* src = tape_read_file(path);
+    int err;
+
+    if(!src) return XML_ERROR_ARG;
+
+    err = xml_tape_record(t, p, src);
+
+    free(src);
+    return err;
+}
+
+
+
+int xml_tape_cached(xml_tape_t* t, xml_parser_t* p, const char* src_path, const char* cache_dir)
+{
+    char* cache_path;
+    int err;
+
+    // cache file name is derived from source path hash
+    cache_path = malloc(strlen(cache_dir) + 24);
+    if(!cache_path) return XML_ERROR_NO_MEMORY;
+    sprintf(cache_path, "%s/%08lx.xtape", cache_dir, (unsigned long)tape_hash(src_path, (int)strlen(src_path)));
+
+    err = xml_tape_load(t, cache_path, src_path);
+    if(err == XML_ERROR_NONE && !xml_tape_compatible(t, p)) err = XML_ERROR_MALFORMED;
+    if(err == XML_ERROR_NONE || err == XML_ERROR_NO_MEMORY)
+    {
+        free(cache_path);
+        return err;
+    }
+
+    xml_tape_clear(t);
+    err = xml_tape_record_file(t, p, src_path);
+    if(err == XML_ERROR_NONE) xml_tape_save(t, cache_path, src_path);
+
+    free(cache_path);
+    return err;
+}
@@ -0,0 +1,119 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmltape.h
+// binary event tape: records parser events once and replays them later
+// without tokenizing the xml text again
+
+#ifndef __XMLTAPE_H__
+#define __XMLTAPE_H__
+
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// number of slots in name interning table used while recording
+#define XML_TAPE_NAMES 256
+
+typedef struct xml_tape_s xml_tape_t;
+
+struct xml_tape_s
+{
+    char* buf;
+    int size;
+    int capacity;
+    int growable;
+    int overflow;
+    int options;        // options and limits of parser tape was recorded with
+    int max_depth;
+    int max_attrs;
+    int max_name;
+    int names[XML_TAPE_NAMES];
+};
+
+
+// tape opcodes, first byte of every recorded event
+enum
+{
+    XML_TAPE_END = 0,
+    XML_TAPE_ERROR,
+    XML_TAPE_COMMENT,
+    XML_TAPE_START_ELEMENT,
+    XML_TAPE_END_ELEMENT,
+    XML_TAPE_EMPTY_END_ELEMENT,
+    XML_TAPE_CHARACTERS,
+    XML_TAPE_PI,
+    XML_TAPE_CDATA,
+};
+
+
+// if buf is 0 tape memory is allocated with malloc and grows as needed
+void xml_tape_init(xml_tape_t* t, char* buf, int size);
+
+void xml_tape_free(xml_tape_t* t);
+
+void xml_tape_clear(xml_tape_t* t);
+
+// parse string with p and record all events to tape
+// events are recorded as p delivers them, so options and limits of p apply,
+// with XML_OPTION_LAZY_ATTRS attributes are recorded undecoded
+// handlers and user_ptr of p are restored before return
+// returns XML_ERROR_NONE or XML_ERROR_NO_MEMORY if tape is full
+int xml_tape_record(xml_tape_t* t, xml_parser_t* p, char* string);
+
+// same as xml_tape_record for content of file path
+// returns XML_ERROR_ARG if file can not be read
+int xml_tape_record_file(xml_tape_t* t, xml_parser_t* p, const char* path);
+
+// returns 1 if tape was recorded with the same options and limits as p has
+int xml_tape_compatible(const xml_tape_t* t, const xml_parser_t* p);
+
+// call handlers of p for every event on tape
+// levels continue from p->level and are checked against depth limit of p
+// strings passed to handlers are copied to pool of p, so handlers can modify
+// them as they can modify strings from parser
+// returns XML_ERROR_NONE, XML_ERROR_MALFORMED if tape is corrupted,
+// XML_ERROR_NO_MEMORY if string does not fit in pool or XML_ERROR_DEPTH if
+// elements are nested too deep; last two are also reported to error handler
+int xml_tape_replay(xml_parser_t* p, const xml_tape_t* t);
+
+// write tape to cache file, src_path is xml file tape was recorded from
+int xml_tape_save(const xml_tape_t* t, const char* cache_path, const char* src_path);
+
+// load tape from cache file if it is still valid for src_path
+// returns XML_ERROR_NONE on success
+int xml_tape_load(xml_tape_t* t, const char* cache_path, const char* src_path);
+
+// load tape for src_path from cache_dir, or parse src_path with p,
+// record it and store it to cache_dir; cached tape recorded with other
+// options or limits than p has is recorded again
+int xml_tape_cached(xml_tape_t* t, xml_parser_t* p, const char* src_path, const char* cache_dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLTAPE_H__
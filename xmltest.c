@@ -0,0 +1,498 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmltest.c
+// regression tests of modules, prints failed checks and number of failures
+//
+//     gcc -O2 -DXML_HAVE_THREADS xmltest.c xmlparser.c xmlhash.c xmlc14n.c xmldiff.c xmltape.c xmlinclude.c xmljson.c xmlshred.c xmlnum.c xmlbind.c xmlpipe.c xmlwriter.c xmlzip.c -o xmltest -lpthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xmlparser.h"
+#include "xmlc14n.h"
+#include "xmldiff.h"
+#include "xmlinclude.h"
+#include "xmljson.h"
+#include "xmlshred.h"
+#include "xmlbind.h"
+#include "xmlpipe.h"
+#include "xmlzip.h"
+
+
+static int failures;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(int ok, const char* cond, const char* file, int line)
+{
+    if(ok) return;
+
+    printf("%s:%d: check failed: %s\n", file, line, cond);
+    failures++;
+}
+
+
+
+// canonical bytes of records are collected to zero terminated string
+static char c14n_out[1024];
+static int c14n_len;
+
+static void c14n_collect(xml_c14n_t* c, const char* data, int len)
+{
+    (void)c;
+    if(c14n_len + len < (int)sizeof(c14n_out))
+    {
+        memcpy(c14n_out + c14n_len, data, len);
+        c14n_len += len;
+        c14n_out[c14n_len] = 0;
+    }
+}
+
+
+
+// canonicalize copy of doc, returns parser error code
+static int c14n_doc(const char* doc, long long* count)
+{
+    static char pool[1024];
+    char buf[256];
+    xml_parser_t p;
+    xml_c14n_t c;
+
+    strcpy(buf, doc);
+    c14n_len = 0;
+    c14n_out[0] = 0;
+
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_c14n_init(&c, 0);
+    c.write_handler = c14n_collect;
+    xml_c14n_attach(&c, &p);
+    xml_parse_string(&p, buf);
+
+    *count = c.count;
+    return p.errorcode;
+}
+
+
+
+// lazy attribute strings are checked by c14n
+static void test_c14n_attrs(void)
+{
+    long long count;
+
+    CHECK(c14n_doc("<a b='1' a=\"&#65;\"/>", &count) == XML_ERROR_NONE);
+    CHECK(!strcmp(c14n_out, "<a a=\"A\" b=\"1\"></a>") && count == 1);
+
+    // spaces around '=' and junk between attributes
+    CHECK(c14n_doc("<a a = \"A\" b='1'/>", &count) == XML_ERROR_MALFORMED);
+    CHECK(count == 0);
+    CHECK(c14n_doc("<a x=\"1\" junk y=\"2\"/>", &count) == XML_ERROR_MALFORMED);
+    CHECK(count == 0);
+}
+
+
+
+// diff must not report no changes for documents it could not parse
+static void test_diff_malformed(void)
+{
+    char a[] = "<P><T a = '1'/></P>";
+    char b[] = "<P><T a = '2'/></P>";
+    xml_diff_t d;
+
+    xml_diff_init(&d);
+    CHECK(xml_diff_buffers(&d, a, strlen(a), b, strlen(b)) == XML_ERROR_MALFORMED);
+}
+
+
+
+static int write_file(const char* path, const char* text)
+{
+    FILE* f = fopen(path, "wb");
+
+    if(!f) return 0;
+    fputs(text, f);
+    return !fclose(f);
+}
+
+
+
+// handlers decode replayed text in place, cached tape must stay unchanged
+static void test_include_twice(void)
+{
+    static char pool[1024];
+    static char inc_pool[1024];
+    char doc[] = "<r><?include xmltest_frag.xml?><?include xmltest_frag.xml?></r>";
+    xml_include_t inc;
+    xml_parser_t p;
+    xml_json_t j;
+
+    CHECK(write_file("xmltest_frag.xml", "<t>x &amp;lt; y</t>"));
+
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_include_init(&inc, inc_pool, sizeof(inc_pool));
+    xml_json_init(&j, 0, 0, 0);
+    xml_json_attach(&j, &p);
+    xml_include_attach(&inc, &p);
+    xml_parse_string(&p, doc);
+
+    CHECK(xml_json_finish(&j) == XML_ERROR_NONE);
+    CHECK(j.size > 0 && !strncmp(j.buf, "{\"r\":{\"t\":[\"x &lt; y\",\"x &lt; y\"]}}", j.size - 1));
+
+    xml_json_free(&j);
+    xml_include_free(&inc);
+    remove("xmltest_frag.xml");
+}
+
+
+
+static int max_level;
+static char lazy_attr[32];
+
+static void include_start(xml_parser_t* p)
+{
+    if(p->level > max_level) max_level = p->level;
+    if(!strcmp(p->tag, "t")) strcpy(lazy_attr, p->attr);
+}
+
+
+
+// included content gets options and limits of including parser
+static void test_include_limits(void)
+{
+    static char pool[1024];
+    static char inc_pool[1024];
+    char doc[] = "<r><?include xmltest_frag.xml?></r>";
+    char deep[2048] = "";
+    xml_include_t inc;
+    xml_parser_t p;
+    int i;
+
+    for(i = 0; i < 200; i++) strcat(deep, "<d>");
+    for(i = 0; i < 200; i++) strcat(deep, "</d>");
+    CHECK(write_file("xmltest_frag.xml", deep));
+
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_set_limit(&p, XML_LIMIT_DEPTH, 10);
+    xml_set_handler(&p, include_start, XML_START_ELEMENT_HANDLER);
+    xml_include_init(&inc, inc_pool, sizeof(inc_pool));
+    xml_include_attach(&inc, &p);
+    max_level = 0;
+    xml_parse_string(&p, doc);
+
+    CHECK(p.errorcode == XML_ERROR_DEPTH);
+    CHECK(max_level <= 10);
+
+    // lazy attributes are passed undecoded, tape recorded without
+    // XML_OPTION_LAZY_ATTRS is not reused
+    CHECK(write_file("xmltest_frag.xml", "<t a=\"&amp;\"/>"));
+    strcpy(doc, "<r><?include xmltest_frag.xml?></r>");
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_set_handler(&p, include_start, XML_START_ELEMENT_HANDLER);
+    xml_include_attach(&inc, &p);
+    xml_parse_string(&p, doc);
+    CHECK(p.errorcode == XML_ERROR_NONE && !strcmp(lazy_attr, "a=\"&\""));
+
+    strcpy(doc, "<r><?include xmltest_frag.xml?></r>");
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_set_option(&p, XML_OPTION_LAZY_ATTRS, 1);
+    xml_set_handler(&p, include_start, XML_START_ELEMENT_HANDLER);
+    xml_include_attach(&inc, &p);
+    xml_parse_string(&p, doc);
+    CHECK(p.errorcode == XML_ERROR_NONE && !strcmp(lazy_attr, "a=\"&amp;\""));
+
+    xml_include_free(&inc);
+    remove("xmltest_frag.xml");
+}
+
+
+
+// record text column stays open while child text column is collected
+static void test_shred_nested_text(void)
+{
+    static char pool[1024];
+    static char arena[4096];
+    char doc[] = "<recs><rec>tx<name>a &amp; b</name>t<!-- c -->y</rec></recs>";
+    xml_column_t columns[] =
+    {
+        { "", XML_COLUMN_STRING },
+        { "name", XML_COLUMN_STRING },
+    };
+    xml_shred_t s;
+    xml_parser_t p;
+
+    CHECK(xml_shred_init(&s, "recs/rec", columns, 2, 16, 16, arena, sizeof(arena)) == XML_ERROR_NONE);
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_shred_attach(&s, &p);
+    xml_parse_string(&p, doc);
+
+    CHECK(p.errorcode == XML_ERROR_NONE && s.rows == 1);
+    CHECK(columns[0].valid[0] && !strcmp(xml_shred_string(&s, columns[0].ids[0]), "txty"));
+    CHECK(columns[1].valid[0] && !strcmp(xml_shred_string(&s, columns[1].ids[0]), "a & b"));
+}
+
+
+
+typedef struct
+{
+    char name[16];
+    char text[16];
+    int count;
+} bind_item_t;
+
+static const xml_bind_t bind_item_table[] =
+{
+    XML_BIND_FIELD("i/@name", XML_BIND_STRING, bind_item_t, name),
+    XML_BIND_FIELD("i/@count", XML_BIND_INT, bind_item_t, count),
+    XML_BIND_FIELD("i", XML_BIND_STRING, bind_item_t, text),
+    XML_BIND_END
+};
+
+// bound text and lazy attributes are decoded
+static void test_bind_decode(void)
+{
+    static char pool[1024];
+    int lazy;
+
+    for(lazy = 0; lazy < 2; lazy++)
+    {
+        char doc[] = "<i name=\"a &amp; &#66;\" count=\"&#49;2\">x &lt; <![CDATA[&amp;]]>&#65;</i>";
+        bind_item_t item;
+        xml_binder_t b;
+        xml_parser_t p;
+
+        memset(&item, 0, sizeof(item));
+        xml_init(&p, pool, sizeof(pool));
+        p.errorcode = XML_ERROR_NONE;
+        xml_set_option(&p, XML_OPTION_LAZY_ATTRS, lazy);
+        xml_bind_init(&b, bind_item_table, &item, 0, 0);
+        xml_bind_attach(&b, &p);
+        xml_parse_string(&p, doc);
+
+        CHECK(p.errorcode == XML_ERROR_NONE);
+        CHECK(!strcmp(item.name, "a & B") && item.count == 12);
+        CHECK(!strcmp(item.text, "x < &amp;A"));
+    }
+}
+
+
+
+typedef struct
+{
+    int v;
+} bind_value_t;
+
+typedef struct
+{
+    bind_value_t* a;
+    int a_count;
+    bind_value_t* b;
+    int b_count;
+} bind_lists_t;
+
+static const xml_bind_t bind_value_table[] =
+{
+    XML_BIND_FIELD("@v", XML_BIND_INT, bind_value_t, v),
+    XML_BIND_END
+};
+
+static const xml_bind_t bind_lists_table[] =
+{
+    XML_BIND_ARRAY("r/a", bind_lists_t, a, a_count, bind_value_t, bind_value_table),
+    XML_BIND_ARRAY("r/b", bind_lists_t, b, b_count, bind_value_t, bind_value_table),
+    XML_BIND_END
+};
+
+// arrays filled alternately use linear arena space
+static void test_bind_arrays(void)
+{
+    static char pool[1024];
+    static char arena[64 * 1024];
+    static char doc[64 * 1024];
+    bind_lists_t lists;
+    xml_binder_t b;
+    xml_parser_t p;
+    int i, ok = 1;
+
+    strcpy(doc, "<r>");
+    for(i = 0; i < 2000; i++) sprintf(doc + strlen(doc), "<a v=\"%d\"/><b v=\"%d\"/>", i, -i);
+    strcat(doc, "</r>");
+
+    memset(&lists, 0, sizeof(lists));
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_bind_init(&b, bind_lists_table, &lists, arena, sizeof(arena));
+    xml_bind_attach(&b, &p);
+    xml_parse_string(&p, doc);
+
+    CHECK(p.errorcode == XML_ERROR_NONE);
+    CHECK(lists.a_count == 2000 && lists.b_count == 2000);
+    for(i = 0; i < lists.a_count && i < lists.b_count; i++) ok &= lists.a[i].v == i && lists.b[i].v == -i;
+    CHECK(ok);
+}
+
+
+
+static void (*pipe_end)(xml_parser_t* p);
+static char end_tags[64];
+
+static void record_end_tag(xml_parser_t* p)
+{
+    strcat(end_tags, p->tag);
+    strcat(end_tags, " ");
+    pipe_end(p);
+}
+
+
+
+// element with too many attributes is dropped and keeps its name
+static void test_pipe_attrs(void)
+{
+    static char pool[1024];
+    char doc[] = "<r><a x=\"1\" y=\"2\"/><b x=\"1\"/></r>";
+    const char* expected = "<r><b x=\"1\"/></r>";
+    xml_attr_t attrs[1];
+    xml_writer_t w;
+    xml_pipe_t pipe;
+    xml_parser_t p;
+
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    xml_writer_init(&w, 0, 0, 0);
+    xml_pipe_init(&pipe, &w, attrs, 1);
+    xml_pipe_attach(&pipe, &p);
+    pipe_end = p.end_element_handler;
+    p.end_element_handler = record_end_tag;
+    end_tags[0] = 0;
+    xml_parse_string(&p, doc);
+
+    CHECK(p.errorcode == XML_ERROR_ATTRS);
+    CHECK(!strcmp(end_tags, "a b r "));
+    CHECK(w.size == (int)strlen(expected) && !memcmp(w.buf, expected, w.size));
+
+    xml_writer_free(&w);
+}
+
+
+
+// limits above INT_MAX do not wrap to negative values
+static void test_limit_clamp(void)
+{
+    static char pool[1024];
+    char doc[] = "<a><b c=\"1\"/></a>";
+    xml_parser_t p;
+
+    xml_init(&p, pool, sizeof(pool));
+    p.errorcode = XML_ERROR_NONE;
+    CHECK(xml_set_limit(&p, XML_LIMIT_DEPTH, (size_t)-1) == XML_ERROR_NONE);
+    CHECK(xml_set_limit(&p, XML_LIMIT_ATTRS, (size_t)-1) == XML_ERROR_NONE);
+    CHECK(xml_set_limit(&p, XML_LIMIT_NAME, (size_t)-1) == XML_ERROR_NONE);
+    CHECK(p.max_depth > 0 && p.max_attrs > 0 && p.max_name > 0);
+    xml_parse_string(&p, doc);
+    CHECK(p.errorcode == XML_ERROR_NONE);
+}
+
+
+
+typedef struct
+{
+    const char* data;
+    int len;
+} zip_input_t;
+
+static int zip_read(void* ctx, char* buf, int size)
+{
+    zip_input_t* in = ctx;
+
+    if(size > in->len) size = in->len;
+    memcpy(buf, in->data, size);
+    in->data += size;
+    in->len -= size;
+
+    return size;
+}
+
+
+
+// token limit is the same with and without decompression thread
+static void test_zip_token_limit(void)
+{
+    static char pool[64 * 1024];
+    static char doc[4 * XML_ZIP_BLOCK];
+    int threaded, size, err[2][2];
+
+    // token starts before end of first block, long token does not fit in
+    // XML_ZIP_KEEP bytes kept for next block
+    for(size = 0; size < 2; size++)
+    {
+        int start = size ? XML_ZIP_BLOCK - XML_ZIP_KEEP - 1024 : XML_ZIP_BLOCK - XML_ZIP_KEEP / 2;
+        int value = XML_ZIP_KEEP + 2048;
+
+        strcpy(doc, "<r>");
+        memset(doc + 3, ' ', start - 3);
+        strcpy(doc + start, "<e a=\"");
+        memset(doc + start + 6, 'x', value);
+        strcpy(doc + start + 6 + value, "\"/></r>");
+
+        for(threaded = 0; threaded < 2; threaded++)
+        {
+            zip_input_t in;
+            xml_parser_t p;
+
+            in.data = doc;
+            in.len = (int)strlen(doc);
+            xml_init(&p, pool, sizeof(pool));
+            p.errorcode = XML_ERROR_NONE;
+            err[size][threaded] = xml_parse_zip(&p, zip_read, &in, XML_ZIP_NONE, threaded);
+        }
+    }
+
+    CHECK(err[0][0] == XML_ERROR_NONE && err[0][1] == XML_ERROR_NONE);
+    CHECK(err[1][0] == XML_ERROR_NO_MEMORY && err[1][1] == XML_ERROR_NO_MEMORY);
+}
+
+
+
+int main(void)
+{
+    test_c14n_attrs();
+    test_diff_malformed();
+    test_include_twice();
+    test_include_limits();
+    test_shred_nested_text();
+    test_bind_decode();
+    test_bind_arrays();
+    test_pipe_attrs();
+    test_limit_clamp();
+    test_zip_token_limit();
+
+    printf("%d checks failed\n", failures);
+
+    return failures ? 1 : 0;
+}
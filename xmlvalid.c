@@ -0,0 +1,835 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlvalid.c
+
+#include <stdlib.h>
+#include <string.h>
+#include "xmlvalid.h"
+
+
+// max number of element names in one content model, position 0 is start
+#define VALID_POSITIONS 64
+
+typedef struct valid_expr_s valid_expr_t;
+typedef struct valid_dtd_s valid_dtd_t;
+
+// Glushkov functions of content particle, bit i is position i
+struct valid_expr_s
+{
+    uint64_t first;
+    uint64_t last;
+    int nullable;
+};
+
+// state of DTD compilation
+struct valid_dtd_s
+{
+    xml_valid_t* v;
+    const char* start;
+    const char* s;
+    int err;
+    int positions;
+    int sym[VALID_POSITIONS];           // name id of position
+    uint64_t follow[VALID_POSITIONS];   // positions that can follow position
+};
+
+
+
+static unsigned valid_hash(const char* s, int len)
+{
+    unsigned h = 2166136261u;
+
+    while(len--) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+
+
+// returns name id or -1
+static int valid_lookup(const xml_valid_t* v, const char* name, int len)
+{
+    unsigned mask = v->name_slots - 1;
+    unsigned i;
+    int id;
+
+    if(!v->name_slots) return -1;
+
+    for(i = valid_hash(name, len) & mask; (id = v->name_table[i]) != 0; i = (i + 1) & mask)
+    {
+        const char* s = v->name_chars + v->name_offset[id - 1];
+
+        if(!memcmp(s, name, len) && !s[len]) return id - 1;
+    }
+
+    return -1;
+}
+
+
+
+// returns name id, name is added if needed, -1 if there is no enough memory
+static int valid_intern(xml_valid_t* v, const char* name, int len)
+{
+    int id = valid_lookup(v, name, len);
+    unsigned mask, i;
+
+    if(id >= 0) return id;
+
+    // hash table is at most half full
+    if(2 * (v->name_count + 1) > v->name_slots)
+    {
+        int slots = v->name_slots ? 2 * v->name_slots : 64;
+        int* table = calloc(slots, sizeof(int));
+
+        if(!table) return -1;
+
+        for(id = 0; id < v->name_count; id++)
+        {
+            const char* s = v->name_chars + v->name_offset[id];
+
+            for(i = valid_hash(s, (int)strlen(s)) & (slots - 1); table[i]; i = (i + 1) & (slots - 1));
+            table[i] = id + 1;
+        }
+
+        free(v->name_table);
+        v->name_table = table;
+        v->name_slots = slots;
+    }
+
+    if(v->name_count == v->name_size)
+    {
+        int size = v->name_size ? 2 * v->name_size : 32;
+        int* offset = realloc(v->name_offset, size * sizeof(int));
+        xml_valid_elem_t* elems;
+
+        if(!offset) return -1;
+        v->name_offset = offset;
+
+        elems = realloc(v->elems, size * sizeof(xml_valid_elem_t));
+        if(!elems) return -1;
+        memset(elems + v->name_size, 0, (size - v->name_size) * sizeof(xml_valid_elem_t));
+        v->elems = elems;
+        v->name_size = size;
+    }
+
+    if(v->chars_used + len + 1 > v->chars_size)
+    {
+        int size = v->chars_size ? v->chars_size : 1024;
+        char* chars;
+
+        while(v->chars_used + len + 1 > size) size *= 2;
+        chars = realloc(v->name_chars, size);
+        if(!chars) return -1;
+        v->name_chars = chars;
+        v->chars_size = size;
+    }
+
+    id = v->name_count++;
+    v->name_offset[id] = v->chars_used;
+    memcpy(v->name_chars + v->chars_used, name, len);
+    v->name_chars[v->chars_used + len] = 0;
+    v->chars_used += len + 1;
+
+    mask = v->name_slots - 1;
+    for(i = valid_hash(name, len) & mask; v->name_table[i]; i = (i + 1) & mask);
+    v->name_table[i] = id + 1;
+
+    return id;
+}
+
+
+
+// compile errors, first error is kept
+static int dtd_error(valid_dtd_t* d, int err, const char* str)
+{
+    if(!d->err)
+    {
+        d->err = err;
+        d->v->errorstr = str;
+        d->v->error_pos = (int)(d->s - d->start);
+    }
+
+    return err;
+}
+
+
+
+static void dtd_space(valid_dtd_t* d)
+{
+    while(*d->s == ' ' || *d->s == '\t' || *d->s == '\n' || *d->s == '\r') d->s++;
+}
+
+
+
+static int is_name_char(int c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == ':' || c == '.' || c == '-' || c >= 0x80;
+}
+
+
+
+// returns name id or -1 if there is no name
+static int dtd_name(valid_dtd_t* d)
+{
+    const char* name;
+    int id;
+
+    dtd_space(d);
+    name = d->s;
+    while(is_name_char((unsigned char)*d->s)) d->s++;
+
+    if(d->s == name)
+    {
+        dtd_error(d, XML_ERROR_MALFORMED, "Name expected");
+        return -1;
+    }
+
+    id = valid_intern(d->v, name, (int)(d->s - name));
+    if(id < 0) dtd_error(d, XML_ERROR_NO_MEMORY, "No enough memory for names");
+
+    return id;
+}
+
+
+
+// returns 1 and skips keyword if it is next in DTD
+static int dtd_keyword(valid_dtd_t* d, const char* keyword)
+{
+    int len = (int)strlen(keyword);
+
+    dtd_space(d);
+    if(strncmp(d->s, keyword, len) || is_name_char((unsigned char)d->s[len])) return 0;
+
+    d->s += len;
+    return 1;
+}
+
+
+
+static void add_follow(valid_dtd_t* d, uint64_t from, uint64_t to)
+{
+    int i;
+
+    for(i = 0; i < VALID_POSITIONS; i++)
+    {
+        if(from & ((uint64_t)1 << i)) d->follow[i] |= to;
+    }
+}
+
+
+
+// new position for element name
+static int dtd_position(valid_dtd_t* d, int id, valid_expr_t* e)
+{
+    int pos;
+
+    if(d->positions == VALID_POSITIONS - 1) return dtd_error(d, XML_ERROR_RANGE, "Content model too large");
+
+    pos = ++d->positions;
+    d->sym[pos] = id;
+    d->follow[pos] = 0;
+    e->first = e->last = (uint64_t)1 << pos;
+    e->nullable = 0;
+
+    return 0;
+}
+
+
+
+// cp ::= (Name | '(' cp (',' cp)* ')' | '(' cp ('|' cp)* ')') ('?' | '*' | '+')?
+static int dtd_particle(valid_dtd_t* d, valid_expr_t* e)
+{
+    dtd_space(d);
+
+    if(*d->s == '(')
+    {
+        valid_expr_t c;
+        int sep = 0;
+
+        d->s++;
+        if(dtd_particle(d, e)) return d->err;
+
+        while(1)
+        {
+            dtd_space(d);
+            if(*d->s == ')') break;
+
+            if((*d->s != ',' && *d->s != '|') || (sep && *d->s != sep))
+            {
+                return dtd_error(d, XML_ERROR_MALFORMED, "Malformed content model");
+            }
+
+            sep = *d->s++;
+            if(dtd_particle(d, &c)) return d->err;
+
+            if(sep == ',')
+            {
+                add_follow(d, e->last, c.first);
+                if(e->nullable) e->first |= c.first;
+                e->last = c.nullable ? e->last | c.last : c.last;
+                e->nullable = e->nullable && c.nullable;
+            }
+            else
+            {
+                e->first |= c.first;
+                e->last |= c.last;
+                e->nullable = e->nullable || c.nullable;
+            }
+        }
+        d->s++;
+    }
+    else
+    {
+        int id = dtd_name(d);
+
+        if(id < 0 || dtd_position(d, id, e)) return d->err;
+    }
+
+    if(*d->s == '*' || *d->s == '+') add_follow(d, e->last, e->first);
+    if(*d->s == '*' || *d->s == '?') e->nullable = 1;
+    if(*d->s == '*' || *d->s == '+' || *d->s == '?') d->s++;
+
+    return 0;
+}
+
+
+
+// subset construction of DFA from positions of content model
+static int dtd_automaton(valid_dtd_t* d, xml_valid_elem_t* elem, const valid_expr_t* e)
+{
+    int16_t trans[XML_VALID_STATES][VALID_POSITIONS];
+    uint64_t state[XML_VALID_STATES];
+    uint64_t symbol_mask[VALID_POSITIONS];
+    int symbol_names[VALID_POSITIONS];
+    int symbols = 0;
+    int states = 1;
+    int i, a, j;
+
+    // symbols are distinct names of positions
+    for(i = 1; i <= d->positions; i++)
+    {
+        for(a = 0; a < symbols && symbol_names[a] != d->sym[i]; a++);
+        if(a == symbols)
+        {
+            symbol_names[symbols] = d->sym[i];
+            symbol_mask[symbols++] = 0;
+        }
+        symbol_mask[a] |= (uint64_t)1 << i;
+    }
+
+    d->follow[0] = e->first;
+    state[0] = 1;
+
+    for(i = 0; i < states; i++)
+    {
+        uint64_t next = 0;
+
+        for(j = 0; j < VALID_POSITIONS; j++)
+        {
+            if(state[i] & ((uint64_t)1 << j)) next |= d->follow[j];
+        }
+
+        for(a = 0; a < symbols; a++)
+        {
+            uint64_t t = next & symbol_mask[a];
+
+            trans[i][a] = -1;
+            if(!t) continue;
+
+            for(j = 0; j < states && state[j] != t; j++);
+            if(j == states)
+            {
+                if(states == XML_VALID_STATES) return dtd_error(d, XML_ERROR_RANGE, "Content model too large");
+                state[states++] = t;
+            }
+            trans[i][a] = (int16_t)j;
+        }
+    }
+
+    elem->symbols = symbols;
+    elem->states = states;
+    elem->symbol_names = malloc((symbols + 1) * sizeof(int));
+    elem->trans = malloc(states * (symbols + 1) * sizeof(int16_t));
+    elem->accept = malloc(states);
+    if(!elem->symbol_names || !elem->trans || !elem->accept) return dtd_error(d, XML_ERROR_NO_MEMORY, "No enough memory for automaton");
+
+    memcpy(elem->symbol_names, symbol_names, symbols * sizeof(int));
+
+    for(i = 0; i < states; i++)
+    {
+        elem->trans[i * (symbols + 1)] = -1;
+        for(a = 0; a < symbols; a++) elem->trans[i * (symbols + 1) + a + 1] = trans[i][a];
+        elem->accept[i] = (state[i] & e->last) || (i == 0 && e->nullable);
+    }
+
+    return 0;
+}
+
+
+
+// <!ELEMENT name contentspec>
+static int dtd_element(valid_dtd_t* d)
+{
+    valid_expr_t e;
+    int id = dtd_name(d);
+    int kind;
+
+    if(id < 0) return d->err;
+    if(d->v->elems[id].kind) return dtd_error(d, XML_ERROR_MALFORMED, "Element declared twice");
+
+    d->positions = 0;
+    dtd_space(d);
+
+    if(dtd_keyword(d, "EMPTY")) kind = XML_CONTENT_EMPTY;
+    else if(dtd_keyword(d, "ANY")) kind = XML_CONTENT_ANY;
+    else if(*d->s != '(') return dtd_error(d, XML_ERROR_MALFORMED, "Malformed content model");
+    else
+    {
+        const char* open = d->s++;
+
+        dtd_space(d);
+        if(!strncmp(d->s, "#PCDATA", 7))
+        {
+            // mixed content is (a | b | ...)*
+            d->s += 7;
+            e.first = e.last = 0;
+            e.nullable = 1;
+
+            while(1)
+            {
+                valid_expr_t c;
+                int name;
+
+                dtd_space(d);
+                if(*d->s != '|') break;
+
+                d->s++;
+                name = dtd_name(d);
+                if(name < 0 || dtd_position(d, name, &c)) return d->err;
+
+                e.first |= c.first;
+                e.last |= c.last;
+            }
+
+            if(*d->s != ')') return dtd_error(d, XML_ERROR_MALFORMED, "Malformed content model");
+            d->s++;
+
+            if(*d->s == '*') d->s++;
+            else if(d->positions) return dtd_error(d, XML_ERROR_MALFORMED, "Mixed content model must end with )*");
+
+            add_follow(d, e.last, e.first);
+            kind = XML_CONTENT_MIXED;
+        }
+        else
+        {
+            d->s = open;
+            if(dtd_particle(d, &e)) return d->err;
+            kind = XML_CONTENT_CHILDREN;
+        }
+
+        // elems can be moved while names of content model are added
+        if(dtd_automaton(d, d->v->elems + id, &e)) return d->err;
+    }
+
+    d->v->elems[id].kind = kind;
+
+    dtd_space(d);
+    if(*d->s != '>') return dtd_error(d, XML_ERROR_MALFORMED, "'>' expected");
+    d->s++;
+
+    return 0;
+}
+
+
+
+// skip quoted string
+static int dtd_quoted(valid_dtd_t* d)
+{
+    const char* end;
+
+    dtd_space(d);
+    if(*d->s != '"' && *d->s != '\'') return dtd_error(d, XML_ERROR_MALFORMED, "Quoted string expected");
+
+    end = strchr(d->s + 1, *d->s);
+    if(!end) return dtd_error(d, XML_ERROR_MALFORMED, "Unterminated string");
+
+    d->s = end + 1;
+    return 0;
+}
+
+
+
+// <!ATTLIST element (name type default)*>
+static int dtd_attlist(valid_dtd_t* d)
+{
+    int id = dtd_name(d);
+
+    if(id < 0) return d->err;
+
+    while(1)
+    {
+        xml_valid_elem_t* elem;
+        int attr, required = 0, i;
+
+        dtd_space(d);
+        if(*d->s == '>') break;
+
+        attr = dtd_name(d);
+        if(attr < 0) return d->err;
+
+        // type
+        dtd_space(d);
+        if(dtd_keyword(d, "NOTATION")) dtd_space(d);
+        if(*d->s == '(')
+        {
+            const char* end = strchr(d->s, ')');
+
+            if(!end) return dtd_error(d, XML_ERROR_MALFORMED, "Malformed enumeration");
+            d->s = end + 1;
+        }
+        else if(dtd_name(d) < 0) return d->err;
+
+        // default
+        if(dtd_keyword(d, "#REQUIRED")) required = 1;
+        else if(!dtd_keyword(d, "#IMPLIED"))
+        {
+            dtd_keyword(d, "#FIXED");
+            if(dtd_quoted(d)) return d->err;
+        }
+
+        // elems can be moved while names are added
+        elem = d->v->elems + id;
+
+        // first declaration of attribute is binding
+        for(i = 0; i < elem->attr_count && elem->attr_names[i] != attr; i++);
+        if(i < elem->attr_count) continue;
+
+        if(i == 64) return dtd_error(d, XML_ERROR_RANGE, "Too many attributes");
+
+        elem->attr_names[i] = attr;
+        elem->attr_count++;
+        if(required) elem->required |= (uint64_t)1 << i;
+    }
+
+    d->s++;
+    return 0;
+}
+
+
+
+// skip declaration up to '>', quoted strings can contain '>'
+static int dtd_skip(valid_dtd_t* d)
+{
+    while(*d->s && *d->s != '>')
+    {
+        if(*d->s == '"' || *d->s == '\'')
+        {
+            if(dtd_quoted(d)) return d->err;
+        }
+        else d->s++;
+    }
+
+    if(!*d->s) return dtd_error(d, XML_ERROR_MALFORMED, "'>' expected");
+    d->s++;
+
+    return 0;
+}
+
+
+
+// declarations up to end of DTD or ']'
+static int dtd_declarations(valid_dtd_t* d)
+{
+    while(1)
+    {
+        dtd_space(d);
+
+        if(!*d->s || *d->s == ']') return 0;
+
+        if(!strncmp(d->s, "<!--", 4))
+        {
+            const char* end = strstr(d->s + 4, "-->");
+
+            if(!end) return dtd_error(d, XML_ERROR_MALFORMED, "Unterminated comment");
+            d->s = end + 3;
+        }
+        else if(!strncmp(d->s, "<?", 2))
+        {
+            const char* end = strstr(d->s + 2, "?>");
+
+            if(!end) return dtd_error(d, XML_ERROR_MALFORMED, "Unterminated processing instruction");
+            d->s = end + 2;
+        }
+        else if(!strncmp(d->s, "<!ELEMENT", 9))
+        {
+            d->s += 9;
+            if(dtd_element(d)) return d->err;
+        }
+        else if(!strncmp(d->s, "<!ATTLIST", 9))
+        {
+            d->s += 9;
+            if(dtd_attlist(d)) return d->err;
+        }
+        else if(!strncmp(d->s, "<!ENTITY", 8) || !strncmp(d->s, "<!NOTATION", 10))
+        {
+            if(dtd_skip(d)) return d->err;
+        }
+        else if(*d->s == '%') return dtd_error(d, XML_ERROR_MALFORMED, "Parameter entities are not supported");
+        else return dtd_error(d, XML_ERROR_MALFORMED, "Declaration expected");
+    }
+}
+
+
+
+int xml_valid_compile(xml_valid_t* v, const char* dtd)
+{
+    valid_dtd_t d;
+    int id, a;
+
+    memset(v, 0, sizeof(*v));
+    v->root = -1;
+
+    d.v = v;
+    d.start = d.s = dtd;
+    d.err = 0;
+    d.positions = 0;
+
+    dtd_space(&d);
+    if(!strncmp(d.s, "<!DOCTYPE", 9))
+    {
+        d.s += 9;
+        v->root = dtd_name(&d);
+        if(v->root < 0) return d.err;
+
+        dtd_space(&d);
+        if(*d.s != '[') return dtd_error(&d, XML_ERROR_MALFORMED, "External DTD is not supported");
+        d.s++;
+
+        if(dtd_declarations(&d)) return d.err;
+
+        if(*d.s != ']') return dtd_error(&d, XML_ERROR_MALFORMED, "']' expected");
+        d.s++;
+        dtd_space(&d);
+        if(*d.s != '>') return dtd_error(&d, XML_ERROR_MALFORMED, "'>' expected");
+        d.s++;
+        dtd_space(&d);
+    }
+    else if(dtd_declarations(&d)) return d.err;
+
+    if(*d.s) return dtd_error(&d, XML_ERROR_MALFORMED, "Unexpected text after DTD");
+
+    // symbol maps need final number of names
+    for(id = 0; id < v->name_count; id++)
+    {
+        xml_valid_elem_t* elem = v->elems + id;
+
+        if(elem->kind != XML_CONTENT_MIXED && elem->kind != XML_CONTENT_CHILDREN) continue;
+
+        elem->symbol = calloc(v->name_count, sizeof(int16_t));
+        if(!elem->symbol) return dtd_error(&d, XML_ERROR_NO_MEMORY, "No enough memory for automaton");
+
+        for(a = 0; a < elem->symbols; a++) elem->symbol[elem->symbol_names[a]] = (int16_t)(a + 1);
+    }
+
+    return XML_ERROR_NONE;
+}
+
+
+
+void xml_valid_free(xml_valid_t* v)
+{
+    int id;
+
+    for(id = 0; id < v->name_count; id++)
+    {
+        free(v->elems[id].symbol_names);
+        free(v->elems[id].symbol);
+        free(v->elems[id].trans);
+        free(v->elems[id].accept);
+    }
+
+    free(v->elems);
+    free(v->name_table);
+    free(v->name_offset);
+    free(v->name_chars);
+
+    v->elems = 0;
+    v->name_table = 0;
+    v->name_offset = 0;
+    v->name_chars = 0;
+    v->name_count = v->name_size = v->name_slots = 0;
+}
+
+
+
+// report violation without changing p->tag
+static void valid_error(xml_valid_t* v, xml_parser_t* p, const char* str)
+{
+    char* tag = p->tag;
+
+    v->errors++;
+    xml_set_error(p, XML_ERROR_INVALID, str);
+    p->tag = tag;
+}
+
+
+
+static void valid_attributes(xml_valid_t* v, xml_parser_t* p, const xml_valid_elem_t* elem)
+{
+    char* attr_string = p->attr;
+    uint64_t seen = 0;
+    xml_attr_t a;
+
+    while(attr_string && xml_next_attr(&attr_string, &a))
+    {
+        int id = valid_lookup(v, a.name, a.name_len);
+        int i;
+
+        for(i = 0; i < elem->attr_count && elem->attr_names[i] != id; i++);
+
+        if(id < 0 || i == elem->attr_count) valid_error(v, p, "Undeclared attribute");
+        else seen |= (uint64_t)1 << i;
+    }
+
+    if(elem->required & ~seen) valid_error(v, p, "Required attribute is missing");
+}
+
+
+
+void xml_valid_start(xml_valid_t* v, xml_parser_t* p)
+{
+    int level = p->level;
+    int id = valid_lookup(v, p->tag, (int)strlen(p->tag));
+
+    if(level < 1 || level > XML_VALID_DEPTH) return;
+
+    if(level == 1)
+    {
+        if(v->root >= 0 && id != v->root) valid_error(v, p, "Root element does not match DOCTYPE");
+    }
+    else if(v->stack[level - 2].elem >= 0)
+    {
+        // transition of parent automaton
+        const xml_valid_elem_t* parent = v->elems + v->stack[level - 2].elem;
+        int* state = &v->stack[level - 2].state;
+
+        if(parent->kind == XML_CONTENT_EMPTY) valid_error(v, p, "Element must be empty");
+        else if(parent->kind != XML_CONTENT_ANY)
+        {
+            int sym = id >= 0 ? parent->symbol[id] : 0;
+            int next = sym ? parent->trans[*state * (parent->symbols + 1) + sym] : -1;
+
+            if(next < 0) valid_error(v, p, "Element is not allowed here");
+            else *state = next;
+        }
+    }
+
+    v->stack[level - 1].elem = -1;
+    v->stack[level - 1].state = 0;
+
+    if(id < 0 || !v->elems[id].kind)
+    {
+        valid_error(v, p, "Undeclared element");
+        return;
+    }
+
+    v->stack[level - 1].elem = id;
+    valid_attributes(v, p, v->elems + id);
+}
+
+
+
+void xml_valid_end(xml_valid_t* v, xml_parser_t* p)
+{
+    int level = p->level + 1;
+    const xml_valid_elem_t* elem;
+
+    if(level < 1 || level > XML_VALID_DEPTH || v->stack[level - 1].elem < 0) return;
+
+    elem = v->elems + v->stack[level - 1].elem;
+    if((elem->kind == XML_CONTENT_MIXED || elem->kind == XML_CONTENT_CHILDREN) && !elem->accept[v->stack[level - 1].state])
+    {
+        valid_error(v, p, "Element content is incomplete");
+    }
+}
+
+
+
+void xml_valid_text(xml_valid_t* v, xml_parser_t* p, const char* text)
+{
+    int level = p->level;
+    const xml_valid_elem_t* elem;
+
+    if(level < 1 || level > XML_VALID_DEPTH || v->stack[level - 1].elem < 0) return;
+
+    elem = v->elems + v->stack[level - 1].elem;
+    if(elem->kind == XML_CONTENT_EMPTY)
+    {
+        if(*text) valid_error(v, p, "Element must be empty");
+    }
+    else if(elem->kind == XML_CONTENT_CHILDREN)
+    {
+        if(text[strspn(text, " \t\n\r")]) valid_error(v, p, "Text is not allowed here");
+    }
+}
+
+
+
+static void valid_start_element(xml_parser_t* p)
+{
+    xml_valid_start(p->user_ptr, p);
+}
+
+
+
+static void valid_end_element(xml_parser_t* p)
+{
+    xml_valid_end(p->user_ptr, p);
+}
+
+
+
+static void valid_characters(xml_parser_t* p)
+{
+    xml_valid_text(p->user_ptr, p, p->chars);
+}
+
+
+
+static void valid_cdata(xml_parser_t* p)
+{
+    xml_valid_text(p->user_ptr, p, p->cdata);
+}
+
+
+
+void xml_valid_attach(xml_valid_t* v, xml_parser_t* p)
+{
+    p->user_ptr = v;
+    xml_set_handler(p, valid_start_element, XML_START_ELEMENT_HANDLER);
+    xml_set_handler(p, valid_end_element, XML_END_ELEMENT_HANDLER);
+    xml_set_handler(p, valid_characters, XML_CHARACTER_HANDLER);
+    xml_set_handler(p, valid_cdata, XML_CDATA_HANDLER);
+}
@@ -0,0 +1,135 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlvalid.h
+// validation of element structure and attributes inline with parsing
+//
+// DTD subset is compiled to one DFA per element content model and
+// attribute bitmasks, so validation of element is few table lookups:
+//     <!DOCTYPE Profile [
+//     <!ELEMENT Profile (Tools, Info?)>
+//     <!ELEMENT Tools (Tool)*>
+//     <!ELEMENT Tool (Description?)>
+//     <!ATTLIST Tool Filename CDATA #REQUIRED Timeout CDATA #IMPLIED>
+//     <!ELEMENT Description (#PCDATA)>
+//     <!ELEMENT Info ANY>
+//     ]>
+//
+// supported are EMPTY, ANY, mixed and children content models with , | ? * +
+// and ATTLIST declarations; attribute types and defaults are parsed but
+// values are not checked, entities and notations are not supported
+// content model can have up to 63 element names
+//
+// violations are reported to parser with XML_ERROR_INVALID and do not
+// stop parsing, children of undeclared element are still validated
+
+#ifndef __XMLVALID_H__
+#define __XMLVALID_H__
+
+#include <stdint.h>
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max element level that is validated
+#define XML_VALID_DEPTH     256
+
+// max number of DFA states of one content model
+#define XML_VALID_STATES    256
+
+// content kinds
+enum
+{
+    XML_CONTENT_UNDECLARED = 0,
+    XML_CONTENT_EMPTY,
+    XML_CONTENT_ANY,
+    XML_CONTENT_MIXED,      // text and listed elements in any order
+    XML_CONTENT_CHILDREN,   // elements only, whitespace is allowed
+};
+
+typedef struct xml_valid_elem_s xml_valid_elem_t;
+typedef struct xml_valid_s xml_valid_t;
+
+struct xml_valid_elem_s
+{
+    int kind;
+    int symbols;            // number of element names in content model
+    int* symbol_names;      // name ids of symbols
+    int16_t* symbol;        // symbol + 1 of name id or 0, name_count entries
+    int states;
+    int16_t* trans;         // next state or -1, states x (symbols + 1), column 0 is not used
+    unsigned char* accept;  // 1 if element can end in state
+    int attr_count;
+    int attr_names[64];     // name ids of declared attributes
+    uint64_t required;      // bits of required attributes
+};
+
+struct xml_valid_s
+{
+    void* user_ptr;
+    int errors;             // number of reported violations
+    const char* errorstr;   // compile error
+    int error_pos;          // offset of compile error in DTD
+    int root;               // name id of DOCTYPE root or -1
+    int name_count;
+    int name_size;
+    int name_slots;
+    int* name_table;        // hash table of name ids + 1, 0 is empty slot
+    int* name_offset;
+    char* name_chars;
+    int chars_used;
+    int chars_size;
+    xml_valid_elem_t* elems;    // indexed by name id
+    struct
+    {
+        int elem;           // name id of declared element or -1
+        int state;
+    }
+    stack[XML_VALID_DEPTH];
+};
+
+
+// compile DTD subset, optionally enclosed in <!DOCTYPE root [ ... ]>
+// returns XML_ERROR_NONE, XML_ERROR_NO_MEMORY, XML_ERROR_MALFORMED if DTD
+// can not be parsed or XML_ERROR_RANGE if content model is too large
+// errorstr and error_pos describe error, v has to be freed in any case
+int xml_valid_compile(xml_valid_t* v, const char* dtd);
+
+void xml_valid_free(xml_valid_t* v);
+
+// set handlers of p, p->user_ptr is set to v
+void xml_valid_attach(xml_valid_t* v, xml_parser_t* p);
+
+// validation steps for use in user handlers, p->tag is not changed
+void xml_valid_start(xml_valid_t* v, xml_parser_t* p);
+void xml_valid_end(xml_valid_t* v, xml_parser_t* p);
+void xml_valid_text(xml_valid_t* v, xml_parser_t* p, const char* text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLVALID_H__
@@ -0,0 +1,398 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlwriter.c
+
+#include <string.h>
+#include <stdlib.h>
+#include "xmlwriter.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// make space in output buffer
+// returns 1 if there is no more space, 0 otherwise
+static int writer_make_space(xml_writer_t* w)
+{
+    if(w->errorcode) return 1;
+
+    if(w->growable)
+    {
+        int capacity = w->capacity ? w->capacity * 2 : 4096;
+        char* buf = realloc(w->buf, capacity);
+
+        if(!buf)
+        {
+            w->errorcode = XML_ERROR_NO_MEMORY;
+            return 1;
+        }
+
+        w->buf = buf;
+        w->capacity = capacity;
+    }
+    else if(!w->flush || w->flush(w))
+    {
+        w->errorcode = XML_ERROR_NO_MEMORY;
+        return 1;
+    }
+    else w->size = 0;
+
+    return 0;
+}
+
+
+
+static void writer_put(xml_writer_t* w, const char* s, int len)
+{
+    int n;
+
+    while(len)
+    {
+        if(w->size == w->capacity && writer_make_space(w)) return;
+
+        n = w->capacity - w->size;
+        if(n > len) n = len;
+
+        memcpy(w->buf + w->size, s, n);
+        w->size += n;
+        s += n;
+        len -= n;
+    }
+}
+
+
+
+static void writer_putc(xml_writer_t* w, char c)
+{
+    if(w->size == w->capacity && writer_make_space(w)) return;
+    w->buf[w->size++] = c;
+}
+
+
+
+// find first char that has to be escaped
+// '"', tab and line ends are escaped only in attribute values, where parser
+// would normalize them to spaces
+static const char* writer_find_special(const char* ptr, const char* end, int attr)
+{
+#ifdef __SSE2__
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8(attr ? '"' : '&');
+    const __m128i tab = _mm_set1_epi8(attr ? '\t' : '&');
+    const __m128i lf = _mm_set1_epi8(attr ? '\n' : '&');
+    const __m128i cr = _mm_set1_epi8(attr ? '\r' : '&');
+
+    while(end - ptr >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_cmpeq_epi8(v, quot)));
+        int mask;
+
+        m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, tab),
+                                         _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr))));
+        mask = _mm_movemask_epi8(m);
+
+        if(mask) return ptr + __builtin_ctz(mask);
+        ptr += 16;
+    }
+#endif
+
+    while(ptr < end && *ptr != '&' && *ptr != '<' && *ptr != '>' &&
+          !(attr && (*ptr == '"' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r'))) ptr++;
+    return ptr;
+}
+
+
+
+// write text with escaped special chars, clean runs are copied with memcpy
+static void writer_put_escaped(xml_writer_t* w, const char* s, int len, int attr)
+{
+    const char* end = s + len;
+    const char* ptr;
+
+    while(s < end)
+    {
+        ptr = writer_find_special(s, end, attr);
+        writer_put(w, s, (int)(ptr - s));
+        if(ptr == end) break;
+
+        if(*ptr == '&') writer_put(w, "&amp;", 5);
+        else if(*ptr == '<') writer_put(w, "&lt;", 4);
+        else if(*ptr == '>') writer_put(w, "&gt;", 4);
+        else if(*ptr == '"') writer_put(w, "&quot;", 6);
+        else if(*ptr == '\t') writer_put(w, "&#9;", 4);
+        else if(*ptr == '\n') writer_put(w, "&#10;", 5);
+        else writer_put(w, "&#13;", 5);
+
+        s = ptr + 1;
+    }
+}
+
+
+
+// close pending start tag
+static void writer_close_tag(xml_writer_t* w)
+{
+    if(w->open)
+    {
+        writer_putc(w, '>');
+        w->open = 0;
+    }
+}
+
+
+
+// start new line for markup if pretty printing is enabled
+// element with text content (w->text is its level) and all its children
+// are written without indentation
+static void writer_indent(xml_writer_t* w, int level)
+{
+    int i;
+
+    if(w->pretty && w->started && !(w->text && w->level >= w->text))
+    {
+        writer_putc(w, '\n');
+        for(i = level * w->pretty; i > 0; i--) writer_putc(w, ' ');
+    }
+
+    w->started = 1;
+}
+
+
+
+void xml_writer_init(xml_writer_t* w, char* buf, int size, int (*flush)(xml_writer_t* w))
+{
+    w->user_ptr = 0;
+    w->buf = buf;
+    w->size = 0;
+    w->capacity = buf ? size : 0;
+    w->growable = buf ? 0 : 1;
+    w->errorcode = XML_ERROR_NONE;
+    w->level = 0;
+    w->pretty = 0;
+    w->open = 0;
+    w->text = 0;
+    w->started = 0;
+    w->flush = flush;
+
+    // fixed buffer without space would never make progress
+    if(buf && size <= 0) w->errorcode = XML_ERROR_ARG;
+}
+
+
+
+void xml_writer_free(xml_writer_t* w)
+{
+    if(w->growable) free(w->buf);
+    w->buf = 0;
+    w->size = 0;
+    w->capacity = 0;
+}
+
+
+
+void xml_writer_set_pretty(xml_writer_t* w, int pretty)
+{
+    w->pretty = pretty;
+}
+
+
+
+int xml_writer_flush(xml_writer_t* w)
+{
+    writer_close_tag(w);
+
+    if(!w->errorcode && w->flush && w->size)
+    {
+        if(w->flush(w)) w->errorcode = XML_ERROR_NO_MEMORY;
+        else w->size = 0;
+    }
+
+    return w->errorcode;
+}
+
+
+
+void xml_write_start_element(xml_writer_t* w, const char* name)
+{
+    writer_close_tag(w);
+    writer_indent(w, w->level);
+
+    writer_putc(w, '<');
+    writer_put(w, name, (int)strlen(name));
+
+    w->open = 1;
+    w->level++;
+}
+
+
+
+void xml_write_attribute(xml_writer_t* w, const char* name, const char* value, int value_len)
+{
+    if(value_len < 0) value_len = (int)strlen(value);
+
+    writer_putc(w, ' ');
+    writer_put(w, name, (int)strlen(name));
+    writer_put(w, "=\"", 2);
+    writer_put_escaped(w, value, value_len, 1);
+    writer_putc(w, '"');
+}
+
+
+
+void xml_write_attr(xml_writer_t* w, const xml_attr_t* attr)
+{
+    writer_putc(w, ' ');
+    writer_put(w, attr->name, attr->name_len);
+    writer_put(w, "=\"", 2);
+    writer_put_escaped(w, attr->value, attr->value_len, 1);
+    writer_putc(w, '"');
+}
+
+
+
+// write attribute string as passed to start_element_handler
+void xml_write_attributes(xml_writer_t* w, const char* attr_string)
+{
+    char* ptr = (char*)attr_string;
+    xml_attr_t a;
+
+    while(xml_next_attr(&ptr, &a)) xml_write_attr(w, &a);
+}
+
+
+
+void xml_write_end_element(xml_writer_t* w, const char* name)
+{
+    if(w->level <= 0)
+    {
+        if(!w->errorcode) w->errorcode = XML_ERROR_ARG;
+        return;
+    }
+
+    if(w->open)
+    {
+        writer_put(w, "/>", 2);
+        w->open = 0;
+    }
+    else
+    {
+        writer_indent(w, w->level - 1);
+        writer_put(w, "</", 2);
+        writer_put(w, name, (int)strlen(name));
+        writer_putc(w, '>');
+    }
+
+    w->level--;
+    if(w->level < w->text) w->text = 0;
+}
+
+
+
+void xml_write_characters(xml_writer_t* w, const char* text, int len)
+{
+    if(len < 0) len = (int)strlen(text);
+    if(!len) return;
+
+    writer_close_tag(w);
+    writer_put_escaped(w, text, len, 0);
+
+    if(!w->text) w->text = w->level;
+    w->started = 1;
+}
+
+
+
+// "]]>" inside text is split to two CDATA sections
+void xml_write_cdata(xml_writer_t* w, const char* text, int len)
+{
+    const char* end;
+    const char* ptr;
+
+    if(len < 0) len = (int)strlen(text);
+    end = text + len;
+
+    writer_close_tag(w);
+    writer_put(w, "<![CDATA[", 9);
+
+    for(ptr = text; end - ptr >= 3; ptr++)
+    {
+        if(ptr[0] == ']' && ptr[1] == ']' && ptr[2] == '>')
+        {
+            writer_put(w, text, (int)(ptr - text) + 2);
+            writer_put(w, "]]><![CDATA[", 12);
+            text = ptr + 2;
+        }
+    }
+
+    writer_put(w, text, (int)(end - text));
+    writer_put(w, "]]>", 3);
+
+    if(!w->text) w->text = w->level;
+    w->started = 1;
+}
+
+
+
+void xml_write_comment(xml_writer_t* w, const char* text, int len)
+{
+    if(len < 0) len = (int)strlen(text);
+
+    writer_close_tag(w);
+    writer_indent(w, w->level);
+
+    writer_put(w, "<!--", 4);
+    writer_put(w, text, len);
+    writer_put(w, "-->", 3);
+}
+
+
+
+void xml_write_pi(xml_writer_t* w, const char* text, int len)
+{
+    if(len < 0) len = (int)strlen(text);
+
+    writer_close_tag(w);
+    writer_indent(w, w->level);
+
+    writer_put(w, "<?", 2);
+    writer_put(w, text, len);
+    writer_put(w, "?>", 2);
+}
+
+
+
+void xml_write_raw(xml_writer_t* w, const char* text, int len)
+{
+    if(len < 0) len = (int)strlen(text);
+
+    writer_close_tag(w);
+    writer_put(w, text, len);
+    w->started = 1;
+}
@@ -0,0 +1,88 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlwriter.h
+// xml writer with the same events as parser handlers
+
+#ifndef __XMLWRITER_H__
+#define __XMLWRITER_H__
+
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xml_writer_s xml_writer_t;
+
+struct xml_writer_s
+{
+    void* user_ptr;
+    char* buf;
+    int size;
+    int capacity;
+    int growable;
+    int errorcode;
+    int level;
+    int pretty;         // indent nested elements with pretty spaces per level
+    int open;           // start tag is not closed with '>' yet
+    int text;           // level of outermost element with text content or 0
+    int started;        // something is written to output
+    int (*flush)(xml_writer_t* w);
+};
+
+
+// if buf is 0 output buffer is allocated with malloc and grows as needed
+// otherwise flush is called when buf is full, flush must write w->size bytes
+// from w->buf and return 0 on success; fixed buf with size <= 0 sets
+// errorcode to XML_ERROR_ARG
+void xml_writer_init(xml_writer_t* w, char* buf, int size, int (*flush)(xml_writer_t* w));
+
+void xml_writer_free(xml_writer_t* w);
+
+// set number of spaces per indentation level, 0 disables pretty printing
+void xml_writer_set_pretty(xml_writer_t* w, int pretty);
+
+// pass buffered output to flush callback
+// returns XML_ERROR_NONE or error code of first failed write
+int xml_writer_flush(xml_writer_t* w);
+
+// text length can be -1 for zero terminated strings
+// end element without open element sets errorcode to XML_ERROR_ARG
+void xml_write_start_element(xml_writer_t* w, const char* name);
+void xml_write_attribute(xml_writer_t* w, const char* name, const char* value, int value_len);
+void xml_write_attr(xml_writer_t* w, const xml_attr_t* attr);
+void xml_write_attributes(xml_writer_t* w, const char* attr_string);
+void xml_write_end_element(xml_writer_t* w, const char* name);
+void xml_write_characters(xml_writer_t* w, const char* text, int len);
+void xml_write_cdata(xml_writer_t* w, const char* text, int len);
+void xml_write_comment(xml_writer_t* w, const char* text, int len);
+void xml_write_pi(xml_writer_t* w, const char* text, int len);
+void xml_write_raw(xml_writer_t* w, const char* text, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLWRITER_H__
@@ -0,0 +1,507 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlzip.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xmlzip.h"
+
+#ifdef XML_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef XML_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef XML_HAVE_THREADS
+#include <pthread.h>
+#endif
+
+
+typedef struct zip_decoder_s zip_decoder_t;
+
+struct zip_decoder_s
+{
+    int format;
+    xml_zip_read_t read;
+    void* ctx;
+    int done;               // all input is decompressed
+    int err;                // error code and string of failed decompression
+    const char* errstr;
+    const char* in_ptr;
+    int in_len;
+    int in_eof;
+    int member_end;         // end of gzip member, next member may follow
+#ifdef XML_HAVE_ZLIB
+    z_stream z;
+    int z_init;
+#endif
+#ifdef XML_HAVE_ZSTD
+    ZSTD_DStream* zs;
+#endif
+    char in[XML_ZIP_IN];
+};
+
+
+
+static int zip_error(zip_decoder_t* d, int err, const char* errstr)
+{
+    d->err = err;
+    d->errstr = errstr;
+    return -1;
+}
+
+
+
+// read next block of compressed input if input buffer is empty
+static int zip_fill_input(zip_decoder_t* d)
+{
+    int n;
+
+    if(d->in_len || d->in_eof) return 0;
+
+    n = d->read(d->ctx, d->in, XML_ZIP_IN);
+    if(n < 0) return zip_error(d, XML_ERROR_ARG, "Can not read input");
+    if(!n) d->in_eof = 1;
+
+    d->in_ptr = d->in;
+    d->in_len = n;
+    return 0;
+}
+
+
+
+static int zip_open(zip_decoder_t* d, int format, xml_zip_read_t read, void* ctx)
+{
+    const unsigned char* m;
+
+    memset(d, 0, sizeof(*d));
+    d->read = read;
+    d->ctx = ctx;
+
+    if(zip_fill_input(d)) return -1;
+
+    if(format == XML_ZIP_AUTO)
+    {
+        m = (const unsigned char*)d->in_ptr;
+        format = XML_ZIP_NONE;
+        if(d->in_len >= 2 && m[0] == 0x1f && m[1] == 0x8b) format = XML_ZIP_GZIP;
+        else if(d->in_len >= 2 && (m[0] & 0x0f) == 8 && ((m[0] << 8) | m[1]) % 31 == 0) format = XML_ZIP_GZIP;
+        else if(d->in_len >= 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd) format = XML_ZIP_ZSTD;
+    }
+
+    d->format = format;
+
+    switch(format)
+    {
+    case XML_ZIP_NONE:
+        return 0;
+
+#ifdef XML_HAVE_ZLIB
+    case XML_ZIP_GZIP:
+        // window bits 15 + 32 accepts gzip and zlib headers
+        if(inflateInit2(&d->z, 15 + 32) != Z_OK) return zip_error(d, XML_ERROR_NO_MEMORY, "No enough memory for decompression");
+        d->z_init = 1;
+        return 0;
+#endif
+
+#ifdef XML_HAVE_ZSTD
+    case XML_ZIP_ZSTD:
+        d->zs = ZSTD_createDStream();
+        if(!d->zs || ZSTD_isError(ZSTD_initDStream(d->zs))) return zip_error(d, XML_ERROR_NO_MEMORY, "No enough memory for decompression");
+        return 0;
+#endif
+    }
+
+    return zip_error(d, XML_ERROR_ARG, "Compression format not supported");
+}
+
+
+
+static void zip_close(zip_decoder_t* d)
+{
+#ifdef XML_HAVE_ZLIB
+    if(d->z_init) inflateEnd(&d->z);
+#endif
+#ifdef XML_HAVE_ZSTD
+    if(d->zs) ZSTD_freeDStream(d->zs);
+#endif
+}
+
+
+
+// decompress to out until it is full or input ends
+// returns number of decompressed bytes or -1 on error
+static int zip_decode(zip_decoder_t* d, char* out, int size)
+{
+    int n = 0;
+
+    while(n < size && !d->done)
+    {
+        if(zip_fill_input(d)) return -1;
+
+        switch(d->format)
+        {
+        case XML_ZIP_NONE:
+        {
+            int m = d->in_len < size - n ? d->in_len : size - n;
+
+            if(d->in_eof) d->done = 1;
+            memcpy(out + n, d->in_ptr, m);
+            d->in_ptr += m;
+            d->in_len -= m;
+            n += m;
+            break;
+        }
+
+#ifdef XML_HAVE_ZLIB
+        case XML_ZIP_GZIP:
+        {
+            int r;
+
+            if(d->member_end)
+            {
+                if(d->in_eof)
+                {
+                    d->done = 1;
+                    break;
+                }
+                inflateReset(&d->z);
+                d->member_end = 0;
+            }
+
+            d->z.next_in = (Bytef*)d->in_ptr;
+            d->z.avail_in = d->in_len;
+            d->z.next_out = (Bytef*)out + n;
+            d->z.avail_out = size - n;
+
+            r = inflate(&d->z, Z_NO_FLUSH);
+
+            d->in_ptr = (const char*)d->z.next_in;
+            d->in_len = d->z.avail_in;
+            n = size - d->z.avail_out;
+
+            if(r == Z_STREAM_END) d->member_end = 1;
+            else if(r == Z_BUF_ERROR && d->in_eof) return zip_error(d, XML_ERROR_MALFORMED, "Truncated compressed input");
+            else if(r != Z_OK && r != Z_BUF_ERROR) return zip_error(d, XML_ERROR_MALFORMED, "Corrupted compressed input");
+            break;
+        }
+#endif
+
+#ifdef XML_HAVE_ZSTD
+        case XML_ZIP_ZSTD:
+        {
+            ZSTD_inBuffer in = { d->in_ptr, (size_t)d->in_len, 0 };
+            ZSTD_outBuffer o = { out + n, (size_t)(size - n), 0 };
+            size_t r = ZSTD_decompressStream(d->zs, &o, &in);
+
+            if(ZSTD_isError(r)) return zip_error(d, XML_ERROR_MALFORMED, "Corrupted compressed input");
+
+            d->in_ptr += in.pos;
+            d->in_len -= (int)in.pos;
+            n += (int)o.pos;
+
+            // frame is complete when r is 0, next frame may follow
+            if(d->in_eof && !d->in_len)
+            {
+                if(!r) d->done = 1;
+                else if(!o.pos) return zip_error(d, XML_ERROR_MALFORMED, "Truncated compressed input");
+            }
+            break;
+        }
+#endif
+        }
+    }
+
+    return n;
+}
+
+
+
+static int zip_read_file(void* ctx, char* buf, int size)
+{
+    FILE* f = ctx;
+    int n = (int)fread(buf, 1, size, f);
+
+    return !n && ferror(f) ? -1 : n;
+}
+
+
+
+static int zip_fail(xml_parser_t* p, int err, const char* errstr)
+{
+    xml_set_error(p, err, errstr);
+    xml_reset(p);
+    return err;
+}
+
+
+
+// decompression and parsing alternate on one buffer
+static int zip_parse(xml_parser_t* p, zip_decoder_t* d)
+{
+    int size = XML_ZIP_KEEP + XML_ZIP_BLOCK;
+    char* buf = malloc(size);
+    int keep = 0;
+    int err = XML_ERROR_NONE;
+
+    if(!buf) return zip_fail(p, XML_ERROR_NO_MEMORY, "No enough memory for input buffer");
+
+    while(1)
+    {
+        int n, len, consumed;
+
+        // blocks of the same size as with decompression thread
+        n = zip_decode(d, buf + keep, XML_ZIP_BLOCK);
+        if(n < 0)
+        {
+            err = zip_fail(p, d->err, d->errstr);
+            break;
+        }
+
+        len = keep + n;
+        consumed = xml_parse_chunk(p, buf, len, d->done);
+
+        if(consumed < 0)
+        {
+            err = p->errorcode;
+            break;
+        }
+        if(d->done) break;
+
+        keep = len - consumed;
+        if(keep > XML_ZIP_KEEP)
+        {
+            err = zip_fail(p, XML_ERROR_NO_MEMORY, "No enough memory in input buffer");
+            break;
+        }
+        memmove(buf, buf + consumed, keep);
+    }
+
+    free(buf);
+    return err;
+}
+
+
+
+#ifdef XML_HAVE_THREADS
+
+typedef struct zip_slot_s zip_slot_t;
+typedef struct zip_ring_s zip_ring_t;
+
+// block is preceded by XML_ZIP_KEEP bytes for unparsed input of previous block
+struct zip_slot_s
+{
+    char* data;
+    int len;                // -1 if decompression failed
+    int final;
+    int full;
+};
+
+struct zip_ring_s
+{
+    zip_decoder_t* d;
+    zip_slot_t slots[XML_ZIP_SLOTS];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stop;
+};
+
+
+
+// decompression thread fills free slots in order
+static void* zip_producer(void* arg)
+{
+    zip_ring_t* r = arg;
+    int i = 0;
+
+    while(1)
+    {
+        zip_slot_t* s = r->slots + i;
+        int stop, n, final;
+
+        pthread_mutex_lock(&r->lock);
+        while(s->full && !r->stop) pthread_cond_wait(&r->cond, &r->lock);
+        stop = r->stop;
+        pthread_mutex_unlock(&r->lock);
+
+        if(stop) break;
+
+        n = zip_decode(r->d, s->data, XML_ZIP_BLOCK);
+        final = n < 0 || r->d->done;
+
+        pthread_mutex_lock(&r->lock);
+        s->len = n;
+        s->final = final;
+        s->full = 1;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+
+        if(final) break;
+        i = (i + 1) % XML_ZIP_SLOTS;
+    }
+
+    return 0;
+}
+
+
+
+static void zip_release(zip_ring_t* r, zip_slot_t* s)
+{
+    pthread_mutex_lock(&r->lock);
+    s->full = 0;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+
+
+// parser reads blocks decompressed by producer thread
+// unparsed input is copied in front of next block, so only token spanning
+// two blocks is copied
+static int zip_parse_threaded(xml_parser_t* p, zip_decoder_t* d)
+{
+    zip_ring_t r;
+    zip_slot_t* prev = 0;
+    char* mem = malloc(XML_ZIP_SLOTS * (XML_ZIP_KEEP + XML_ZIP_BLOCK));
+    char* tail = 0;
+    int keep = 0;
+    int err = XML_ERROR_NONE;
+    pthread_t thread;
+    int i;
+
+    if(!mem) return zip_fail(p, XML_ERROR_NO_MEMORY, "No enough memory for input buffer");
+
+    r.d = d;
+    r.stop = 0;
+    for(i = 0; i < XML_ZIP_SLOTS; i++)
+    {
+        r.slots[i].data = mem + i * (XML_ZIP_KEEP + XML_ZIP_BLOCK) + XML_ZIP_KEEP;
+        r.slots[i].full = 0;
+    }
+
+    pthread_mutex_init(&r.lock, 0);
+    pthread_cond_init(&r.cond, 0);
+
+    if(pthread_create(&thread, 0, zip_producer, &r))
+    {
+        pthread_cond_destroy(&r.cond);
+        pthread_mutex_destroy(&r.lock);
+        free(mem);
+        return zip_parse(p, d);
+    }
+
+    for(i = 0; ; i = (i + 1) % XML_ZIP_SLOTS)
+    {
+        zip_slot_t* s = r.slots + i;
+        char* start;
+        int len, consumed;
+
+        pthread_mutex_lock(&r.lock);
+        while(!s->full) pthread_cond_wait(&r.cond, &r.lock);
+        pthread_mutex_unlock(&r.lock);
+
+        start = s->data - keep;
+        if(keep) memcpy(start, tail, keep);
+        if(prev) zip_release(&r, prev);
+        prev = s;
+
+        if(s->len < 0)
+        {
+            err = zip_fail(p, d->err, d->errstr);
+            break;
+        }
+
+        len = keep + s->len;
+        consumed = xml_parse_chunk(p, start, len, s->final);
+
+        if(consumed < 0)
+        {
+            err = p->errorcode;
+            break;
+        }
+        if(s->final) break;
+
+        keep = len - consumed;
+        tail = start + consumed;
+
+        if(keep > XML_ZIP_KEEP)
+        {
+            err = zip_fail(p, XML_ERROR_NO_MEMORY, "No enough memory in input buffer");
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&r.lock);
+    r.stop = 1;
+    pthread_cond_broadcast(&r.cond);
+    pthread_mutex_unlock(&r.lock);
+
+    pthread_join(thread, 0);
+    pthread_cond_destroy(&r.cond);
+    pthread_mutex_destroy(&r.lock);
+    free(mem);
+
+    return err;
+}
+
+#endif
+
+
+
+int xml_parse_zip(xml_parser_t* p, xml_zip_read_t read, void* ctx, int format, int threaded)
+{
+    zip_decoder_t* d = malloc(sizeof(zip_decoder_t));
+    int err;
+
+    if(!d) return zip_fail(p, XML_ERROR_NO_MEMORY, "No enough memory for decompression");
+
+    if(zip_open(d, format, read, ctx)) err = zip_fail(p, d->err, d->errstr);
+#ifdef XML_HAVE_THREADS
+    else if(threaded) err = zip_parse_threaded(p, d);
+#endif
+    else err = zip_parse(p, d);
+
+    (void)threaded;
+    zip_close(d);
+    free(d);
+    return err;
+}
+
+
+
+int xml_parse_zip_file(xml_parser_t* p, const char* path, int format, int threaded)
+{
+    FILE* f = fopen(path, "rb");
+    int err;
+
+    if(!f) return zip_fail(p, XML_ERROR_ARG, "Can not open input file");
+
+    err = xml_parse_zip(p, zip_read_file, f, format, threaded);
+    fclose(f);
+    return err;
+}
@@ -0,0 +1,97 @@
+/*  Copyright (c) 2013, Mario Ivancic
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice, this
+       list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+    ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// xmlzip.h
+// parsing of gzip and zstd compressed input: input is decompressed in blocks
+// that are passed to xml_parse_chunk, so whole decompressed document is never
+// held in memory
+//
+// gzip support is compiled with XML_HAVE_ZLIB (link with -lz), zstd support
+// with XML_HAVE_ZSTD (link with -lzstd); with XML_HAVE_THREADS (link with
+// -lpthread) decompression can run on separate thread, parser then reads
+// blocks from ring buffer of XML_ZIP_SLOTS blocks
+//
+// tokens up to XML_ZIP_KEEP bytes can span two blocks
+// use XML_LIMIT_BYTES to limit decompressed size of untrusted input
+
+#ifndef __XMLZIP_H__
+#define __XMLZIP_H__
+
+#include "xmlparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// size of decompressed block
+#ifndef XML_ZIP_BLOCK
+#define XML_ZIP_BLOCK   (64 * 1024)
+#endif
+
+// max length of unparsed input carried from one block to next
+#ifndef XML_ZIP_KEEP
+#define XML_ZIP_KEEP    (16 * 1024)
+#endif
+
+// number of blocks in ring buffer of threaded decompression
+#ifndef XML_ZIP_SLOTS
+#define XML_ZIP_SLOTS   4
+#endif
+
+// size of compressed input buffer
+#ifndef XML_ZIP_IN
+#define XML_ZIP_IN      (16 * 1024)
+#endif
+
+// compression formats
+enum
+{
+    XML_ZIP_AUTO = 0,       // detected from header, uncompressed input if not gzip, zlib or zstd
+    XML_ZIP_NONE,
+    XML_ZIP_GZIP,           // gzip or zlib stream, concatenated gzip members are decompressed
+    XML_ZIP_ZSTD,
+};
+
+// reads up to size bytes of compressed input to buf
+// returns number of bytes read, 0 at end of input or -1 on error
+typedef int (*xml_zip_read_t)(void* ctx, char* buf, int size);
+
+
+// parse compressed input with p
+// threaded is ignored if library is compiled without XML_HAVE_THREADS
+// returns XML_ERROR_NONE or error code reported to error handler:
+// XML_ERROR_ARG if format is not supported or input can not be read,
+// XML_ERROR_MALFORMED if compressed data is corrupted or truncated,
+// XML_ERROR_NO_MEMORY if token does not fit in XML_ZIP_KEEP bytes,
+// or parser error code
+int xml_parse_zip(xml_parser_t* p, xml_zip_read_t read, void* ctx, int format, int threaded);
+
+// same as xml_parse_zip for content of file path
+int xml_parse_zip_file(xml_parser_t* p, const char* path, int format, int threaded);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __XMLZIP_H__